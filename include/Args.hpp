@@ -1,5 +1,47 @@
 #pragma once
 
+#include <encoding.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// Mesh optimizations applied before writing vertices.
+enum class EOptimization
+{
+	/// Keep the triangle order from the input file.
+	None,
+	/// Reorder triangles for post-transform vertex cache and vertices for
+	/// vertex fetch locality.
+	VertexCache,
+	/// Same as VertexCache, then reorder triangle clusters to reduce overdraw.
+	Overdraw,
+};
+
+/// Spatial grids that meshes are split into.
+enum class EGrid
+{
+	/// Meshes are not split.
+	None,
+	/// Cells of the same size.
+	Uniform,
+	/// Leaves of an octree, subdivided until they have at most a given number
+	/// of triangles.
+	Octree,
+};
+
+/// Filters applied to output files before they are compressed.
+enum class ECompressionFilter
+{
+	/// Bytes are compressed as they are.
+	None,
+	/// Bytes are split into planes, one for each byte of a vertex, so that
+	/// bytes of the same attribute component are next to each other.
+	Shuffle,
+	/// Same as Shuffle, then each byte is replaced with its difference from
+	/// the previous byte of its plane.
+	Delta,
+};
+
 struct SArgs
 {
 	bool ShowHelpAndExit = false;
@@ -17,6 +59,46 @@ struct SArgs
 	bool WriteTextureCoords2 = false;
 	bool OverrideOutputFile = false;
 	bool ConvertToZUp = false;
+	bool Indexed = false;
+	bool SubMeshes = false;
+	bool Instanced = false;
+	bool Nodes = false;
+	bool Bounds = false;
+	bool Strip = false;
+	bool Morph = false;
+	/// Target triangle ratios of generated levels of detail, relative to the
+	/// original meshes.
+	std::vector<float> LodRatios;
+	/// Maximum error of generated levels of detail relative to the size of
+	/// meshes, 0 if unlimited.
+	float LodError = 0.0f;
+	EGrid Grid = EGrid::None;
+	/// Size of cells of uniform grids.
+	float GridCellSize = 0.0f;
+	/// Maximum number of triangles in cells of octree grids.
+	uint32_t GridCellTriangles = 0;
+	/// Maximum number of triangles of clusters, 0 if meshes are not split into
+	/// clusters.
+	uint32_t ClusterTriangles = 0;
+	/// Zlib compression level of the output file, 0 if it is not compressed.
+	uint32_t CompressionLevel = 0;
+	ECompressionFilter CompressionFilter = ECompressionFilter::None;
+	EPositionEncoding PositionEncoding = EPositionEncoding::Float;
+	EVectorEncoding VectorEncoding = EVectorEncoding::Float;
+	ETexCoordEncoding TexCoordEncoding = ETexCoordEncoding::Float;
+	EOptimization Optimization = EOptimization::None;
+	bool Native = false;
+	/// Same as Assimp's default.
+	float SmoothingAngle = 175.0f;
+	uint32_t ThreadCount = 0;
+	bool Batch = false;
+	bool Cache = false;
+	const char* CacheDir = nullptr;
+	bool Profile = false;
+	const char* ProfileTrace = nullptr;
+	/// Positional arguments. In batch mode these are input files, directories,
+	/// wildcard patterns or manifest files prefixed with @.
+	std::vector<const char*> Paths;
 };
 
 bool ParseArgs(int _argc, const char** _argv, SArgs& _argsOut);
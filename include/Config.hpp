@@ -1,9 +1,14 @@
 #pragma once
 
 #include <Args.hpp>
+#include <encoding.hpp>
 #include <math.hpp>
 
+#include <assimp/aabb.h>
+
 #include <cstdint>
+#include <string>
+#include <vector>
 
 struct SConfig
 {
@@ -11,8 +16,37 @@ struct SConfig
 	void Default();
 	void FromArgs(const SArgs& _args);
 
+	/// Sets Flags and RemoveComponents to the smallest set of Assimp's
+	/// post-processing steps and components needed for the vertex format.
+	void PlanPostProcessing();
+
+	uint32_t GetVertexSize() const;
+
+	/// Returns true if the output is a YAMC container instead of a plain vertex
+	/// buffer.
+	bool IsContainer() const;
+
+	/// Returns true if the node hierarchy is walked while writing instead of
+	/// being flattened with aiProcess_PreTransformVertices, which drops morph
+	/// targets of meshes.
+	bool WalksNodes() const;
+
+	/// Returns true if each mesh is written only once and untransformed, as a
+	/// separate sub-mesh.
+	bool WritesMeshesOnce() const;
+
+	/// Returns the number of generated levels of detail, not counting the
+	/// original meshes.
+	uint32_t GetLodCount() const;
+
+	/// Returns a string with all options that affect the output, used as a
+	/// part of cache keys.
+	std::string Serialize() const;
+
 	bool WritePositions;
 	bool WriteNormals;
+	/// Generate smooth instead of flat normals for models that have none.
+	bool SmoothNormals;
 	bool WriteTextureCoords;
 	bool WriteTextureCoords2;
 	bool WriteColors;
@@ -21,5 +55,67 @@ struct SConfig
 	EAxis UpVector;
 	bool FlipUVs;
 	bool InvertWinding;
+	bool Indexed;
+	/// Group meshes by material into sub-meshes instead of collapsing them into
+	/// a single vertex buffer.
+	bool SubMeshes;
+	/// Write each mesh once and a table of its instances in the node hierarchy
+	/// instead of flattening the hierarchy.
+	bool Instanced;
+	/// Write each mesh once and the node hierarchy with bounding boxes of nodes
+	/// instead of flattening the hierarchy.
+	bool Nodes;
+	/// Write bounding boxes and spheres of the model and its sub-meshes.
+	bool Bounds;
+	/// Write triangles as triangle strips joined with degenerate triangles.
+	bool Strip;
+	/// Write morph targets of meshes as sparse deltas, addressed by an
+	/// additional attribute at the end of each vertex.
+	bool Morph;
+	/// Target triangle ratios of generated levels of detail, each simplified
+	/// from the previous one.
+	std::vector<float> LodRatios;
+	/// Maximum error of generated levels of detail relative to the size of
+	/// meshes, 0 if unlimited. Generates a single level if LodRatios is empty.
+	float LodError;
+	/// Split meshes into cells of a spatial grid, written as separate ranges
+	/// of sub-meshes together with their bounding boxes.
+	EGrid Grid;
+	/// Size of cells of uniform grids.
+	float GridCellSize;
+	/// Maximum number of triangles in cells of octree grids.
+	uint32_t GridCellTriangles;
+	/// Split triangles of meshes into clusters of at most this many triangles,
+	/// written together with their bounding spheres and normal cones. 0 if
+	/// meshes are not split into clusters.
+	uint32_t ClusterTriangles;
+	/// Zlib compression level of the output file, 0 if it is not compressed.
+	uint32_t CompressionLevel;
+	/// Filter applied to the output file before it is compressed.
+	ECompressionFilter CompressionFilter;
+	EPositionEncoding PositionEncoding;
+	EVectorEncoding VectorEncoding;
+	ETexCoordEncoding TexCoordEncoding;
+	/// Bounding box that quantized positions are relative to. Not set from
+	/// arguments, but computed by WriteScene before writing vertices.
+	aiAABB PositionBounds;
+	EOptimization Optimization;
+	/// Generate normals and tangents with GenerateTangentSpace and flatten the
+	/// node hierarchy while writing (see GetMeshInstances) instead of using
+	/// Assimp's post-processing steps.
+	bool Native;
+	/// Largest angle in degrees between faces whose normals are averaged into
+	/// smooth normals.
+	float SmoothingAngle;
+	uint32_t ThreadCount;
+	bool Cache;
+	std::string CacheDir;
+	bool Profile;
+	/// Path to a Chrome trace JSON file written with --profile=FILE, empty if
+	/// none.
+	std::string ProfileTrace;
+	/// Assimp's post-processing steps (aiPostProcessSteps).
 	uint32_t Flags;
+	/// Components removed by aiProcess_RemoveComponent (aiComponent).
+	uint32_t RemoveComponents;
 };
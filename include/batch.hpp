@@ -0,0 +1,8 @@
+#pragma once
+
+#include <Args.hpp>
+#include <Config.hpp>
+
+/// Converts all inputs given in _args.Paths and returns the exit code of the
+/// program, which is EXIT_FAILURE if conversion of any file failed.
+int RunBatch(const SArgs& _args, const SConfig& _conf);
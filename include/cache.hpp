@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Config.hpp>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// Returns true if there is a cache manifest next to _pathOut.
+bool HasCacheManifest(const char* _pathOut);
+
+/// Deletes the cache manifest next to _pathOut, if there is one. Must be
+/// called before _pathOut is overwritten, so an incomplete output is never
+/// considered up to date.
+void RemoveCacheManifest(const char* _pathOut);
+
+/// Returns true if _pathOut exists and its cache manifest shows that neither
+/// the input files, nor the configuration changed since it was written.
+bool IsCacheUpToDate(const char* _pathIn, const char* _pathOut, const SConfig& _conf);
+
+/// Copies an output made from identical inputs with identical configuration
+/// from the cache directory to _pathOut, if there is one. Returns true on
+/// success.
+bool RestoreFromCache(const char* _pathIn, const char* _pathOut, const SConfig& _conf, std::ostream& _log);
+
+/// Writes a cache manifest next to _pathOut and copies it into the cache
+/// directory, if one is configured. _dependencies are paths of all files read
+/// when loading the input.
+void StoreInCache(
+	const char* _pathIn,
+	const char* _pathOut,
+	const SConfig& _conf,
+	const std::vector<std::string>& _dependencies,
+	std::ostream& _log);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Config.hpp>
+#include <writing.hpp>
+
+#include <assimp/scene.h>
+
+#include <cstdint>
+#include <vector>
+
+/// Default maximum number of triangles of clusters.
+#define CLUSTER_TRIANGLES 128
+
+/// A cluster of triangles of a mesh instance, with bounds for culling. Bounds
+/// are in the space of written positions.
+struct SCluster
+{
+	uint32_t TriangleCount = 0;
+	/// Center of the bounding sphere.
+	aiVector3D Center;
+	/// Radius of the bounding sphere.
+	float Radius = 0.0f;
+	/// Axis of the cone of normals of front faces of the triangles.
+	aiVector3D ConeAxis;
+	/// Sine of the angle between the axis and the normal furthest from it, or
+	/// 1 if the normals are not within a cone narrower than 180 degrees, in
+	/// which case the cluster is never backfacing. A cluster is backfacing if
+	/// dot(Center - camera, ConeAxis) >= ConeCutoff * |Center - camera| + Radius.
+	float ConeCutoff = 1.0f;
+};
+
+/// Mesh instances with triangles reordered into clusters.
+struct SClusteredInstances
+{
+	/// The instances, each with triangles of its clusters one after another.
+	std::vector<SMeshInstance> Instances;
+	/// Clusters of each instance, in order of their triangles. Empty for
+	/// meshes that are not triangle meshes.
+	std::vector<std::vector<SCluster>> Clusters;
+	/// Triangle lists referenced by Instances.
+	std::vector<std::vector<uint32_t>> Triangles;
+};
+
+/// Splits triangles of each triangle mesh instance into clusters of at most
+/// SConfig::ClusterTriangles triangles. Clusters are grown greedily from seed
+/// triangles through triangles that share positions with them, preferring
+/// triangles close to the cluster's center and facing the same direction, so
+/// that clusters are compact and have narrow cones of normals.
+SClusteredInstances BuildClusters(const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Config.hpp>
+#include <container.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+/// Default zlib compression level, same as zlib's.
+#define COMPRESSION_LEVEL 6
+
+/// Size of blocks of uncompressed data that are compressed in parallel.
+#define COMPRESSION_BLOCK_SIZE (128 * 1024)
+
+/// Size of deflate's window. Each block is compressed with this many bytes
+/// preceding it as the dictionary, so that matches can reach across blocks.
+#define COMPRESSION_WINDOW_SIZE (32 * 1024)
+
+/// Magic number that filtered data start with ("YFLT"), followed by the filter
+/// (ECompressionFilter), the stride (vertex size) and the size of the
+/// unfiltered data (u32 each).
+#define COMPRESSION_FILTER_MAGIC YAMC_FOURCC('Y', 'F', 'L', 'T')
+
+/// Stream buffer that appends everything written through an std::ostream to
+/// Data, which WriteCompressed then reads in place, unlike std::ostringstream
+/// whose contents can only be copied out.
+struct SMemoryStreamBuffer : public std::streambuf
+{
+	std::vector<char> Data;
+
+protected:
+	int_type overflow(int_type _char) override
+	{
+		if (!traits_type::eq_int_type(_char, traits_type::eof()))
+		{
+			Data.push_back(traits_type::to_char_type(_char));
+		}
+		return traits_type::not_eof(_char);
+	}
+
+	std::streamsize xsputn(const char* _data, std::streamsize _size) override
+	{
+		Data.insert(Data.end(), _data, _data + _size);
+		return _size;
+	}
+};
+
+/// Filters _size bytes of _data with _filter and writes them, prefixed with a
+/// header starting with COMPRESSION_FILTER_MAGIC, into _out. Bytes after the
+/// last whole _stride bytes are copied unfiltered.
+void FilterBytes(const char* _data, size_t _size, ECompressionFilter _filter, uint32_t _stride, std::vector<char>& _out);
+
+/// Compresses _size bytes of _data into a single zlib stream (RFC 1950) in
+/// _out. Blocks of COMPRESSION_BLOCK_SIZE bytes are deflated in parallel, each
+/// ended with a sync flush so that they can be concatenated, and their Adler-32
+/// checksums are combined. Returns false on failure.
+bool CompressZlib(const char* _data, size_t _size, uint32_t _level, uint32_t _threadCount, std::vector<char>& _out);
+
+/// Filters _size bytes of _data with SConfig::CompressionFilter, compresses
+/// them with SConfig::CompressionLevel and writes them into a file. Returns
+/// false on failure.
+bool WriteCompressed(std::ostream& _file, const char* _data, size_t _size, const SConfig& _conf, std::ostream& _log);
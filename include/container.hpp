@@ -0,0 +1,98 @@
+#pragma once
+
+#include <writing.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+
+#define YAMC_FOURCC(_a, _b, _c, _d) \
+	(((uint32_t)(_a) << 0) \
+	| ((uint32_t)(_b) << 8) \
+	| ((uint32_t)(_c) << 16) \
+	| ((uint32_t)(_d) << 24))
+
+/// Magic number that container files start with ("YAMC").
+#define YAMC_CONTAINER_MAGIC YAMC_FOURCC('Y', 'A', 'M', 'C')
+
+/// Version of the container layout, increased on incompatible changes.
+#define YAMC_CONTAINER_VERSION 1
+
+/// Identifiers of chunks stored in a container file.
+///
+/// A container file starts with a header (magic, version, number of chunks),
+/// followed by the chunks. Each chunk has its identifier and the size of its
+/// payload in bytes, followed by the payload itself. All values are little
+/// endian. Readers skip chunks they do not understand.
+enum class EChunk : uint32_t
+{
+	/// Primitive type (pr_* constant, 0 if sub-meshes have different primitive
+	/// types), vertex size, vertex count and vertex data.
+	Vertices = YAMC_FOURCC('V', 'E', 'R', 'T'),
+	/// Index size in bytes (2 or 4), index count and index data.
+	Indices = YAMC_FOURCC('I', 'N', 'D', 'X'),
+	/// Bounding box (min and max, float3 each) that quantized positions are
+	/// relative to.
+	PositionBounds = YAMC_FOURCC('Q', 'P', 'O', 'S'),
+	/// Number of sub-meshes, followed by material index, primitive type,
+	/// first vertex, vertex count, first index, index count (u32 each) and
+	/// null-terminated material name of each sub-mesh.
+	SubMeshes = YAMC_FOURCC('M', 'E', 'S', 'H'),
+	/// Number of instances, followed by the index of the sub-mesh and the
+	/// transform (16 floats, column-major, same as GameMaker's matrices) of
+	/// each instance.
+	Instances = YAMC_FOURCC('I', 'N', 'S', 'T'),
+	/// Number of nodes, followed by the index of the parent (0xFFFFFFFF for
+	/// the root), the local transform (16 floats, column-major), the bounding
+	/// box of all sub-meshes of the node and its children in the node's space
+	/// (min and max, float3 each, min greater than max if there are none), the
+	/// number of sub-meshes and their indices (u32 each) and the
+	/// null-terminated name of each node. Parents come before their children.
+	Nodes = YAMC_FOURCC('N', 'O', 'D', 'E'),
+	/// Bounding volume of the whole model, followed by the number of
+	/// sub-meshes (1 if there is no SubMeshes chunk) and the bounding volume
+	/// of each sub-mesh. A bounding volume is a box (min and max, float3 each)
+	/// and a sphere (center float3 and radius float).
+	Bounds = YAMC_FOURCC('B', 'N', 'D', 'S'),
+	/// Number of levels of detail, followed by the error (float, an estimate of
+	/// the distance in model space by which the level deviates from the
+	/// original meshes), the index of the first sub-mesh and the number of sub-meshes
+	/// (u32 each) of each level. The first level is the original meshes.
+	Lods = YAMC_FOURCC('L', 'O', 'D', 'S'),
+	/// Number of cells of the spatial grid, followed by the origin (float3,
+	/// the center of the cell in the grid), the bounding box (min and max,
+	/// float3 each), the first vertex, vertex count, first sub-mesh and number
+	/// of sub-meshes (u32 each) of each cell. Vertices of each cell are
+	/// contiguous.
+	Cells = YAMC_FOURCC('C', 'E', 'L', 'L'),
+	/// Number of clusters of triangles, followed by the index of the sub-mesh
+	/// (0 if there is no SubMeshes chunk), the first vertex (or index if
+	/// indexed) relative to the sub-mesh's first vertex (or index), the number
+	/// of vertices (or indices), the bounding sphere (center float3 and radius
+	/// float) and the cone of normals (axis float3 and cutoff float) of each
+	/// cluster. Clusters are ordered by sub-mesh.
+	Clusters = YAMC_FOURCC('C', 'L', 'S', 'T'),
+	/// Number of morph targets, followed by the default weight (float) and the
+	/// null-terminated name of each target, the scale of position offsets
+	/// (float), the number of deltas, the largest number of deltas of a single
+	/// vertex and the deltas, MORPH_DELTA_SIZE bytes each (see morph.hpp).
+	/// The last 4 bytes of each vertex address its deltas: the first delta in
+	/// the lower 24 bits, their number in the upper 8 bits.
+	MorphTargets = YAMC_FOURCC('M', 'R', 'P', 'H'),
+};
+
+struct SContainer
+{
+	/// Adds a new chunk and returns a buffer to write its payload into.
+	SStagingBuffer& AddChunk(EChunk _id);
+
+	void Write(std::ostream& _file);
+
+	struct SChunk
+	{
+		EChunk Id;
+		SStagingBuffer Payload;
+	};
+
+	std::deque<SChunk> Chunks;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Config.hpp>
+#include <profiler.hpp>
+
+#include <assimp/Importer.hpp>
+
+#include <ostream>
+
+enum class EConvertResult
+{
+	Success,
+	Skipped,
+	Failed,
+};
+
+/// Loads a model using given importer and writes it into a file. Does not
+/// check whether the output file already exists. All messages are written
+/// into _log. If _profiler is not nullptr, durations of all stages of the
+/// conversion are recorded into it.
+EConvertResult ConvertFile(
+	Assimp::Importer& _importer,
+	const char* _pathIn,
+	const char* _pathOut,
+	const SConfig& _conf,
+	std::ostream& _log,
+	SProfiler* _profiler = nullptr);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Config.hpp>
+
+#include <assimp/scene.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/// Largest possible size of a single vertex in bytes.
+#define VERTEX_SIZE_MAX 64
+
+/// Encodes vertices of a single mesh.
+///
+/// Attributes that differ between vertices are first encoded for all vertices
+/// of the mesh into separate streams, using the vectorized kernels from
+/// kernels.hpp (up axis conversion, UV flipping, color packing, bitangent
+/// signs). The streams are then interleaved by a function specialized at
+/// compile time for the combination of attributes and their sizes, selected
+/// once per mesh. Attributes that are the same for all vertices (defaults for
+/// attributes the mesh does not have, material colors) are encoded only once
+/// into a template vertex, which is copied for each vertex.
+struct SMeshEncoder
+{
+	/// If _transform is not nullptr, vertices are transformed by it before
+	/// encoding. If _vertices is not nullptr, only these vertices of the mesh
+	/// are transformed and encoded, e.g. the ones referenced by a cell of the
+	/// spatial grid, and indices passed to Encode are indices into _vertices.
+	SMeshEncoder(
+		const aiScene& _scene,
+		const aiMesh& _mesh,
+		const SConfig& _conf,
+		const aiMatrix4x4* _transform = nullptr,
+		const std::vector<uint32_t>* _vertices = nullptr);
+
+	/// Encodes vertices of the mesh with given indices into _out, which must
+	/// have space for _count vertices. If _indices is nullptr, vertices 0 to
+	/// _count - 1 are encoded.
+	void Encode(char* _out, const uint32_t* _indices, size_t _count) const
+	{
+		Function(*this, _out, _indices, _count);
+	}
+
+	using FEncode = void (*)(const SMeshEncoder& _encoder, char* _out, const uint32_t* _indices, size_t _count);
+
+	FEncode Function;
+	uint32_t VertexSize;
+	uint32_t NormalOffset;
+	uint32_t TexCoordOffset;
+	uint32_t TexCoord2Offset;
+	uint32_t ColorOffset;
+	uint32_t TangentOffset;
+	/// Encoded attributes of all encoded vertices. Streams of attributes that
+	/// are not written or are in the template vertex are empty.
+	std::vector<char> Positions;
+	std::vector<char> Normals;
+	std::vector<char> TexCoords;
+	std::vector<char> TexCoords2;
+	std::vector<char> Colors;
+	std::vector<char> Tangents;
+	std::array<char, VERTEX_SIZE_MAX> Template;
+};
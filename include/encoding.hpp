@@ -0,0 +1,161 @@
+#pragma once
+
+#include <math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+enum class EPositionEncoding
+{
+	/// Three 32-bit floats.
+	Float,
+	/// Three 16-bit unsigned integers relative to the model's bounding box and
+	/// 16 bits of padding.
+	Quantized,
+};
+
+enum class EVectorEncoding
+{
+	/// Three 32-bit floats (four for tangents with bitangent sign).
+	Float,
+	/// Four 8-bit signed normalized integers. Bitangent sign is stored in the
+	/// last component of tangents.
+	SNorm,
+	/// Two 16-bit unsigned normalized integers with octahedral mapping of the
+	/// vector. Bitangent sign is stored in the highest bit of tangents.
+	Octahedral,
+};
+
+enum class ETexCoordEncoding
+{
+	/// Two 32-bit floats.
+	Float,
+	/// Two 16-bit half floats.
+	Half,
+};
+
+inline const char* GetEncodingName(EPositionEncoding _encoding)
+{
+	return (_encoding == EPositionEncoding::Quantized) ? "quantized" : "float";
+}
+
+inline const char* GetEncodingName(EVectorEncoding _encoding)
+{
+	return (_encoding == EVectorEncoding::SNorm) ? "snorm"
+		: ((_encoding == EVectorEncoding::Octahedral) ? "oct" : "float");
+}
+
+inline const char* GetEncodingName(ETexCoordEncoding _encoding)
+{
+	return (_encoding == ETexCoordEncoding::Half) ? "half" : "float";
+}
+
+/// Converts a float to a half float, rounding to nearest even.
+inline uint16_t FloatToHalf(float _value)
+{
+	uint32_t bits;
+	memcpy(&bits, &_value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// NaN and infinity
+	if (exponent == 0xFF)
+	{
+		return (uint16_t)(sign | 0x7C00 | ((mantissa != 0) ? 0x200 : 0));
+	}
+
+	int32_t halfExponent = (int32_t)exponent - 127 + 15;
+
+	// Overflow to infinity
+	if (halfExponent >= 31)
+	{
+		return (uint16_t)(sign | 0x7C00);
+	}
+
+	// Subnormals and underflow to zero
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+		{
+			return (uint16_t)sign;
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = (uint32_t)(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1) != 0))
+		{
+			++half;
+		}
+		return (uint16_t)(sign | half);
+	}
+
+	uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFF;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1) != 0))
+	{
+		// May carry into the exponent, which correctly rounds up to infinity
+		++half;
+	}
+	return (uint16_t)(sign | half);
+}
+
+/// Encodes a value in range [-1, 1] as an 8-bit signed normalized integer.
+inline int8_t EncodeSNorm8(float _value)
+{
+	return (int8_t)std::lround(std::clamp(_value, -1.0f, 1.0f) * 127.0f);
+}
+
+/// Encodes a value in range [0, 1] as a 16-bit unsigned normalized integer.
+inline uint16_t EncodeUNorm16(float _value)
+{
+	return (uint16_t)std::lround(std::clamp(_value, 0.0f, 1.0f) * 65535.0f);
+}
+
+/// Encodes a value in range [0, 1] as an 8-bit unsigned normalized integer,
+/// rounding to nearest. Values out of the range (including NaN) are clamped,
+/// the same way as with SSE's min and max.
+inline uint32_t EncodeUNorm8(float _value)
+{
+	_value = (_value < 1.0f) ? _value : 1.0f;
+	_value = (_value > 0.0f) ? _value : 0.0f;
+	return (uint32_t)(_value * 255.0f + 0.5f);
+}
+
+/// Encodes a color as four 8-bit unsigned normalized integers, red in the
+/// lowest byte.
+inline uint32_t EncodeRGBA8(float _r, float _g, float _b, float _a)
+{
+	return (EncodeUNorm8(_a) << 24)
+		| (EncodeUNorm8(_b) << 16)
+		| (EncodeUNorm8(_g) << 8)
+		| (EncodeUNorm8(_r) << 0);
+}
+
+/// Maps a unit vector onto a square [-1, 1]x[-1, 1] using octahedral mapping.
+inline void EncodeOctahedral(const aiVector3D& _v, float& _u, float& _w)
+{
+	float length = std::fabs(_v.x) + std::fabs(_v.y) + std::fabs(_v.z);
+	if (length <= 0.0f)
+	{
+		_u = 0.0f;
+		_w = 0.0f;
+		return;
+	}
+
+	float x = _v.x / length;
+	float y = _v.y / length;
+	if (_v.z < 0.0f)
+	{
+		float xOld = x;
+		x = (1.0f - std::fabs(y)) * ((xOld >= 0.0f) ? 1.0f : -1.0f);
+		y = (1.0f - std::fabs(xOld)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+	}
+	_u = x;
+	_w = y;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Native GameMaker extension that loads files written by yamc on background
+// threads. All functions take and return doubles or strings, so they can be
+// defined with external_define. Buffer addresses are passed as strings
+// (buffer_get_address).
+//
+// A load goes through these states:
+// 1. yamc_ext_load queues a job that reads the file and decompresses it if it
+//    was written with --compress. Status is YAMC_EXT_PENDING.
+// 2. Once the size of the result is known, status is YAMC_EXT_READY and
+//    yamc_ext_size returns it. The caller creates a buffer of that size.
+// 3. yamc_ext_complete queues unpacking (undoing the compression filter and
+//    expanding indices) directly into the caller's buffer. Status is
+//    YAMC_EXT_PENDING until it is done, then YAMC_EXT_DONE. The buffer must
+//    not be deleted before that.
+// 4. yamc_ext_free frees the job.
+//
+// If anything fails, status is YAMC_EXT_FAILED.
+
+#if !defined(__cplusplus)
+// Included from C, e.g. by tests/ext_test.c, which only imports the functions
+#define YAMC_EXT_EXPORT extern
+#elif defined(_WIN32)
+#define YAMC_EXT_EXPORT extern "C" __declspec(dllexport)
+#else
+#define YAMC_EXT_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+/// The job is being processed.
+#define YAMC_EXT_PENDING 0
+/// The size of the result is known, waiting for yamc_ext_complete.
+#define YAMC_EXT_READY 1
+/// The result was written into the caller's buffer.
+#define YAMC_EXT_DONE 2
+/// The file could not be read or it is invalid, or the job does not exist.
+#define YAMC_EXT_FAILED -1
+
+/// Starts _threads worker threads, or one for each CPU core if 0. Does
+/// nothing if they are already running. Returns the number of threads.
+YAMC_EXT_EXPORT double yamc_ext_init(double _threads);
+
+/// Waits for all queued work to finish, stops worker threads and frees all
+/// jobs. Returns 1.
+YAMC_EXT_EXPORT double yamc_ext_shutdown();
+
+/// Queues loading of a file. If _expand is not 0, the result is a plain vertex
+/// list, with YAMC container files reduced to their vertices and indexed
+/// vertices expanded, otherwise it is the whole file, decompressed. Returns
+/// the ID of the job, or 0 if the worker threads are not running.
+YAMC_EXT_EXPORT double yamc_ext_load(const char* _path, double _expand);
+
+/// Returns the status of a job (YAMC_EXT_*).
+YAMC_EXT_EXPORT double yamc_ext_status(double _job);
+
+/// Returns the size of the result of a job in bytes, or 0 if it is not known
+/// yet.
+YAMC_EXT_EXPORT double yamc_ext_size(double _job);
+
+/// Queues unpacking of the result of a job with status YAMC_EXT_READY into a
+/// buffer of at least yamc_ext_size bytes at _address. Returns 1 on success or
+/// 0 if the job is not ready.
+YAMC_EXT_EXPORT double yamc_ext_complete(double _job, const char* _address);
+
+/// Frees a job that is not pending. Returns 1 on success or 0 if it does not
+/// exist or it is pending.
+YAMC_EXT_EXPORT double yamc_ext_free(double _job);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Config.hpp>
+#include <writing.hpp>
+
+#include <assimp/scene.h>
+
+#include <cstdint>
+#include <vector>
+
+/// Default maximum number of triangles in cells of octree grids.
+#define GRID_OCTREE_CELL_TRIANGLES 16384
+
+/// Maximum depth of octree grids. Cells at this depth are not subdivided
+/// further, even if they have more triangles, e.g. many triangles with the
+/// same centroid.
+#define GRID_OCTREE_MAX_DEPTH 16
+
+/// A cell of a spatial grid.
+struct SGridCell
+{
+	/// Center of the cell in the grid.
+	aiVector3D Origin;
+	/// Bounding box of primitives of the cell. Can extend beyond the cell in
+	/// the grid, since primitives are assigned to cells by their centroids.
+	aiAABB Box;
+	/// Number of triangles of the cell.
+	uint64_t TriangleCount = 0;
+};
+
+/// Mesh instances split into cells of a spatial grid.
+struct SSpatialGrid
+{
+	/// Cells with at least one primitive, in the order in which they are
+	/// written.
+	std::vector<SGridCell> Cells;
+	/// An instance for each cell that a mesh instance has primitives in, with
+	/// SMeshInstance::Cell set, ordered by cell.
+	std::vector<SMeshInstance> Instances;
+	/// Triangle lists referenced by Instances.
+	std::vector<std::vector<uint32_t>> Triangles;
+};
+
+/// Splits mesh instances into cells of the grid configured with SConfig::Grid,
+/// in the space of written positions, i.e. after transforms of instances and
+/// conversion into the up axis. Triangles are assigned to cells by their
+/// centroids, so they are never cut. Meshes of other primitive types are
+/// assigned as a whole by centers of their bounding boxes. Uniform grids are
+/// aligned to the origin, octree grids to the bounding box of all centroids.
+SSpatialGrid BuildSpatialGrid(const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf);
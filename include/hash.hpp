@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define HASH_SEED 14695981039346656037ull
+
+/// Computes a 64-bit FNV-1a hash of given bytes. Pass a previously returned
+/// hash as the seed to hash multiple pieces of data together.
+inline uint64_t HashBytes(const void* _data, size_t _size, uint64_t _seed = HASH_SEED)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+	uint64_t hash = _seed;
+	for (size_t i = 0; i < _size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
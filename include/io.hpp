@@ -0,0 +1,82 @@
+#pragma once
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Assimp IO stream reading from a file on disk.
+struct SFileIOStream : public Assimp::IOStream
+{
+	explicit SFileIOStream(FILE* _file);
+	~SFileIOStream() override;
+
+	size_t Read(void* _buffer, size_t _size, size_t _count) override;
+	size_t Write(const void* _buffer, size_t _size, size_t _count) override;
+	aiReturn Seek(size_t _offset, aiOrigin _origin) override;
+	size_t Tell() const override;
+	size_t FileSize() const override;
+	void Flush() override;
+
+	FILE* File;
+
+	/// If not nullptr, time spent reading in nanoseconds is added to it.
+	std::atomic<uint64_t>* ReadTime = nullptr;
+};
+
+/// Assimp IO stream reading from a file mapped into memory. Reads are plain
+/// copies from the mapping, without any buffering by the C runtime.
+struct SMappedIOStream : public Assimp::IOStream
+{
+	/// Maps a file into memory. Returns nullptr if the file cannot be mapped,
+	/// e.g. if it is empty or it is not a regular file (pipes etc.).
+	static SMappedIOStream* Open(const char* _path);
+
+	~SMappedIOStream() override;
+
+	size_t Read(void* _buffer, size_t _size, size_t _count) override;
+	size_t Write(const void* _buffer, size_t _size, size_t _count) override;
+	aiReturn Seek(size_t _offset, aiOrigin _origin) override;
+	size_t Tell() const override;
+	size_t FileSize() const override;
+	void Flush() override;
+
+	const char* Data = nullptr;
+	size_t Size = 0;
+	size_t Position = 0;
+
+	/// If not nullptr, time spent reading in nanoseconds is added to it.
+	std::atomic<uint64_t>* ReadTime = nullptr;
+
+private:
+	SMappedIOStream() = default;
+};
+
+/// Assimp IO system for files on disk, which records paths of all files that
+/// the importer opened for reading, i.e. the model itself and all files that
+/// it references (materials, external buffers etc.). Files opened for reading
+/// are mapped into memory if possible, otherwise they are read with stdio.
+struct SFileIOSystem : public Assimp::IOSystem
+{
+	bool Exists(const char* _path) const override;
+	char getOsSeparator() const override;
+	Assimp::IOStream* Open(const char* _path, const char* _mode) override;
+	void Close(Assimp::IOStream* _stream) override;
+
+	/// Absolute paths of all files opened for reading, without duplicates, in
+	/// the order they were first opened.
+	std::vector<std::string> OpenedFiles;
+
+	std::mutex Mutex;
+
+	/// Whether to measure time spent opening and reading files into ReadTime.
+	bool MeasureReadTime = false;
+
+	/// Time spent opening and reading files in nanoseconds, summed over all
+	/// streams.
+	std::atomic<uint64_t> ReadTime{0};
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <math.hpp>
+
+#include <assimp/types.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/// Returns the name of the instruction set used by the kernels below, e.g.
+/// "AVX2", "SSE2" or "scalar".
+const char* GetKernelInstructionSet();
+
+/// Converts an array of vectors into given up axis, same as Vec3ConvertUp. The
+/// arrays may be the same.
+void ConvertUpArray(const aiVector3D* _in, aiVector3D* _out, size_t _count, EAxis _up);
+
+/// Computes bitangent signs (1 or -1) of tangents, same as GetBitangentSign.
+/// If _normalStride is 0, all tangents use the same normal.
+void ComputeBitangentSigns(
+	const aiVector3D* _normals,
+	size_t _normalStride,
+	const aiVector3D* _tangents,
+	const aiVector3D* _bitangents,
+	float* _out,
+	size_t _count);
+
+/// Copies X and Y of texture coordinates into an array of float pairs. If
+/// _flip is true, Y is flipped to 1 - Y.
+void ExtractTexCoords(const aiVector3D* _in, float* _out, size_t _count, bool _flip);
+
+/// Packs colors into RGBA8, same as EncodeRGBA8.
+void PackColors(const aiColor4D* _in, uint32_t* _out, size_t _count);
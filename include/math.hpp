@@ -1,6 +1,14 @@
 #pragma once
 
+#include <assimp/aabb.h>
+#include <assimp/matrix4x4.h>
 #include <assimp/vector3.h>
+#include <assimp/vector3.inl>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
 
 enum class EAxis
 {
@@ -30,6 +38,27 @@ inline aiVector3D Vec3ConvertUp(const aiVector3D& _v, EAxis _up)
 	return res;
 }
 
+/// Converts a transform into given up axis, so that it transforms vectors
+/// converted with Vec3ConvertUp.
+inline aiMatrix4x4 Mat4ConvertUp(const aiMatrix4x4& _m, EAxis _up)
+{
+	// Both conversions are their own inverse
+	aiMatrix4x4 conversion;
+	if (_up == EAxis::NegativeY)
+	{
+		conversion.b2 = -1.0f;
+		conversion.c3 = -1.0f;
+	}
+	else //if (_up == EAxis::PositiveZ)
+	{
+		conversion.b2 = 0.0f;
+		conversion.b3 = 1.0f;
+		conversion.c2 = 1.0f;
+		conversion.c3 = 0.0f;
+	}
+	return conversion * _m * conversion;
+}
+
 inline aiVector3D Vec3Cross(const aiVector3D& _v1, const aiVector3D& _v2)
 {
 	aiVector3D res;
@@ -46,6 +75,16 @@ inline float Vec3Dot(const aiVector3D& _v1, const aiVector3D& _v2)
 		+ _v1.z * _v2.z);
 }
 
+/// Returns the largest factor by which a transform scales lengths, i.e. the
+/// length of its longest basis vector.
+inline float Mat4GetMaxScale(const aiMatrix4x4& _m)
+{
+	float x = aiVector3D(_m.a1, _m.b1, _m.c1).SquareLength();
+	float y = aiVector3D(_m.a2, _m.b2, _m.c2).SquareLength();
+	float z = aiVector3D(_m.a3, _m.b3, _m.c3).SquareLength();
+	return std::sqrt(std::max(x, std::max(y, z)));
+}
+
 inline float GetBitangentSign(
 	const aiVector3D& _normal,
 	const aiVector3D& _tangent,
@@ -55,3 +94,54 @@ inline float GetBitangentSign(
 	float dot = Vec3Dot(cross, _bitangent);
 	return (dot < 0.0f) ? -1.0f : 1.0f;
 }
+
+/// Returns an empty bounding box, which is inverted so that adding any point to
+/// it makes it valid.
+inline aiAABB AABBEmpty()
+{
+	return aiAABB(
+		aiVector3D(FLT_MAX, FLT_MAX, FLT_MAX),
+		aiVector3D(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+}
+
+inline bool AABBIsEmpty(const aiAABB& _aabb)
+{
+	return (_aabb.mMin.x > _aabb.mMax.x);
+}
+
+inline void AABBAddPoint(aiAABB& _aabb, const aiVector3D& _point)
+{
+	_aabb.mMin.x = std::min(_aabb.mMin.x, _point.x);
+	_aabb.mMin.y = std::min(_aabb.mMin.y, _point.y);
+	_aabb.mMin.z = std::min(_aabb.mMin.z, _point.z);
+	_aabb.mMax.x = std::max(_aabb.mMax.x, _point.x);
+	_aabb.mMax.y = std::max(_aabb.mMax.y, _point.y);
+	_aabb.mMax.z = std::max(_aabb.mMax.z, _point.z);
+}
+
+inline void AABBAdd(aiAABB& _aabb, const aiAABB& _other)
+{
+	if (!AABBIsEmpty(_other))
+	{
+		AABBAddPoint(_aabb, _other.mMin);
+		AABBAddPoint(_aabb, _other.mMax);
+	}
+}
+
+/// Returns a bounding box of a transformed bounding box.
+inline aiAABB AABBTransform(const aiAABB& _aabb, const aiMatrix4x4& _m)
+{
+	aiAABB res = AABBEmpty();
+	if (!AABBIsEmpty(_aabb))
+	{
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			aiVector3D corner(
+				(i & 1) ? _aabb.mMax.x : _aabb.mMin.x,
+				(i & 2) ? _aabb.mMax.y : _aabb.mMin.y,
+				(i & 4) ? _aabb.mMax.z : _aabb.mMin.z);
+			AABBAddPoint(res, _m * corner);
+		}
+	}
+	return res;
+}
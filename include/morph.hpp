@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Config.hpp>
+#include <writing.hpp>
+
+#include <assimp/scene.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// Maximum number of morph targets of a model. Deltas store the index of their
+/// target in 16 bits, but a vertex counts its deltas in the upper 8 bits of
+/// its address, and it has at most one delta per target.
+#define MORPH_MAX_TARGETS 255
+
+/// Maximum total number of deltas of a model, since vertices address their
+/// first delta with 24 bits.
+#define MORPH_MAX_TOTAL_DELTAS (1u << 24)
+
+/// Number of morph targets that ShBasic.vsh has weights for by default
+/// (MORPH_MAX_TARGETS there).
+#define MORPH_SHADER_MAX_TARGETS 32
+
+/// Number of deltas of a single vertex that ShBasic.vsh blends by default
+/// (MORPH_MAX_VERTEX_DELTAS there).
+#define MORPH_SHADER_MAX_VERTEX_DELTAS 8
+
+/// Size of an encoded delta in bytes, i.e. three RGBA8 texels of a data
+/// texture: X and Y of the position offset as 16-bit signed integers, Z and
+/// the index of the target as a 16-bit integer, and the normal offset as three
+/// 8-bit signed integers plus padding.
+#define MORPH_DELTA_SIZE 12
+
+/// A morph target (blend shape). Meshes' aiAnimMesh with the same name are
+/// the same target.
+struct SMorphTarget
+{
+	/// Name of the target, or its index within meshes if it has none.
+	std::string Name;
+	/// Default weight of the target.
+	float Weight = 0.0f;
+};
+
+/// Sparse deltas of morph targets of all mesh instances.
+struct SMorphTargets
+{
+	std::vector<SMorphTarget> Targets;
+	/// Largest absolute coordinate of position offsets, which their 16-bit
+	/// integers are relative to. Normal offsets are relative to 2.
+	float PositionScale = 0.0f;
+	/// Encoded deltas, MORPH_DELTA_SIZE bytes each. Deltas of a vertex are
+	/// contiguous and only targets that move the vertex have one.
+	std::vector<char> Deltas;
+	/// For each instance, the address of deltas of each of its vertices in
+	/// the order in which WriteMesh writes them: index of the first delta in
+	/// the lower 24 bits and the number of deltas in the upper 8 bits. Empty
+	/// for instances without deltas.
+	std::vector<std::vector<uint32_t>> Addresses;
+	/// Largest number of deltas of a single vertex, i.e. the number of
+	/// iterations a vertex shader needs to blend all of them.
+	uint32_t MaxVertexDeltas = 0;
+
+	uint32_t GetDeltaCount() const { return (uint32_t)(Deltas.size() / MORPH_DELTA_SIZE); }
+};
+
+/// Computes offsets of positions and normals of each morph target of mesh
+/// instances from their original vertices, after transforms of instances and
+/// conversion into the up axis, and quantizes them. Offsets that quantize to
+/// zero are dropped, so memory grows only with the number of vertices that
+/// targets move. Vertices written multiple times, for multiple faces or by
+/// multiple instances of a mesh with the same transform (e.g. its levels of
+/// detail), share their deltas. Returns false and logs an error if the model
+/// exceeds MORPH_MAX_TARGETS or MORPH_MAX_TOTAL_DELTAS. Logs a warning if it
+/// exceeds MORPH_SHADER_MAX_TARGETS or MORPH_SHADER_MAX_VERTEX_DELTAS, since
+/// ShBasic.vsh would then need larger limits.
+bool BuildMorphTargets(
+	const aiScene& _scene,
+	const std::vector<SMeshInstance>& _instances,
+	const SConfig& _conf,
+	SMorphTargets& _out,
+	std::ostream& _log);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Config.hpp>
+
+#include <assimp/scene.h>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// Size of the FIFO post-transform cache used to report statistics.
+#define OPTIMIZE_STATS_CACHE_SIZE 16
+
+struct SVertexCacheStats
+{
+	/// Number of triangles.
+	uint64_t TriangleCount = 0;
+	/// Number of vertices referenced by triangles.
+	uint64_t VertexCount = 0;
+	/// Number of vertex shader invocations with a simulated FIFO cache.
+	uint64_t TransformCount = 0;
+
+	/// Average cache miss ratio, transformed vertices per triangle.
+	double GetACMR() const;
+
+	/// Average transform to vertex ratio, 1.0 is the optimum.
+	double GetATVR() const;
+
+	void Add(const SVertexCacheStats& _other);
+};
+
+/// Simulates a FIFO post-transform cache of given size on triangles of a mesh.
+SVertexCacheStats AnalyzeVertexCache(const aiMesh& _mesh, uint32_t _cacheSize);
+
+/// Reorders triangles of a mesh for post-transform cache locality, using Tom
+/// Forsyth's linear-speed vertex cache optimization.
+void OptimizeVertexCache(aiMesh& _mesh);
+
+/// Same as OptimizeVertexCache, but reorders a triangle list of indices into
+/// _vertexCount vertices.
+void OptimizeVertexCache(std::vector<uint32_t>& _indices, uint32_t _vertexCount);
+
+/// Reorders clusters of triangles (as produced by OptimizeVertexCache) so that
+/// triangles facing outwards from the center of the mesh are drawn first,
+/// reducing overdraw. Follows the cluster sort of the Tipsify algorithm.
+/// Faces are expected reversed by aiProcess_FlipWindingOrder, unless
+/// _invertWinding (SConfig::InvertWinding) reverses them back.
+void OptimizeOverdraw(aiMesh& _mesh, bool _invertWinding);
+
+/// Reorders vertices of a mesh in the order in which they are first referenced
+/// by its faces, for vertex fetch locality. Vertices not referenced by any face
+/// are moved to the end.
+void OptimizeVertexFetch(aiMesh& _mesh);
+
+/// Converts a triangle list of indices into _vertexCount vertices into a
+/// single triangle strip for pr_trianglestrip. Strips are grown greedily
+/// through triangles that share edges, i.e. indices, and stitched together
+/// with degenerate triangles. The result also starts and ends with degenerate
+/// triangles and has even length, so that results of multiple calls can be
+/// concatenated into a single strip.
+std::vector<uint32_t> StripifyTriangles(const std::vector<uint32_t>& _indices, uint32_t _vertexCount);
+
+/// Runs optimizations configured in _conf on all triangle meshes of a scene
+/// and writes ACMR and ATVR before and after into _log.
+void OptimizeScene(aiScene& _scene, const SConfig& _conf, std::ostream& _log);
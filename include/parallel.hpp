@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/// Returns the number of worker threads used when none is specified.
+inline uint32_t GetDefaultThreadCount()
+{
+	uint32_t count = std::thread::hardware_concurrency();
+	return (count > 0) ? count : 1;
+}
+
+/// Returns the number of threads that ParallelFor uses for given arguments.
+inline uint32_t GetWorkerCount(uint32_t _count, uint32_t _threadCount)
+{
+	return std::max(1u, std::min(_count, (_threadCount > 0) ? _threadCount : GetDefaultThreadCount()));
+}
+
+/// Calls _fn(worker, i) for each i in [0, _count) on up to _threadCount
+/// threads, where worker is the index of the calling thread in range
+/// [0, GetWorkerCount(_count, _threadCount)). Items are handed out one by
+/// one, so their cost does not need to be uniform. Returns after all items
+/// are processed.
+template<typename FN>
+void ParallelForWorkers(uint32_t _count, uint32_t _threadCount, FN&& _fn)
+{
+	uint32_t threadCount = GetWorkerCount(_count, _threadCount);
+	if (threadCount <= 1)
+	{
+		for (uint32_t i = 0; i < _count; ++i)
+		{
+			_fn(0, i);
+		}
+		return;
+	}
+
+	std::atomic<uint32_t> next(0);
+	auto worker = [&](uint32_t _worker)
+	{
+		for (uint32_t i = next++; i < _count; i = next++)
+		{
+			_fn(_worker, i);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (uint32_t t = 1; t < threadCount; ++t)
+	{
+		threads.emplace_back(worker, t);
+	}
+	worker(0);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+/// Calls _fn(i) for each i in [0, _count) on up to _threadCount threads.
+/// @see ParallelForWorkers
+template<typename FN>
+void ParallelFor(uint32_t _count, uint32_t _threadCount, FN&& _fn)
+{
+	ParallelForWorkers(_count, _threadCount, [&](uint32_t, uint32_t _i) { _fn(_i); });
+}
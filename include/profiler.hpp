@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// Collects durations of stages of a conversion, enabled with argument
+/// --profile.
+struct SProfiler
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct SEvent
+	{
+		std::string Name;
+		Clock::time_point Start;
+		Clock::duration Duration = Clock::duration::zero();
+		/// Nesting level, 0 for top-level stages.
+		uint32_t Depth = 0;
+		/// Track of the event in Chrome traces, e.g. a worker in batch mode.
+		uint32_t Thread = 0;
+	};
+
+	/// Measures the duration of a stage from its construction until End is
+	/// called or it is destroyed. Does nothing if the profiler is nullptr.
+	struct SScope
+	{
+		SScope(SProfiler* _profiler, const std::string& _name);
+		~SScope();
+
+		/// Ends the measurement and returns its duration, or zero if it has
+		/// already ended or the profiler is nullptr.
+		Clock::duration End();
+
+		SProfiler* Profiler;
+		size_t Index;
+	};
+
+	/// Adds an event that has already finished.
+	void AddEvent(const std::string& _name, Clock::time_point _start, Clock::duration _duration, uint32_t _depth);
+
+	/// Appends all events of another profiler, nested in a new top-level event
+	/// with given name that spans all of them.
+	void Merge(const SProfiler& _other, const std::string& _name, uint32_t _thread);
+
+	/// Writes a table with durations of all stages into _log.
+	void PrintBreakdown(std::ostream& _log) const;
+
+	/// Writes all events into a JSON file that can be opened in
+	/// chrome://tracing or Perfetto. Returns false on failure.
+	bool WriteChromeTrace(const std::string& _path) const;
+
+	std::vector<SEvent> Events;
+
+	/// Nesting level of the next scope.
+	uint32_t Depth = 0;
+
+	/// Time that events in Chrome traces are relative to.
+	Clock::time_point Epoch = Clock::now();
+};
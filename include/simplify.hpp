@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Config.hpp>
+
+#include <assimp/scene.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Weight of differences of normals in the cost of edge collapses, relative to
+/// the size of the mesh. A collapse that turns a normal by 90 degrees costs as
+/// much as moving the surface by about 1.4% of the mesh's size.
+#define SIMPLIFY_NORMAL_WEIGHT 0.01f
+
+/// Simplifies a triangle list of indices into vertices of a mesh by collapsing
+/// edges in order of their quadric error, until at most _targetIndexCount
+/// indices are left or no more edges can be collapsed without exceeding
+/// _targetError (in the mesh's space). Vertices with identical attributes are
+/// welded first. Vertices on attribute seams (e.g. UV seams or hard normals)
+/// are collapsed only along the seam, and vertices on borders of the mesh are
+/// never collapsed, so meshes with different materials stay connected without
+/// cracks. Differences of normals add to the cost of collapses. Returns indices
+/// of the remaining triangles and writes the largest geometric error of the
+/// collapsed edges into _errorOut.
+std::vector<uint32_t> SimplifyMesh(
+	const aiMesh& _mesh,
+	const std::vector<uint32_t>& _indices,
+	size_t _targetIndexCount,
+	float _targetError,
+	float& _errorOut);
+
+/// Levels of detail of a mesh, simplified with SimplifyMesh.
+struct SMeshLods
+{
+	/// Triangle lists of levels of detail after the original mesh, each
+	/// simplified from the previous one. Empty if the mesh is not a triangle
+	/// mesh and is written unchanged into all levels.
+	std::vector<std::vector<uint32_t>> Triangles;
+	/// Geometric errors of the levels in the mesh's space, accumulated over
+	/// all previous levels.
+	std::vector<float> Errors;
+};
+
+/// Generates SConfig::GetLodCount levels of detail of all triangle meshes of a
+/// scene, with target triangle ratios SConfig::LodRatios and maximum error
+/// SConfig::LodError, relative to the size of each mesh. Returns levels of
+/// detail indexed by mesh index.
+std::vector<SMeshLods> GenerateLods(const aiScene& _scene, const SConfig& _conf);
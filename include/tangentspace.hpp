@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Config.hpp>
+
+#include <assimp/scene.h>
+
+#include <cstdint>
+#include <ostream>
+
+/// Smoothing angle in degrees from which on all normals of vertices at the same
+/// position are averaged. Same as in Assimp.
+#define SMOOTHING_ANGLE_FULL 175.0f
+
+/// Generates normals of a triangle mesh that has none. Flat normals are normals
+/// of faces. Smooth normals of vertices at the same position are averaged from
+/// normals of their faces, skipping faces whose normals differ by more than
+/// _smoothingAngle (in degrees). Same as Assimp's aiProcess_GenNormals and
+/// aiProcess_GenSmoothNormals, but runs on up to _threadCount threads.
+/// Returns false if the mesh already has normals or is not a triangle mesh.
+bool GenerateNormals(aiMesh& _mesh, bool _smooth, float _smoothingAngle, uint32_t _threadCount);
+
+/// Generates tangents and bitangents of a triangle mesh with normals and
+/// texture coordinates that has none: tangents of faces are projected onto
+/// vertex normals and averaged weighted by angles of the faces' corners, over
+/// all faces sharing the position, normal and texture coordinate of the vertex
+/// with the same orientation of texture space. Bitangents are cross products
+/// of normals and tangents that point towards decreasing V, same as in Assimp,
+/// so GetBitangentSign returns the same sign as for Assimp's tangents. Same as
+/// in MikkTSpace, vertices used by faces with both orientations are split, so
+/// that each corner gets the tangent of its own orientation, which adds
+/// vertices to the mesh. Returns false if the mesh already has tangents or
+/// cannot have them.
+bool GenerateTangents(aiMesh& _mesh, uint32_t _threadCount);
+
+/// Generates normals and tangents written with _conf for all meshes of a scene
+/// that have none and writes the number of processed meshes into _log.
+void GenerateTangentSpace(aiScene& _scene, const SConfig& _conf, std::ostream& _log);
@@ -0,0 +1,5 @@
+#pragma once
+
+/// Version of yamc. Must be increased whenever output for the same input and
+/// arguments changes, as it is a part of cache keys.
+#define YAMC_VERSION "1.1.0"
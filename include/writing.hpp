@@ -1,33 +1,120 @@
 #pragma once
 
 #include <Config.hpp>
+#include <profiler.hpp>
 
 #include <assimp/scene.h>
 
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <vector>
 
+/// A contiguous byte buffer that vertex data is assembled in before it is
+/// flushed into a file with a single write.
+struct SStagingBuffer
+{
+	void Reserve(size_t _size);
+	void Flush(std::ostream& _file);
+
+	void Write(const void* _data, size_t _size)
+	{
+		size_t offset = Data.size();
+		Data.resize(offset + _size);
+		std::memcpy(Data.data() + offset, _data, _size);
+	}
+
+	std::vector<char> Data;
+};
+
 template<typename OUT, typename IN>
-void WriteSingle(std::ofstream& _file, IN _value)
+void WriteSingle(SStagingBuffer& _buffer, IN _value)
 {
 	OUT _out = (OUT)_value;
-	_file.write(reinterpret_cast<const char*>(&_out), sizeof(_out));
+	_buffer.Write(&_out, sizeof(_out));
 }
 
 template<typename OUT, typename IN>
-void WriteArray(std::ofstream& _file, IN* _values, uint32_t _length)
+void WriteArray(SStagingBuffer& _buffer, IN* _values, uint32_t _length)
 {
 	for (uint32_t i = 0; i < _length; ++i)
 	{
-		WriteSingle<OUT>(_file, _values[i]);
+		WriteSingle<OUT>(_buffer, _values[i]);
 	}
 }
 
-void WriteString(std::ofstream& _file, const char* _value);
+void WriteString(SStagingBuffer& _buffer, const char* _value);
+
+uint32_t GetVertexCount(const aiMesh& _mesh);
+
+/// A mesh placed into the scene by a node.
+struct SMeshInstance
+{
+	uint32_t MeshIndex = 0;
+	/// Accumulated transform of the node and all its parents.
+	aiMatrix4x4 Transform;
+	/// True if the transform is not identity.
+	bool Transformed = false;
+	/// True if the transform mirrors the mesh, which flips winding order of
+	/// its faces.
+	bool Mirrored = false;
+	/// Level of detail, 0 for the original mesh.
+	uint32_t Lod = 0;
+	/// Cell of the spatial grid, 0 if meshes are not split into cells.
+	uint32_t Cell = 0;
+	/// Triangles written instead of faces of the mesh, or nullptr to write
+	/// its faces.
+	const std::vector<uint32_t>* Triangles = nullptr;
+
+	/// Returns the transform or nullptr if the instance is not transformed.
+	const aiMatrix4x4* GetTransform() const { return Transformed ? &Transform : nullptr; }
+};
+
+/// Returns all instances of meshes in a scene. If SConfig::WalksNodes returns
+/// true, these are collected by walking the node hierarchy, so meshes used by multiple nodes
+/// have multiple instances and meshes used by none have none. Otherwise the
+/// scene was already flattened by aiProcess_PreTransformVertices and each mesh
+/// is a single instance without transform.
+std::vector<SMeshInstance> GetMeshInstances(const aiScene& _scene, const SConfig& _conf);
+
+/// Returns one untransformed instance for each mesh referenced by _instances,
+/// in order of their first reference.
+std::vector<SMeshInstance> GetUniqueMeshes(const aiScene& _scene, const std::vector<SMeshInstance>& _instances);
+
+/// Returns indices of vertices of a mesh in the order in which they are
+/// written, i.e. for each face (or triangle of the instance's level of
+/// detail), with winding order applied. Winding order is inverted if exactly
+/// one of _conf.InvertWinding and the instance's Mirrored is true.
+std::vector<uint32_t> GetFaceIndices(const aiMesh& _mesh, const SConfig& _conf, const SMeshInstance* _instance);
+
+/// Writes vertices of a mesh for each of its faces. If _instance is not
+/// nullptr, its transform is applied to the vertices.
+void WriteMesh(
+	SStagingBuffer& _buffer,
+	const aiScene& _scene,
+	const aiMesh& _mesh,
+	const SConfig& _conf,
+	const SMeshInstance* _instance = nullptr);
 
-void WriteMesh(std::ofstream& _file, const aiScene& _scene, const aiMesh& _mesh, const SConfig& _conf);
+/// Writes unique vertices of a mesh into _vertices and appends indices into
+/// them to _indices. Vertices are deduplicated by their encoded bytes, so
+/// vertices that end up identical in the output are written only once. If
+/// _instance is not nullptr, its transform is applied to the vertices.
+void WriteMeshIndexed(
+	SStagingBuffer& _vertices,
+	std::vector<uint32_t>& _indices,
+	const aiScene& _scene,
+	const aiMesh& _mesh,
+	const SConfig& _conf,
+	const SMeshInstance* _instance = nullptr);
 
-bool WriteScene(std::ofstream& _file, const aiScene& _scene, const SConfig& _conf);
+/// Writes all meshes of a scene into a file. If _profiler is not nullptr,
+/// durations of encoding and writing are recorded into it.
+bool WriteScene(
+	std::ostream& _file,
+	const aiScene& _scene,
+	const SConfig& _conf,
+	std::ostream& _log,
+	SProfiler* _profiler = nullptr);
@@ -1,5 +1,10 @@
 #include <Args.hpp>
+#include <cluster.hpp>
+#include <compress.hpp>
+#include <grid.hpp>
 
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 
@@ -7,7 +12,21 @@
 "Usage\n" \
 "\n" \
 "  yamc [-h] PATH_IN [PATH_OUT] [-c/-C] [-f] [-i] [-n/-N] [-p] [-t] [-u] [-2]\n" \
-"       [-y] [-z]\n" \
+"       [-y] [-z] [--indexed] [--submeshes] [--instanced] [--nodes]\n" \
+"       [--bounds] [--lod[=RATIOS]] [--lod-error=E] [--strip] [--morph]\n" \
+"       [--grid=GRID] [--clusters[=N]] [--position=ENC] [--normal=ENC]\n" \
+"       [--uv=ENC] [--optimize[=overdraw]] [--native] [--compress[=LEVEL]]\n" \
+"       [--compress-filter=FILTER]\n" \
+"       [--smoothing-angle=DEG] [--threads=N] [--cache] [--cache-dir=DIR]\n" \
+"       [--profile[=FILE]]\n" \
+"  yamc --batch INPUT... [-c/-C] [-f] [-i] [-n/-N] [-p] [-t] [-u] [-2] [-y]\n" \
+"       [-z] [--indexed] [--submeshes] [--instanced] [--nodes] [--bounds]\n" \
+"       [--lod[=RATIOS]] [--lod-error=E] [--strip] [--morph] [--grid=GRID]\n" \
+"       [--clusters[=N]] [--position=ENC] [--normal=ENC] [--uv=ENC]\n" \
+"       [--optimize[=overdraw]] [--native] [--compress[=LEVEL]]\n" \
+"       [--compress-filter=FILTER]\n" \
+"       [--smoothing-angle=DEG] [--threads=N] [--cache] [--cache-dir=DIR]\n" \
+"       [--profile[=FILE]]\n" \
 "\n" \
 "Arguments\n" \
 "\n" \
@@ -34,15 +53,480 @@
 "  -z       = Convert model to Z-up coordinate system. Uses counter-clockwise\n" \
 "             vertex winding order for backfaces!\n" \
 "\n" \
+"  --indexed = Deduplicate vertices and write them together with an index\n" \
+"              buffer into a YAMC container file. Use function\n" \
+"              vertex_buffer_load from yamc.gml to load it.\n" \
+"  --submeshes = Group meshes by material into sub-meshes, written into a YAMC\n" \
+"              container file together with a table of their materials,\n" \
+"              vertex ranges and primitive types. Use function\n" \
+"              yamc_model_load from yamc.gml to load them as separate vertex\n" \
+"              buffers.\n" \
+"  --instanced = Write each mesh only once, as a sub-mesh, together with a\n" \
+"              table of its instances in the node hierarchy and their\n" \
+"              transforms, into a YAMC container file. Use function\n" \
+"              yamc_model_load from yamc.gml to load it and\n" \
+"              yamc_model_submit to draw all instances.\n" \
+"  --nodes   = Keep the node hierarchy. Each mesh is written only once, as a\n" \
+"              sub-mesh, together with a table of nodes with their parents,\n" \
+"              local transforms, sub-meshes and bounding boxes, into a YAMC\n" \
+"              container file. Use function yamc_model_submit_nodes from\n" \
+"              yamc.gml to draw only nodes visible to the camera.\n" \
+"  --bounds  = Write bounding boxes and spheres of the model and of each of its\n" \
+"              sub-meshes into a YAMC container file. yamc_model_submit from\n" \
+"              yamc.gml then skips sub-meshes outside of the camera's\n" \
+"              frustum and yamc_model_is_visible tests the whole model.\n" \
+"  --lod     = Generate levels of detail with 50%, 25% and 12.5% of triangles,\n" \
+"              each simplified from the previous one with quadric error\n" \
+"              metrics, keeping borders of meshes and attribute seams intact.\n" \
+"              All levels are written as sub-meshes into a YAMC container\n" \
+"              file together with their errors. Use function\n" \
+"              yamc_model_select_lod from yamc.gml to pick a level by distance\n" \
+"              and yamc_model_submit_lod to draw it. Cannot be combined with\n" \
+"              --instanced or --nodes!\n" \
+"  --lod=RATIOS = Same as --lod, but with given comma-separated decreasing\n" \
+"              triangle ratios, e.g. --lod=0.5,0.2,0.05.\n" \
+"  --lod-error=E = Stop simplifying levels of detail once their error exceeds\n" \
+"              E times the size of the mesh, e.g. 0.01 for 1%. Without --lod,\n" \
+"              generates a single level simplified as far as the error allows.\n" \
+"  --strip   = Write triangles as triangle strips (pr_trianglestrip), joined\n" \
+"              with degenerate triangles, into a YAMC container file. Prints\n" \
+"              the number of vertices per triangle. Use function\n" \
+"              vertex_buffer_load or yamc_model_load from yamc.gml to load it\n" \
+"              with its primitive type.\n" \
+"  --grid=SIZE = Split the model into cells of a uniform grid with given size,\n" \
+"              for streaming large levels. Triangles are assigned to cells by\n" \
+"              their centroids. Each cell is written as a contiguous range of\n" \
+"              sub-meshes into a YAMC container file, together with its\n" \
+"              origin and bounding box. Use functions yamc_stream_open and\n" \
+"              yamc_stream_update from yamc.gml to load and unload cells\n" \
+"              around the camera asynchronously. Cannot be combined with\n" \
+"              --indexed, --instanced, --nodes or --lod!\n" \
+"  --grid=octree[:N] = Same as --grid=SIZE, but cells are leaves of an octree,\n" \
+"              subdivided until they have at most N triangles. Defaults to\n" \
+"              16384.\n" \
+"  --clusters = Split triangles of each mesh into compact clusters of at most\n" \
+"              128 triangles, each written contiguously, together with its\n" \
+"              bounding sphere and cone of normals, into a YAMC container\n" \
+"              file. Use function yamc_model_cull_clusters from yamc.gml to\n" \
+"              skip clusters that are backfacing or outside of the camera's\n" \
+"              frustum. Cannot be combined with --strip!\n" \
+"  --clusters=N = Same as --clusters, but with at most N triangles.\n" \
+"  --morph   = Write morph targets (blend shapes) of meshes as sparse deltas of\n" \
+"              only the vertices they move, with quantized position and normal\n" \
+"              offsets, into a YAMC container file. Each vertex gets an\n" \
+"              additional ubyte4 attribute addressing its deltas. Use function\n" \
+"              yamc_model_set_morph_uniforms from yamc.gml to blend them in a\n" \
+"              vertex shader from a data texture, see ShBasic.vsh. Cannot be\n" \
+"              combined with --indexed or --strip!\n" \
+"  --position=float|quantized = Encoding of vertex positions. Quantized\n" \
+"              positions are three 16-bit integers relative to the model's\n" \
+"              bounding box plus 16 bits of padding, written into a YAMC\n" \
+"              container file together with the bounding box. Defaults to\n" \
+"              float.\n" \
+"  --normal=float|snorm|oct = Encoding of normal and tangent vectors. Snorm\n" \
+"              packs them into four 8-bit signed normalized integers, oct\n" \
+"              into two 16-bit integers using octahedral mapping. Both store\n" \
+"              the bitangent sign of tangents in the spare bits. Defaults to\n" \
+"              float.\n" \
+"  --uv=float|half = Encoding of texture coordinates. Defaults to float.\n" \
+"  --optimize = Reorder triangles for the GPU's post-transform vertex cache and\n" \
+"              vertices in order of first use. Prints the average cache miss\n" \
+"              ratio (ACMR) and transform to vertex ratio (ATVR) before and\n" \
+"              after. Mostly benefits --indexed output.\n" \
+"  --optimize=overdraw = Same as --optimize, then also reorder clusters of\n" \
+"              triangles so that outward facing ones are drawn first, to\n" \
+"              reduce overdraw.\n" \
+"  --native  = Use yamc's own multithreaded implementations instead of\n" \
+"              Assimp's post-processing steps to generate missing normals and\n" \
+"              tangents (averaged by angles of faces and split at mirrored\n" \
+"              texture coordinates like MikkTSpace) and to apply transforms of\n" \
+"              nodes to meshes, which happens while writing, without copying\n" \
+"              meshes.\n" \
+"  --compress = Compress the output file into a zlib stream, which GameMaker's\n" \
+"              buffer_decompress can decompress. Blocks of the file are\n" \
+"              compressed in parallel. Function vertex_buffer_load or\n" \
+"              yamc_model_load from yamc.gml decompresses it when loading.\n" \
+"              Cannot be combined with --grid!\n" \
+"  --compress=LEVEL = Same as --compress, but with compression level from 1\n" \
+"              (fastest) to 9 (smallest). Defaults to 6.\n" \
+"  --compress-filter=shuffle|delta = Filter the output file before it is\n" \
+"              compressed. Shuffle splits bytes into planes, one for each byte\n" \
+"              of a vertex, delta then also stores differences of consecutive\n" \
+"              bytes of each plane. Both usually make files smaller, but the\n" \
+"              filter must be undone when loading, which is slow in GML.\n" \
+"  --smoothing-angle=DEG = Smooth normals generated with -N are averaged only\n" \
+"              over faces whose normals differ by at most DEG degrees.\n" \
+"              Defaults to 175, which averages all of them.\n" \
+"  --threads=N = Number of threads used to encode meshes, or to convert files\n" \
+"              in batch mode. Defaults to the number of CPU cores.\n" \
+"  --batch   = Convert multiple files in a single process. Each INPUT is a\n" \
+"              model file, a directory (all supported files in it), a wildcard\n" \
+"              pattern like models/*.fbx or @MANIFEST, a text file with one\n" \
+"              input path per line, optionally followed by a tab and an\n" \
+"              output path. Outputs default to inputs with \".bin\" extension.\n" \
+"              Existing outputs are skipped unless -y is passed.\n" \
+"  --cache   = Write a cache manifest next to the output file and skip the\n" \
+"              conversion if neither the input files, nor the arguments\n" \
+"              changed since. Outputs with a manifest are overridden without\n" \
+"              asking.\n" \
+"  --cache-dir=DIR = Same as --cache, but also store outputs in directory DIR\n" \
+"              and reuse them for identical inputs and arguments.\n" \
+"  --profile = Print durations of all stages of the conversion: import (and\n" \
+"              reading files within it), each post-processing step, encoding\n" \
+"              and writing. Post-processing steps are run one at a time.\n" \
+"  --profile=FILE = Same as --profile, but also write the durations into a\n" \
+"              Chrome trace JSON file, viewable in chrome://tracing or\n" \
+"              Perfetto.\n" \
+"\n" \
 "If you do not pass any arguments that affect vertex format, arguments pNufC are\n" \
 "used. These make a model that is compatible with GM's built-in shaders."
 
+/// Returns the value of a long option in form --name=value or nullptr if _arg
+/// is not the given option.
+static const char* GetOptionValue(const char* _arg, const char* _name)
+{
+	size_t length = strlen(_name);
+	if (strncmp(_arg, _name, length) == 0 && _arg[length] == '=')
+	{
+		return _arg + length + 1;
+	}
+	return nullptr;
+}
+
 bool ParseArgs(int _argc, const char** _argv, SArgs& _argsOut)
 {
 	for (int i = 1; i < _argc; ++i)
 	{
 		const char* arg = _argv[i];
 
+		if (arg[0] == '-' && arg[1] == '-')
+		{
+			const char* value = nullptr;
+
+			if (strcmp(arg, "--indexed") == 0)
+			{
+				_argsOut.Indexed = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--strip") == 0)
+			{
+				_argsOut.Strip = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--morph") == 0)
+			{
+				_argsOut.Morph = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--submeshes") == 0)
+			{
+				_argsOut.SubMeshes = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--instanced") == 0)
+			{
+				_argsOut.Instanced = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--nodes") == 0)
+			{
+				_argsOut.Nodes = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--bounds") == 0)
+			{
+				_argsOut.Bounds = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--lod") == 0)
+			{
+				_argsOut.LodRatios = { 0.5f, 0.25f, 0.125f };
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--lod")) != nullptr)
+			{
+				_argsOut.LodRatios.clear();
+				const char* begin = value;
+				while (true)
+				{
+					char* end = nullptr;
+					float ratio = strtof(begin, &end);
+					if (end == begin || (*end != ',' && *end != '\0')
+						|| !(ratio > 0.0f && ratio < 1.0f)
+						|| (!_argsOut.LodRatios.empty() && ratio >= _argsOut.LodRatios.back()))
+					{
+						std::cout << "ERROR: Invalid level of detail ratios " << value << "!" << std::endl;
+						return false;
+					}
+					_argsOut.LodRatios.push_back(ratio);
+					if (*end == '\0')
+					{
+						break;
+					}
+					begin = end + 1;
+				}
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--lod-error")) != nullptr)
+			{
+				char* end = nullptr;
+				float error = strtof(value, &end);
+				if (end == value || *end != '\0' || !(error > 0.0f))
+				{
+					std::cout << "ERROR: Invalid level of detail error " << value << "!" << std::endl;
+					return false;
+				}
+				_argsOut.LodError = error;
+				continue;
+			}
+
+			if (strcmp(arg, "--optimize") == 0)
+			{
+				_argsOut.Optimization = EOptimization::VertexCache;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--grid")) != nullptr)
+			{
+				char* end = nullptr;
+				if (strncmp(value, "octree", 6) == 0)
+				{
+					_argsOut.Grid = EGrid::Octree;
+					_argsOut.GridCellTriangles = GRID_OCTREE_CELL_TRIANGLES;
+					if (value[6] == ':')
+					{
+						long triangles = strtol(value + 7, &end, 10);
+						if (end == value + 7 || *end != '\0' || triangles <= 0)
+						{
+							std::cout << "ERROR: Invalid grid " << value << "!" << std::endl;
+							return false;
+						}
+						_argsOut.GridCellTriangles = (uint32_t)triangles;
+					}
+					else if (value[6] != '\0')
+					{
+						std::cout << "ERROR: Invalid grid " << value << "!" << std::endl;
+						return false;
+					}
+				}
+				else
+				{
+					float size = strtof(value, &end);
+					if (end == value || *end != '\0' || !(size > 0.0f))
+					{
+						std::cout << "ERROR: Invalid grid " << value << "!" << std::endl;
+						return false;
+					}
+					_argsOut.Grid = EGrid::Uniform;
+					_argsOut.GridCellSize = size;
+				}
+				continue;
+			}
+
+			if (strcmp(arg, "--clusters") == 0)
+			{
+				_argsOut.ClusterTriangles = CLUSTER_TRIANGLES;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--clusters")) != nullptr)
+			{
+				char* end = nullptr;
+				long triangles = strtol(value, &end, 10);
+				if (end == value || *end != '\0' || triangles <= 0 || triangles > 0xFFFF)
+				{
+					std::cout << "ERROR: Invalid number of cluster triangles " << value << "!" << std::endl;
+					return false;
+				}
+				_argsOut.ClusterTriangles = (uint32_t)triangles;
+				continue;
+			}
+
+			if (strcmp(arg, "--compress") == 0)
+			{
+				_argsOut.CompressionLevel = COMPRESSION_LEVEL;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--compress")) != nullptr)
+			{
+				char* end = nullptr;
+				long level = strtol(value, &end, 10);
+				if (end == value || *end != '\0' || level < 1 || level > 9)
+				{
+					std::cout << "ERROR: Invalid compression level " << value << "!" << std::endl;
+					return false;
+				}
+				_argsOut.CompressionLevel = (uint32_t)level;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--compress-filter")) != nullptr)
+			{
+				if (strcmp(value, "shuffle") == 0)
+				{
+					_argsOut.CompressionFilter = ECompressionFilter::Shuffle;
+				}
+				else if (strcmp(value, "delta") == 0)
+				{
+					_argsOut.CompressionFilter = ECompressionFilter::Delta;
+				}
+				else
+				{
+					std::cout << "ERROR: Invalid compression filter " << value << "!" << std::endl;
+					return false;
+				}
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--optimize")) != nullptr)
+			{
+				if (strcmp(value, "overdraw") == 0)
+				{
+					_argsOut.Optimization = EOptimization::Overdraw;
+				}
+				else
+				{
+					std::cout << "ERROR: Invalid optimization " << value << "!" << std::endl;
+					return false;
+				}
+				continue;
+			}
+
+			if (strcmp(arg, "--native") == 0)
+			{
+				_argsOut.Native = true;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--smoothing-angle")) != nullptr)
+			{
+				char* end = nullptr;
+				float angle = strtof(value, &end);
+				if (end == value || *end != '\0' || !(angle >= 0.0f && angle <= 180.0f))
+				{
+					std::cout << "ERROR: Invalid smoothing angle " << value << "!" << std::endl;
+					return false;
+				}
+				_argsOut.SmoothingAngle = angle;
+				continue;
+			}
+
+			if (strcmp(arg, "--batch") == 0)
+			{
+				_argsOut.Batch = true;
+				continue;
+			}
+
+			if (strcmp(arg, "--cache") == 0)
+			{
+				_argsOut.Cache = true;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--cache-dir")) != nullptr)
+			{
+				_argsOut.Cache = true;
+				_argsOut.CacheDir = value;
+				continue;
+			}
+
+			if (strcmp(arg, "--profile") == 0)
+			{
+				_argsOut.Profile = true;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--profile")) != nullptr)
+			{
+				_argsOut.Profile = true;
+				_argsOut.ProfileTrace = value;
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--position")) != nullptr)
+			{
+				if (strcmp(value, "float") == 0)
+				{
+					_argsOut.PositionEncoding = EPositionEncoding::Float;
+				}
+				else if (strcmp(value, "quantized") == 0)
+				{
+					_argsOut.PositionEncoding = EPositionEncoding::Quantized;
+				}
+				else
+				{
+					std::cout << "ERROR: Invalid position encoding " << value << "!" << std::endl;
+					return false;
+				}
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--normal")) != nullptr)
+			{
+				if (strcmp(value, "float") == 0)
+				{
+					_argsOut.VectorEncoding = EVectorEncoding::Float;
+				}
+				else if (strcmp(value, "snorm") == 0)
+				{
+					_argsOut.VectorEncoding = EVectorEncoding::SNorm;
+				}
+				else if (strcmp(value, "oct") == 0)
+				{
+					_argsOut.VectorEncoding = EVectorEncoding::Octahedral;
+				}
+				else
+				{
+					std::cout << "ERROR: Invalid normal encoding " << value << "!" << std::endl;
+					return false;
+				}
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--uv")) != nullptr)
+			{
+				if (strcmp(value, "float") == 0)
+				{
+					_argsOut.TexCoordEncoding = ETexCoordEncoding::Float;
+				}
+				else if (strcmp(value, "half") == 0)
+				{
+					_argsOut.TexCoordEncoding = ETexCoordEncoding::Half;
+				}
+				else
+				{
+					std::cout << "ERROR: Invalid texture coordinate encoding " << value << "!" << std::endl;
+					return false;
+				}
+				continue;
+			}
+
+			if ((value = GetOptionValue(arg, "--threads")) != nullptr)
+			{
+				int threadCount = atoi(value);
+				if (threadCount <= 0)
+				{
+					std::cout << "ERROR: Invalid number of threads " << value << "!" << std::endl;
+					return false;
+				}
+				_argsOut.ThreadCount = (uint32_t)threadCount;
+				continue;
+			}
+
+			std::cout << "ERROR: Invalid argument " << arg << "!" << std::endl;
+			return false;
+		}
+
 		if (arg[0] == '-')
 		{
 			for (size_t j = strlen(arg) - 1; j > 0; --j)
@@ -129,23 +613,8 @@ bool ParseArgs(int _argc, const char** _argv, SArgs& _argsOut)
 
 			continue;
 		}
-		else
-		{
-			if (_argsOut.PathIn == nullptr)
-			{
-				_argsOut.PathIn = arg;
-				continue;
-			}
 
-			if (_argsOut.PathOut == nullptr)
-			{
-				_argsOut.PathOut = arg;
-				continue;
-			}
-		}
-
-		std::cout << "ERROR: Invalid argument " << arg << "!" << std::endl;
-		return false;
+		_argsOut.Paths.push_back(arg);
 	}
 
 	if (_argsOut.ShowHelpAndExit)
@@ -154,12 +623,70 @@ bool ParseArgs(int _argc, const char** _argv, SArgs& _argsOut)
 		return false;
 	}
 
-	if (_argsOut.PathIn == nullptr)
+	if ((!_argsOut.LodRatios.empty() || _argsOut.LodError > 0.0f)
+		&& (_argsOut.Instanced || _argsOut.Nodes))
+	{
+		std::cout << "ERROR: Cannot combine arguments --lod and --lod-error with --instanced or --nodes!" << std::endl;
+		return false;
+	}
+
+	if (_argsOut.Grid != EGrid::None
+		&& (_argsOut.Indexed || _argsOut.Instanced || _argsOut.Nodes
+			|| !_argsOut.LodRatios.empty() || _argsOut.LodError > 0.0f))
+	{
+		std::cout << "ERROR: Cannot combine argument --grid with --indexed, --instanced, --nodes, --lod or --lod-error!" << std::endl;
+		return false;
+	}
+
+	if (_argsOut.ClusterTriangles > 0 && _argsOut.Strip)
+	{
+		std::cout << "ERROR: Cannot combine arguments --clusters and --strip!" << std::endl;
+		return false;
+	}
+
+	if (_argsOut.Morph && (_argsOut.Indexed || _argsOut.Strip))
+	{
+		std::cout << "ERROR: Cannot combine argument --morph with --indexed or --strip!" << std::endl;
+		return false;
+	}
+
+	if (_argsOut.CompressionFilter != ECompressionFilter::None && _argsOut.CompressionLevel == 0)
+	{
+		std::cout << "ERROR: Argument --compress-filter requires --compress!" << std::endl;
+		return false;
+	}
+
+	if (_argsOut.CompressionLevel > 0 && _argsOut.Grid != EGrid::None)
+	{
+		std::cout << "ERROR: Cannot combine arguments --compress and --grid!" << std::endl;
+		return false;
+	}
+
+	if (_argsOut.Batch)
+	{
+		if (_argsOut.Paths.empty())
+		{
+			std::cout << "ERROR: No input files specified!" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	if (_argsOut.Paths.size() > 2)
+	{
+		std::cout << "ERROR: Invalid argument " << _argsOut.Paths[2] << "!" << std::endl;
+		return false;
+	}
+
+	if (_argsOut.Paths.empty())
 	{
 		std::cout << "ERROR: Input file not specified!" << std::endl;
 		return false;
 	}
 
+	_argsOut.PathIn = _argsOut.Paths[0];
+	_argsOut.PathOut = (_argsOut.Paths.size() > 1) ? _argsOut.Paths[1] : nullptr;
+
 	if (_argsOut.PathOut == nullptr)
 	{
 		_argsOut.PathOut = strdup(std::filesystem::path(_argsOut.PathIn)
@@ -1,11 +1,15 @@
 #include <Config.hpp>
 
+#include <assimp/config.h>
 #include <assimp/postprocess.h>
 
+#include <sstream>
+
 void SConfig::Clear()
 {
 	WritePositions = false;
 	WriteNormals = false;
+	SmoothNormals = false;
 	WriteTextureCoords = false;
 	WriteTextureCoords2 = false;
 	WriteColors = false;
@@ -14,13 +18,42 @@ void SConfig::Clear()
 	UpVector = EAxis::NegativeY;
 	FlipUVs = false;
 	InvertWinding = false;
+	Indexed = false;
+	SubMeshes = false;
+	Instanced = false;
+	Nodes = false;
+	Bounds = false;
+	Strip = false;
+	Morph = false;
+	LodRatios.clear();
+	LodError = 0.0f;
+	Grid = EGrid::None;
+	GridCellSize = 0.0f;
+	GridCellTriangles = 0;
+	ClusterTriangles = 0;
+	CompressionLevel = 0;
+	CompressionFilter = ECompressionFilter::None;
+	PositionEncoding = EPositionEncoding::Float;
+	VectorEncoding = EVectorEncoding::Float;
+	TexCoordEncoding = ETexCoordEncoding::Float;
+	PositionBounds = aiAABB();
+	Optimization = EOptimization::None;
+	Native = false;
+	SmoothingAngle = 175.0f;
+	ThreadCount = 0;
+	Cache = false;
+	CacheDir.clear();
+	Profile = false;
+	ProfileTrace.clear();
 	Flags = 0;
+	RemoveComponents = 0;
 }
 
 void SConfig::Default()
 {
 	WritePositions = true;
 	WriteNormals = true;
+	SmoothNormals = true;
 	WriteTextureCoords = true;
 	WriteTextureCoords2 = false;
 	WriteColors = false;
@@ -29,21 +62,39 @@ void SConfig::Default()
 	UpVector = EAxis::NegativeY;
 	FlipUVs = true;
 	InvertWinding = false;
+	Indexed = false;
+	SubMeshes = false;
+	Instanced = false;
+	Nodes = false;
+	Bounds = false;
+	Strip = false;
+	Morph = false;
+	LodRatios.clear();
+	LodError = 0.0f;
+	Grid = EGrid::None;
+	GridCellSize = 0.0f;
+	GridCellTriangles = 0;
+	ClusterTriangles = 0;
+	CompressionLevel = 0;
+	CompressionFilter = ECompressionFilter::None;
+	PositionEncoding = EPositionEncoding::Float;
+	VectorEncoding = EVectorEncoding::Float;
+	TexCoordEncoding = ETexCoordEncoding::Float;
+	PositionBounds = aiAABB();
+	Optimization = EOptimization::None;
+	Native = false;
+	SmoothingAngle = 175.0f;
+	ThreadCount = 0;
+	Cache = false;
+	CacheDir.clear();
+	Profile = false;
+	ProfileTrace.clear();
 	Flags = 0;
+	RemoveComponents = 0;
 }
 
 void SConfig::FromArgs(const SArgs& _args)
 {
-	uint32_t flagsCommon = 0
-		| aiProcess_Triangulate
-		| aiProcess_SortByPType
-		| aiProcess_PreTransformVertices
-		| aiProcess_GenUVCoords
-		| aiProcess_GlobalScale
-		| aiProcess_CalcTangentSpace
-		| aiProcess_FlipWindingOrder
-		;
-
 	if (false
 		|| _args.WritePositions
 		|| _args.WriteNormals
@@ -55,36 +106,19 @@ void SConfig::FromArgs(const SArgs& _args)
 		|| _args.WriteTangents)
 	{
 		Clear();
-		Flags = flagsCommon;
 
 		WritePositions = _args.WritePositions;
-
-		if (_args.WriteNormals)
-		{
-			WriteNormals = true;
-			Flags |= aiProcess_FindInvalidData | aiProcess_GenNormals;
-		}
-		else if (_args.WriteSmoothNormals)
-		{
-			WriteNormals = true;
-			Flags |= aiProcess_FindInvalidData | aiProcess_GenSmoothNormals;
-		}
-
+		WriteNormals = _args.WriteNormals || _args.WriteSmoothNormals;
+		SmoothNormals = _args.WriteSmoothNormals;
 		WriteTextureCoords = _args.WriteTextureCoords;
 		WriteTextureCoords2 = _args.WriteTextureCoords2;
-
 		WriteColors = _args.WriteColors;
 		WriteMaterialColors = _args.WriteMaterialColors;
-
 		WriteTangents = _args.WriteTangents;
 	}
 	else
 	{
 		Default();
-		Flags = flagsCommon
-			| aiProcess_FindInvalidData
-			| aiProcess_GenSmoothNormals
-			;
 	}
 
 	if (_args.ConvertToZUp)
@@ -94,4 +128,217 @@ void SConfig::FromArgs(const SArgs& _args)
 
 	FlipUVs = _args.FlipUVs;
 	InvertWinding = _args.InvertWinding;
+	Indexed = _args.Indexed;
+	SubMeshes = _args.SubMeshes;
+	Instanced = _args.Instanced;
+	Nodes = _args.Nodes;
+	Bounds = _args.Bounds;
+	Strip = _args.Strip;
+	Morph = _args.Morph;
+	LodRatios = _args.LodRatios;
+	LodError = _args.LodError;
+	Grid = _args.Grid;
+	GridCellSize = _args.GridCellSize;
+	GridCellTriangles = _args.GridCellTriangles;
+	ClusterTriangles = _args.ClusterTriangles;
+	CompressionLevel = _args.CompressionLevel;
+	CompressionFilter = _args.CompressionFilter;
+	PositionEncoding = _args.PositionEncoding;
+	VectorEncoding = _args.VectorEncoding;
+	TexCoordEncoding = _args.TexCoordEncoding;
+	Optimization = _args.Optimization;
+	Native = _args.Native;
+	SmoothingAngle = _args.SmoothingAngle;
+	ThreadCount = _args.ThreadCount;
+	Cache = _args.Cache;
+	CacheDir = _args.CacheDir ? _args.CacheDir : "";
+	Profile = _args.Profile;
+	ProfileTrace = _args.ProfileTrace ? _args.ProfileTrace : "";
+
+	PlanPostProcessing();
+}
+
+void SConfig::PlanPostProcessing()
+{
+	Flags = 0
+		| aiProcess_Triangulate
+		| aiProcess_SortByPType
+		| aiProcess_GlobalScale
+		| aiProcess_FlipWindingOrder
+		| aiProcess_RemoveComponent
+		;
+
+	if (!WalksNodes())
+	{
+		Flags |= aiProcess_PreTransformVertices;
+	}
+
+	if (WriteNormals)
+	{
+		Flags |= aiProcess_FindInvalidData;
+		if (!Native)
+		{
+			Flags |= SmoothNormals ? aiProcess_GenSmoothNormals : aiProcess_GenNormals;
+		}
+	}
+
+	// Tangents are computed from the first texture coordinate layer, which may
+	// itself need to be generated from a mapping
+	bool useTexCoords = (WriteTextureCoords || WriteTextureCoords2 || WriteTangents);
+
+	if (useTexCoords)
+	{
+		Flags |= aiProcess_GenUVCoords;
+	}
+
+	if (WriteTangents && !Native)
+	{
+		Flags |= aiProcess_CalcTangentSpace;
+	}
+
+	// Nothing but meshes and materials is ever written
+	RemoveComponents = 0
+		| aiComponent_BONEWEIGHTS
+		| aiComponent_ANIMATIONS
+		| aiComponent_TEXTURES
+		| aiComponent_LIGHTS
+		| aiComponent_CAMERAS
+		;
+
+	// Normals are needed to compute tangents, even if they are not written
+	if (!WriteNormals && !WriteTangents)
+	{
+		RemoveComponents |= aiComponent_NORMALS;
+	}
+
+	if (!WriteTangents)
+	{
+		RemoveComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
+	}
+
+	if (!useTexCoords)
+	{
+		RemoveComponents |= aiComponent_TEXCOORDS;
+	}
+	else
+	{
+		// Removing a layer moves the following ones down, so only layers after
+		// the last used one can be removed. Flags exist only for layers up to 6.
+		for (uint32_t i = WriteTextureCoords2 ? 2 : 1; i <= 6; ++i)
+		{
+			RemoveComponents |= aiComponent_TEXCOORDSn(i);
+		}
+	}
+
+	if (!WriteColors)
+	{
+		RemoveComponents |= aiComponent_COLORS;
+	}
+	else
+	{
+		// Flags exist only for color sets up to 4
+		for (uint32_t i = 1; i <= 4; ++i)
+		{
+			RemoveComponents |= aiComponent_COLORSn(i);
+		}
+	}
+}
+
+uint32_t SConfig::GetVertexSize() const
+{
+	uint32_t positionSize = (PositionEncoding == EPositionEncoding::Float) ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+	uint32_t normalSize = (VectorEncoding == EVectorEncoding::Float) ? 3 * sizeof(float) : sizeof(uint32_t);
+	uint32_t texCoordSize = (TexCoordEncoding == ETexCoordEncoding::Float) ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+	uint32_t tangentSize = (VectorEncoding == EVectorEncoding::Float) ? 4 * sizeof(float) : sizeof(uint32_t);
+
+	uint32_t size = 0;
+	if (WritePositions) size += positionSize;
+	if (WriteNormals) size += normalSize;
+	if (WriteTextureCoords) size += texCoordSize;
+	if (WriteTextureCoords2) size += texCoordSize;
+	if (WriteColors || WriteMaterialColors) size += sizeof(uint32_t);
+	if (WriteTangents) size += tangentSize;
+	if (Morph) size += sizeof(uint32_t);
+	return size;
+}
+
+bool SConfig::IsContainer() const
+{
+	return (Indexed
+		|| SubMeshes
+		|| Instanced
+		|| Nodes
+		|| Bounds
+		|| Strip
+		|| Morph
+		|| Grid != EGrid::None
+		|| ClusterTriangles > 0
+		|| GetLodCount() > 0
+		|| (WritePositions && PositionEncoding == EPositionEncoding::Quantized));
+}
+
+bool SConfig::WalksNodes() const
+{
+	return (Native || Morph || WritesMeshesOnce());
+}
+
+bool SConfig::WritesMeshesOnce() const
+{
+	return (Instanced || Nodes);
+}
+
+uint32_t SConfig::GetLodCount() const
+{
+	if (!LodRatios.empty())
+	{
+		return (uint32_t)LodRatios.size();
+	}
+	return (LodError > 0.0f) ? 1 : 0;
+}
+
+std::string SConfig::Serialize() const
+{
+	std::ostringstream ss;
+	ss
+		<< "WritePositions=" << WritePositions << ";"
+		<< "WriteNormals=" << WriteNormals << ";"
+		<< "WriteTextureCoords=" << WriteTextureCoords << ";"
+		<< "WriteTextureCoords2=" << WriteTextureCoords2 << ";"
+		<< "WriteColors=" << WriteColors << ";"
+		<< "WriteMaterialColors=" << WriteMaterialColors << ";"
+		<< "WriteTangents=" << WriteTangents << ";"
+		<< "UpVector=" << (int)UpVector << ";"
+		<< "FlipUVs=" << FlipUVs << ";"
+		<< "InvertWinding=" << InvertWinding << ";"
+		<< "Indexed=" << Indexed << ";"
+		<< "SubMeshes=" << SubMeshes << ";"
+		<< "Instanced=" << Instanced << ";"
+		<< "Nodes=" << Nodes << ";"
+		<< "Bounds=" << Bounds << ";"
+		<< "Strip=" << Strip << ";"
+		<< "Morph=" << Morph << ";"
+		<< "LodRatios=";
+	for (float ratio : LodRatios)
+	{
+		ss << ratio << ",";
+	}
+	ss
+		<< ";"
+		<< "LodError=" << LodError << ";"
+		<< "Grid=" << (int)Grid << ";"
+		<< "GridCellSize=" << GridCellSize << ";"
+		<< "GridCellTriangles=" << GridCellTriangles << ";"
+		<< "ClusterTriangles=" << ClusterTriangles << ";"
+		<< "CompressionLevel=" << CompressionLevel << ";"
+		<< "CompressionFilter=" << (int)CompressionFilter << ";"
+		<< "PositionEncoding=" << (int)PositionEncoding << ";"
+		<< "VectorEncoding=" << (int)VectorEncoding << ";"
+		<< "TexCoordEncoding=" << (int)TexCoordEncoding << ";"
+		<< "Optimization=" << (int)Optimization << ";"
+		<< "Native=" << Native << ";"
+		<< "SmoothNormals=" << SmoothNormals << ";"
+		<< "SmoothingAngle=" << SmoothingAngle << ";"
+		<< "Flags=" << Flags << ";"
+		<< "RemoveComponents=" << RemoveComponents << ";";
+	return ss.str();
 }
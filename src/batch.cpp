@@ -0,0 +1,289 @@
+#include <batch.hpp>
+#include <cache.hpp>
+#include <convert.hpp>
+#include <parallel.hpp>
+#include <profiler.hpp>
+
+#include <assimp/Importer.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct SBatchItem
+{
+	fs::path PathIn;
+	fs::path PathOut;
+};
+
+/// Matches a string against a pattern with wildcards * and ?.
+static bool MatchWildcard(const char* _pattern, const char* _string)
+{
+	const char* star = nullptr;
+	const char* resume = nullptr;
+	while (*_string)
+	{
+		if (*_pattern == '*')
+		{
+			star = _pattern++;
+			resume = _string;
+		}
+		else if (*_pattern == '?' || *_pattern == *_string)
+		{
+			++_pattern;
+			++_string;
+		}
+		else if (star)
+		{
+			_pattern = star + 1;
+			_string = ++resume;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while (*_pattern == '*')
+	{
+		++_pattern;
+	}
+	return (*_pattern == '\0');
+}
+
+static void AddItem(std::vector<SBatchItem>& _items, const fs::path& _pathIn, const fs::path& _pathOut)
+{
+	SBatchItem item;
+	item.PathIn = _pathIn.lexically_normal();
+	item.PathOut = _pathOut.empty() ? fs::path(item.PathIn).replace_extension(".bin") : _pathOut.lexically_normal();
+	_items.push_back(item);
+}
+
+static bool AddManifest(std::vector<SBatchItem>& _items, const fs::path& _path)
+{
+	std::ifstream file(_path);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR: Could not open manifest " << _path.string() << "!" << std::endl;
+		return false;
+	}
+
+	// Relative paths are relative to the manifest
+	fs::path directory = _path.parent_path();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		size_t tab = line.find('\t');
+		fs::path pathIn = directory / line.substr(0, tab);
+		fs::path pathOut = (tab != std::string::npos) ? directory / line.substr(tab + 1) : fs::path();
+		AddItem(_items, pathIn, pathOut);
+	}
+
+	return true;
+}
+
+static bool CollectItems(
+	std::vector<SBatchItem>& _items,
+	const SArgs& _args,
+	const Assimp::Importer& _importer)
+{
+	for (const char* arg : _args.Paths)
+	{
+		if (arg[0] == '@')
+		{
+			if (!AddManifest(_items, fs::path(arg + 1)))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		fs::path path(arg);
+		std::string filename = path.filename().string();
+		bool isPattern = (filename.find_first_of("*?") != std::string::npos);
+
+		if (!isPattern && !fs::is_directory(path))
+		{
+			AddItem(_items, path, fs::path());
+			continue;
+		}
+
+		fs::path directory = isPattern ? path.parent_path() : path;
+		if (directory.empty())
+		{
+			directory = ".";
+		}
+
+		std::error_code error;
+		std::vector<fs::path> found;
+		for (const fs::directory_entry& entry : fs::directory_iterator(directory, error))
+		{
+			if (!entry.is_regular_file())
+			{
+				continue;
+			}
+
+			const fs::path& entryPath = entry.path();
+			if (isPattern
+				? MatchWildcard(filename.c_str(), entryPath.filename().string().c_str())
+				: _importer.IsExtensionSupported(entryPath.extension().string()))
+			{
+				found.push_back(entryPath);
+			}
+		}
+
+		if (error)
+		{
+			std::cout << "ERROR: Could not read directory " << directory.string() << "!" << std::endl;
+			return false;
+		}
+
+		// Directory iteration order is unspecified
+		std::sort(found.begin(), found.end());
+		for (const fs::path& entryPath : found)
+		{
+			AddItem(_items, entryPath, fs::path());
+		}
+	}
+
+	// Files matched by multiple inputs would be written concurrently
+	std::set<fs::path> outputs;
+	_items.erase(std::remove_if(_items.begin(), _items.end(), [&](const SBatchItem& _item)
+	{
+		return !outputs.insert(_item.PathOut).second;
+	}), _items.end());
+
+	return true;
+}
+
+int RunBatch(const SArgs& _args, const SConfig& _conf)
+{
+	// One importer per worker thread, created lazily
+	std::vector<std::unique_ptr<Assimp::Importer>> importers(1);
+	importers[0] = std::make_unique<Assimp::Importer>();
+
+	std::vector<SBatchItem> items;
+	if (!CollectItems(items, _args, *importers[0]))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (items.empty())
+	{
+		std::cout << "INFO: No input files found, quitting..." << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	// Files are converted in parallel, so meshes within each are not
+	SConfig conf = _conf;
+	conf.ThreadCount = 1;
+
+	uint32_t itemCount = (uint32_t)items.size();
+	importers.resize(GetWorkerCount(itemCount, _conf.ThreadCount));
+	std::vector<EConvertResult> results(itemCount, EConvertResult::Failed);
+	std::mutex logMutex;
+
+	// Stages of all files converted, each worker on its own track
+	SProfiler trace;
+
+	ParallelForWorkers(itemCount, _conf.ThreadCount, [&](uint32_t _worker, uint32_t _i)
+	{
+		const SBatchItem& item = items[_i];
+		std::ostringstream log;
+		SProfiler profiler;
+
+		std::string pathIn = item.PathIn.string();
+		std::string pathOut = item.PathOut.string();
+
+		if (conf.Cache && IsCacheUpToDate(pathIn.c_str(), pathOut.c_str(), conf))
+		{
+			log << "INFO: Output file " << pathOut << " is up to date, skipping..." << std::endl;
+			results[_i] = EConvertResult::Skipped;
+		}
+		else if (!_args.OverrideOutputFile
+			&& fs::exists(item.PathOut)
+			&& !(conf.Cache && HasCacheManifest(pathOut.c_str())))
+		{
+			log << "INFO: Output file " << pathOut << " already exists, skipping..." << std::endl;
+			results[_i] = EConvertResult::Skipped;
+		}
+		else
+		{
+			if (!importers[_worker])
+			{
+				importers[_worker] = std::make_unique<Assimp::Importer>();
+			}
+			results[_i] = ConvertFile(*importers[_worker], pathIn.c_str(), pathOut.c_str(), conf, log,
+				conf.Profile ? &profiler : nullptr);
+		}
+
+		if (conf.Profile && !profiler.Events.empty())
+		{
+			profiler.PrintBreakdown(log);
+		}
+
+		std::lock_guard<std::mutex> lock(logMutex);
+		if (!conf.ProfileTrace.empty())
+		{
+			trace.Merge(profiler, pathIn, _worker);
+		}
+		std::cout << "[" << (_i + 1) << "/" << itemCount << "] " << item.PathIn.string() << std::endl
+			<< log.str() << std::endl;
+	});
+
+	uint32_t succeeded = 0;
+	uint32_t skipped = 0;
+	uint32_t failed = 0;
+	for (uint32_t i = 0; i < itemCount; ++i)
+	{
+		switch (results[i])
+		{
+		case EConvertResult::Success:
+			++succeeded;
+			break;
+
+		case EConvertResult::Skipped:
+			++skipped;
+			break;
+
+		case EConvertResult::Failed:
+			++failed;
+			std::cout << "FAILED: " << items[i].PathIn.string() << std::endl;
+			break;
+		}
+	}
+
+	std::cout << "Batch finished: " << succeeded << " converted, " << skipped << " skipped, "
+		<< failed << " failed" << std::endl;
+
+	if (!conf.ProfileTrace.empty())
+	{
+		if (!trace.WriteChromeTrace(conf.ProfileTrace))
+		{
+			std::cout << "ERROR: Could not write trace " << conf.ProfileTrace << "!" << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "INFO: Wrote trace to " << conf.ProfileTrace << std::endl;
+	}
+
+	return (failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
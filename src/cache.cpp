@@ -0,0 +1,352 @@
+#include <cache.hpp>
+#include <hash.hpp>
+#include <version.hpp>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+#define CACHE_MANIFEST_EXTENSION ".yamc-cache"
+#define CACHE_MANIFEST_HEADER "yamc-cache 2"
+
+struct SCacheManifest
+{
+	std::string Input;
+	uint64_t Key = 0;
+	std::vector<std::string> Dependencies;
+};
+
+static std::string KeyToString(uint64_t _key)
+{
+	char str[17];
+	snprintf(str, sizeof(str), "%016llx", (unsigned long long)_key);
+	return str;
+}
+
+static fs::path GetManifestPath(const char* _pathOut)
+{
+	return fs::path(std::string(_pathOut) + CACHE_MANIFEST_EXTENSION);
+}
+
+static std::string GetAbsolutePath(const char* _path)
+{
+	std::error_code error;
+	return fs::absolute(fs::path(_path), error).lexically_normal().string();
+}
+
+/// Returns the directory of the input, which paths of its dependencies in the
+/// cache directory are relative to.
+static fs::path GetInputDirectory(const char* _pathIn)
+{
+	return fs::path(GetAbsolutePath(_pathIn)).parent_path();
+}
+
+/// Returns the path of a dependency relative to _inputDir, or the path itself
+/// if there is no relative path (e.g. it is on a different drive).
+static std::string MakeRelative(const std::string& _path, const fs::path& _inputDir)
+{
+	fs::path relative = fs::path(_path).lexically_relative(_inputDir);
+	return relative.empty() ? _path : relative.generic_string();
+}
+
+static std::string ResolveRelative(const std::string& _path, const fs::path& _inputDir)
+{
+	return (_inputDir / fs::path(_path)).lexically_normal().string();
+}
+
+/// Hashes contents of a file only, so that identical files have the same hash
+/// regardless of where they are.
+static bool HashFile(const std::string& _path, uint64_t& _hash)
+{
+	std::ifstream file(_path, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::vector<char> buffer(1 << 20);
+	while (file)
+	{
+		file.read(buffer.data(), buffer.size());
+		_hash = HashBytes(buffer.data(), (size_t)file.gcount(), _hash);
+	}
+	return true;
+}
+
+/// Hashes contents of the input file, the configuration and the version of
+/// yamc. The path of the input is not a part of the key, so outputs in the
+/// cache directory are addressed by contents only.
+static bool GetInputKey(const char* _pathIn, const SConfig& _conf, uint64_t& _key)
+{
+	std::string conf = _conf.Serialize();
+	_key = HashBytes(YAMC_VERSION, sizeof(YAMC_VERSION));
+	_key = HashBytes(conf.data(), conf.size(), _key);
+	return HashFile(GetAbsolutePath(_pathIn), _key);
+}
+
+/// Hashes the input key and all files that the input depends on, with their
+/// paths relative to the input, since the input references them by those.
+static bool GetFullKey(
+	uint64_t _inputKey,
+	const fs::path& _inputDir,
+	const std::vector<std::string>& _dependencies,
+	uint64_t& _key)
+{
+	_key = _inputKey;
+	for (const std::string& dependency : _dependencies)
+	{
+		std::string relative = MakeRelative(dependency, _inputDir);
+		_key = HashBytes(relative.data(), relative.size(), _key);
+		if (!HashFile(dependency, _key))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool ReadDependencies(std::istream& _stream, std::vector<std::string>& _dependencies)
+{
+	std::string line;
+	while (std::getline(_stream, line))
+	{
+		if (line.compare(0, 11, "dependency ") == 0)
+		{
+			_dependencies.push_back(line.substr(11));
+		}
+	}
+	return true;
+}
+
+static void WriteDependencies(std::ostream& _stream, const std::vector<std::string>& _dependencies)
+{
+	for (const std::string& dependency : _dependencies)
+	{
+		_stream << "dependency " << dependency << "\n";
+	}
+}
+
+/// Parses a key written by KeyToString. Returns false if _str is not one.
+static bool KeyFromString(const std::string& _str, uint64_t& _key)
+{
+	if (_str.size() != 16 || !std::isxdigit((unsigned char)_str[0]))
+	{
+		return false;
+	}
+	char* end = nullptr;
+	errno = 0;
+	_key = std::strtoull(_str.c_str(), &end, 16);
+	return (errno == 0 && end == _str.c_str() + _str.size());
+}
+
+/// Reads the cache manifest of _pathOut. Returns false if there is none or it
+/// is malformed, which is treated as a cache miss.
+static bool ReadManifest(const char* _pathOut, SCacheManifest& _manifest)
+{
+	std::ifstream file(GetManifestPath(_pathOut));
+	std::string line;
+	if (!file.is_open()
+		|| !std::getline(file, line)
+		|| line != CACHE_MANIFEST_HEADER
+		|| !std::getline(file, line)
+		|| line.compare(0, 6, "input ") != 0)
+	{
+		return false;
+	}
+	_manifest.Input = line.substr(6);
+	if (!std::getline(file, line)
+		|| line.compare(0, 4, "key ") != 0
+		|| !KeyFromString(line.substr(4), _manifest.Key))
+	{
+		return false;
+	}
+	return ReadDependencies(file, _manifest.Dependencies);
+}
+
+/// Writes a file through a temporary file, so concurrent readers never see
+/// it incomplete.
+template<typename FN>
+static bool WriteFileAtomic(const fs::path& _path, FN&& _write)
+{
+	std::ostringstream suffix;
+	suffix << ".tmp" << std::this_thread::get_id();
+	fs::path pathTemp = fs::path(_path.string() + suffix.str());
+	{
+		std::ofstream file(pathTemp, std::ios::out | std::ios::binary);
+		if (!file.is_open() || !_write(file))
+		{
+			return false;
+		}
+	}
+	std::error_code error;
+	fs::rename(pathTemp, _path, error);
+	if (error)
+	{
+		fs::remove(pathTemp, error);
+		return false;
+	}
+	return true;
+}
+
+static bool WriteManifest(
+	const char* _pathIn,
+	const char* _pathOut,
+	uint64_t _key,
+	const std::vector<std::string>& _dependencies)
+{
+	return WriteFileAtomic(GetManifestPath(_pathOut), [&](std::ofstream& _file)
+	{
+		_file
+			<< CACHE_MANIFEST_HEADER << "\n"
+			<< "input " << GetAbsolutePath(_pathIn) << "\n"
+			<< "key " << KeyToString(_key) << "\n";
+		WriteDependencies(_file, _dependencies);
+		return _file.good();
+	});
+}
+
+bool HasCacheManifest(const char* _pathOut)
+{
+	std::error_code error;
+	return fs::exists(GetManifestPath(_pathOut), error);
+}
+
+void RemoveCacheManifest(const char* _pathOut)
+{
+	std::error_code error;
+	fs::remove(GetManifestPath(_pathOut), error);
+}
+
+bool IsCacheUpToDate(const char* _pathIn, const char* _pathOut, const SConfig& _conf)
+{
+	std::error_code error;
+	SCacheManifest manifest;
+	uint64_t inputKey;
+	uint64_t key;
+	return (fs::exists(fs::path(_pathOut), error)
+		&& ReadManifest(_pathOut, manifest)
+		&& manifest.Input == GetAbsolutePath(_pathIn)
+		&& GetInputKey(_pathIn, _conf, inputKey)
+		&& GetFullKey(inputKey, GetInputDirectory(_pathIn), manifest.Dependencies, key)
+		&& key == manifest.Key);
+}
+
+bool RestoreFromCache(const char* _pathIn, const char* _pathOut, const SConfig& _conf, std::ostream& _log)
+{
+	if (_conf.CacheDir.empty())
+	{
+		return false;
+	}
+
+	uint64_t inputKey;
+	if (!GetInputKey(_pathIn, _conf, inputKey))
+	{
+		return false;
+	}
+
+	// Dependencies in the cache directory are relative to the input, so that
+	// copies of the input with their own dependencies elsewhere hit the cache
+	fs::path cacheDir(_conf.CacheDir);
+	fs::path inputDir = GetInputDirectory(_pathIn);
+	std::ifstream depsFile(cacheDir / (KeyToString(inputKey) + ".deps"));
+	std::vector<std::string> dependencies;
+	uint64_t key;
+	if (!depsFile.is_open() || !ReadDependencies(depsFile, dependencies))
+	{
+		return false;
+	}
+	for (std::string& dependency : dependencies)
+	{
+		dependency = ResolveRelative(dependency, inputDir);
+	}
+	if (!GetFullKey(inputKey, inputDir, dependencies, key))
+	{
+		return false;
+	}
+
+	std::error_code error;
+	fs::path cached = cacheDir / (KeyToString(key) + ".bin");
+	if (!fs::exists(cached, error))
+	{
+		return false;
+	}
+
+	RemoveCacheManifest(_pathOut);
+	if (!fs::copy_file(cached, fs::path(_pathOut), fs::copy_options::overwrite_existing, error))
+	{
+		return false;
+	}
+
+	WriteManifest(_pathIn, _pathOut, key, dependencies);
+	_log << "SUCCESS: Restored " << _pathOut << " from cache!" << std::endl;
+	return true;
+}
+
+void StoreInCache(
+	const char* _pathIn,
+	const char* _pathOut,
+	const SConfig& _conf,
+	const std::vector<std::string>& _dependencies,
+	std::ostream& _log)
+{
+	// The input itself is always a part of the key
+	std::string pathIn = GetAbsolutePath(_pathIn);
+	std::vector<std::string> dependencies;
+	for (const std::string& dependency : _dependencies)
+	{
+		if (dependency != pathIn)
+		{
+			dependencies.push_back(dependency);
+		}
+	}
+
+	fs::path inputDir = GetInputDirectory(_pathIn);
+	uint64_t inputKey;
+	uint64_t key;
+	if (!GetInputKey(_pathIn, _conf, inputKey)
+		|| !GetFullKey(inputKey, inputDir, dependencies, key)
+		|| !WriteManifest(_pathIn, _pathOut, key, dependencies))
+	{
+		_log << "WARNING: Could not write cache manifest for " << _pathOut << "!" << std::endl;
+		return;
+	}
+
+	if (_conf.CacheDir.empty())
+	{
+		return;
+	}
+
+	std::error_code error;
+	fs::path cacheDir(_conf.CacheDir);
+	fs::create_directories(cacheDir, error);
+
+	bool stored = WriteFileAtomic(cacheDir / (KeyToString(inputKey) + ".deps"), [&](std::ofstream& _file)
+	{
+		std::vector<std::string> relative;
+		for (const std::string& dependency : dependencies)
+		{
+			relative.push_back(MakeRelative(dependency, inputDir));
+		}
+		WriteDependencies(_file, relative);
+		return _file.good();
+	});
+
+	stored = stored && WriteFileAtomic(cacheDir / (KeyToString(key) + ".bin"), [&](std::ofstream& _file)
+	{
+		std::ifstream output(_pathOut, std::ios::in | std::ios::binary);
+		_file << output.rdbuf();
+		return output.good() && _file.good();
+	});
+
+	if (!stored)
+	{
+		_log << "WARNING: Could not store " << _pathOut << " in cache directory " << _conf.CacheDir << "!" << std::endl;
+	}
+}
@@ -0,0 +1,349 @@
+#include <cluster.hpp>
+#include <hash.hpp>
+#include <math.hpp>
+#include <parallel.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+/// Maps vertices of a mesh to the first vertex with the same position, so that
+/// triangles are adjacent across attribute seams.
+static std::vector<uint32_t> WeldPositions(const aiMesh& _mesh)
+{
+	size_t tableSize = 1;
+	while (tableSize < (size_t)_mesh.mNumVertices * 2)
+	{
+		tableSize <<= 1;
+	}
+	std::vector<uint32_t> table(tableSize, UINT32_MAX);
+	std::vector<uint32_t> weld(_mesh.mNumVertices);
+
+	for (uint32_t i = 0; i < _mesh.mNumVertices; ++i)
+	{
+		const aiVector3D& position = _mesh.mVertices[i];
+		size_t slot = HashBytes(&position, sizeof(position)) & (tableSize - 1);
+		while (table[slot] != UINT32_MAX && _mesh.mVertices[table[slot]] != position)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == UINT32_MAX)
+		{
+			table[slot] = i;
+		}
+		weld[i] = table[slot];
+	}
+
+	return weld;
+}
+
+/// Computes the bounding sphere and the cone of normals of a cluster made of
+/// triangles _triangles[_first] to _triangles[_first + _count - 1].
+static void ComputeClusterBounds(
+	SCluster& _cluster,
+	const std::vector<uint32_t>& _indices,
+	const std::vector<uint32_t>& _triangles,
+	size_t _first,
+	size_t _count,
+	const std::vector<aiVector3D>& _positions,
+	const std::vector<aiVector3D>& _normals)
+{
+	aiAABB box = AABBEmpty();
+	aiVector3D normalSum;
+	for (size_t k = _first; k < _first + _count; ++k)
+	{
+		uint32_t t = _triangles[k];
+		for (uint32_t v = 0; v < 3; ++v)
+		{
+			AABBAddPoint(box, _positions[_indices[t * 3 + v]]);
+		}
+		normalSum += _normals[t];
+	}
+
+	_cluster.TriangleCount = (uint32_t)_count;
+	_cluster.Center = (box.mMin + box.mMax) * 0.5f;
+	float radiusSqr = 0.0f;
+	for (size_t k = _first; k < _first + _count; ++k)
+	{
+		uint32_t t = _triangles[k];
+		for (uint32_t v = 0; v < 3; ++v)
+		{
+			radiusSqr = std::max(radiusSqr, (_positions[_indices[t * 3 + v]] - _cluster.Center).SquareLength());
+		}
+	}
+	_cluster.Radius = std::sqrt(radiusSqr);
+
+	// Cutoff stays 1 if the normals cancel out or span a half-space or more
+	_cluster.ConeAxis = aiVector3D();
+	_cluster.ConeCutoff = 1.0f;
+	float length = normalSum.Length();
+	if (length <= FLT_EPSILON)
+	{
+		return;
+	}
+
+	aiVector3D axis = normalSum / length;
+	float minDot = 1.0f;
+	for (size_t k = _first; k < _first + _count; ++k)
+	{
+		const aiVector3D& normal = _normals[_triangles[k]];
+		if (normal.SquareLength() > 0.0f)
+		{
+			minDot = std::min(minDot, Vec3Dot(normal, axis));
+		}
+	}
+
+	_cluster.ConeAxis = axis;
+	if (minDot > 0.0f)
+	{
+		_cluster.ConeCutoff = std::sqrt(std::max(1.0f - minDot * minDot, 0.0f));
+	}
+}
+
+/// Reorders triangles of a triangle mesh instance into clusters of at most
+/// _maxTriangles triangles and returns their clusters. _weld maps vertices of
+/// the mesh to the first vertex with the same position. _invertWinding is
+/// SConfig::InvertWinding.
+static std::vector<SCluster> ClusterTriangles(
+	const aiMesh& _mesh,
+	const std::vector<uint32_t>& _weld,
+	const SMeshInstance& _instance,
+	const std::vector<uint32_t>& _meshIndices,
+	uint32_t _maxTriangles,
+	EAxis _up,
+	bool _invertWinding,
+	std::vector<uint32_t>& _indicesOut)
+{
+	std::vector<SCluster> clusters;
+	uint32_t triangleCount = (uint32_t)(_meshIndices.size() / 3);
+	_indicesOut.clear();
+	if (triangleCount == 0)
+	{
+		return clusters;
+	}
+
+	// Instances can use only a few vertices of a large mesh, e.g. cells of a
+	// grid, so only these are processed, with local indices
+	std::vector<uint32_t> vertices(_meshIndices);
+	std::sort(vertices.begin(), vertices.end());
+	vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+	uint32_t vertexCount = (uint32_t)vertices.size();
+
+	std::vector<uint32_t> indices(_meshIndices.size());
+	for (size_t i = 0; i < _meshIndices.size(); ++i)
+	{
+		indices[i] = (uint32_t)(std::lower_bound(vertices.begin(), vertices.end(), _meshIndices[i]) - vertices.begin());
+	}
+
+	std::vector<aiVector3D> positions(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		const aiVector3D& vertex = _mesh.mVertices[vertices[v]];
+		positions[v] = Vec3ConvertUp(_instance.Transformed ? (_instance.Transform * vertex) : vertex, _up);
+	}
+
+	// Local vertices with the same position share the first of them
+	std::vector<uint32_t> weld(vertexCount);
+	{
+		std::vector<uint32_t> byPosition(vertexCount);
+		std::iota(byPosition.begin(), byPosition.end(), 0);
+		std::stable_sort(byPosition.begin(), byPosition.end(), [&](uint32_t _a, uint32_t _b)
+		{
+			return _weld[vertices[_a]] < _weld[vertices[_b]];
+		});
+		for (size_t k = 0; k < byPosition.size(); ++k)
+		{
+			bool same = (k > 0 && _weld[vertices[byPosition[k]]] == _weld[vertices[byPosition[k - 1]]]);
+			weld[byPosition[k]] = same ? weld[byPosition[k - 1]] : byPosition[k];
+		}
+	}
+
+	// Normals of front faces. Faces of the mesh were reversed by
+	// aiProcess_FlipWindingOrder, so their cross products point inward unless
+	// -i reverses them back, and they flip again if the transform or the
+	// conversion into the up axis mirrors the mesh
+	bool flip = (!_invertWinding != (_instance.Mirrored != (_up == EAxis::PositiveZ)));
+	float sign = flip ? -1.0f : 1.0f;
+	std::vector<aiVector3D> normals(triangleCount);
+	std::vector<aiVector3D> centroids(triangleCount);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		const aiVector3D& p0 = positions[indices[t * 3]];
+		const aiVector3D& p1 = positions[indices[t * 3 + 1]];
+		const aiVector3D& p2 = positions[indices[t * 3 + 2]];
+		aiVector3D normal = Vec3Cross(p1 - p0, p2 - p0) * sign;
+		float length = normal.Length();
+		normals[t] = (length > 0.0f) ? (normal / length) : aiVector3D();
+		centroids[t] = (p0 + p1 + p2) / 3.0f;
+	}
+
+	// Triangles adjacent to each welded vertex
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (uint32_t index : indices)
+	{
+		++offsets[weld[index] + 1];
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[cursors[weld[indices[i]]]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	std::vector<bool> used(triangleCount, false);
+	// Index of the cluster that each triangle was last a candidate of, plus 1
+	std::vector<uint32_t> candidateOf(triangleCount, 0);
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> order;
+	order.reserve(triangleCount);
+
+	for (uint32_t seed = 0; seed < triangleCount; ++seed)
+	{
+		if (used[seed])
+		{
+			continue;
+		}
+
+		uint32_t clusterId = (uint32_t)clusters.size() + 1;
+		size_t first = order.size();
+		aiVector3D centroidSum;
+		aiVector3D normalSum;
+		candidates.clear();
+
+		uint32_t t = seed;
+		while (true)
+		{
+			used[t] = true;
+			order.push_back(t);
+			centroidSum += centroids[t];
+			normalSum += normals[t];
+
+			if (order.size() - first >= _maxTriangles)
+			{
+				break;
+			}
+
+			for (uint32_t v = 0; v < 3; ++v)
+			{
+				uint32_t w = weld[indices[t * 3 + v]];
+				for (uint32_t a = offsets[w]; a < offsets[w + 1]; ++a)
+				{
+					uint32_t neighbor = adjacency[a];
+					if (!used[neighbor] && candidateOf[neighbor] != clusterId)
+					{
+						candidateOf[neighbor] = clusterId;
+						candidates.push_back(neighbor);
+					}
+				}
+			}
+
+			// The next triangle is the closest candidate to the center,
+			// penalized by how much it turns away from the cluster's normals
+			aiVector3D center = centroidSum / (float)(order.size() - first);
+			float axisLength = normalSum.Length();
+			aiVector3D axis = (axisLength > 0.0f) ? (normalSum / axisLength) : aiVector3D();
+			size_t best = SIZE_MAX;
+			float bestScore = FLT_MAX;
+			for (size_t c = 0; c < candidates.size(); ++c)
+			{
+				uint32_t candidate = candidates[c];
+				if (used[candidate])
+				{
+					continue;
+				}
+				float score = (centroids[candidate] - center).Length() * (2.0f - Vec3Dot(normals[candidate], axis));
+				if (score < bestScore)
+				{
+					bestScore = score;
+					best = c;
+				}
+			}
+
+			if (best == SIZE_MAX)
+			{
+				break;
+			}
+			t = candidates[best];
+			candidates[best] = candidates.back();
+			candidates.pop_back();
+		}
+
+		SCluster cluster;
+		ComputeClusterBounds(cluster, indices, order, first, order.size() - first, positions, normals);
+		clusters.push_back(cluster);
+	}
+
+	_indicesOut.reserve(_meshIndices.size());
+	for (uint32_t triangle : order)
+	{
+		_indicesOut.insert(_indicesOut.end(), _meshIndices.begin() + triangle * 3, _meshIndices.begin() + triangle * 3 + 3);
+	}
+
+	return clusters;
+}
+
+SClusteredInstances BuildClusters(const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf)
+{
+	SClusteredInstances result;
+	result.Instances = _instances;
+	result.Clusters.resize(_instances.size());
+	result.Triangles.resize(_instances.size());
+
+	// Positions are welded once per mesh, which can have many instances
+	std::vector<uint32_t> meshes;
+	for (const SMeshInstance& instance : _instances)
+	{
+		meshes.push_back(instance.MeshIndex);
+	}
+	std::sort(meshes.begin(), meshes.end());
+	meshes.erase(std::unique(meshes.begin(), meshes.end()), meshes.end());
+	std::vector<std::vector<uint32_t>> welds(_scene.mNumMeshes);
+	ParallelFor((uint32_t)meshes.size(), _conf.ThreadCount, [&](uint32_t _i)
+	{
+		const aiMesh& mesh = *_scene.mMeshes[meshes[_i]];
+		if (mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+		{
+			welds[meshes[_i]] = WeldPositions(mesh);
+		}
+	});
+
+	ParallelFor((uint32_t)_instances.size(), _conf.ThreadCount, [&](uint32_t _i)
+	{
+		const SMeshInstance& instance = _instances[_i];
+		const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+		if (mesh.mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+		{
+			return;
+		}
+
+		std::vector<uint32_t> indices;
+		if (instance.Triangles)
+		{
+			indices = *instance.Triangles;
+		}
+		else
+		{
+			indices.reserve((size_t)mesh.mNumFaces * 3);
+			for (uint32_t f = 0; f < mesh.mNumFaces; ++f)
+			{
+				const aiFace& face = mesh.mFaces[f];
+				if (face.mNumIndices == 3)
+				{
+					indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+				}
+			}
+		}
+
+		result.Clusters[_i] = ClusterTriangles(
+			mesh, welds[instance.MeshIndex], instance, indices,
+			_conf.ClusterTriangles, _conf.UpVector, _conf.InvertWinding, result.Triangles[_i]);
+		result.Instances[_i].Triangles = &result.Triangles[_i];
+	});
+
+	return result;
+}
@@ -0,0 +1,172 @@
+#include <compress.hpp>
+#include <parallel.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+void FilterBytes(const char* _data, size_t _size, ECompressionFilter _filter, uint32_t _stride, std::vector<char>& _out)
+{
+	const uint32_t header[4] = {
+		COMPRESSION_FILTER_MAGIC,
+		(uint32_t)_filter,
+		_stride,
+		(uint32_t)_size,
+	};
+	_out.resize(sizeof(header) + _size);
+	std::memcpy(_out.data(), header, sizeof(header));
+	char* out = _out.data() + sizeof(header);
+
+	size_t count = (_stride > 0) ? (_size / _stride) : 0;
+	size_t filtered = count * _stride;
+	for (uint32_t b = 0; b < _stride; ++b)
+	{
+		char* plane = out + b * count;
+		for (size_t i = 0; i < count; ++i)
+		{
+			plane[i] = _data[i * _stride + b];
+		}
+
+		if (_filter == ECompressionFilter::Delta)
+		{
+			// Backwards, so that previous bytes are still unfiltered
+			for (size_t i = count; i-- > 1;)
+			{
+				plane[i] = (char)((uint8_t)plane[i] - (uint8_t)plane[i - 1]);
+			}
+		}
+	}
+	std::memcpy(out + filtered, _data + filtered, _size - filtered);
+}
+
+/// Deflates a block of data into raw deflate data, using _dictionarySize bytes
+/// preceding it as the dictionary. The last block is finished, others end with
+/// a sync flush, so that the stream continues at a byte boundary.
+static bool DeflateBlock(
+	const char* _data,
+	size_t _size,
+	size_t _dictionarySize,
+	bool _last,
+	uint32_t _level,
+	std::vector<char>& _out)
+{
+	z_stream stream = {};
+	if (deflateInit2(&stream, (int)_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return false;
+	}
+
+	if (_dictionarySize > 0
+		&& deflateSetDictionary(&stream, (const Bytef*)(_data - _dictionarySize), (uInt)_dictionarySize) != Z_OK)
+	{
+		deflateEnd(&stream);
+		return false;
+	}
+
+	int flush = _last ? Z_FINISH : Z_SYNC_FLUSH;
+	stream.next_in = (Bytef*)_data;
+	stream.avail_in = (uInt)_size;
+
+	// Sync flush adds an empty stored block, which deflateBound does not count
+	size_t chunkSize = deflateBound(&stream, (uLong)_size) + 16;
+	bool done = false;
+	while (!done)
+	{
+		size_t offset = _out.size();
+		_out.resize(offset + chunkSize);
+		stream.next_out = (Bytef*)(_out.data() + offset);
+		stream.avail_out = (uInt)chunkSize;
+		int result = deflate(&stream, flush);
+		_out.resize(_out.size() - stream.avail_out);
+
+		if (result == Z_STREAM_ERROR)
+		{
+			deflateEnd(&stream);
+			return false;
+		}
+		done = _last ? (result == Z_STREAM_END) : (stream.avail_out != 0);
+	}
+
+	deflateEnd(&stream);
+	return true;
+}
+
+bool CompressZlib(const char* _data, size_t _size, uint32_t _level, uint32_t _threadCount, std::vector<char>& _out)
+{
+	uint32_t blockCount = (uint32_t)std::max<size_t>((_size + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE, 1);
+	std::vector<std::vector<char>> blocks(blockCount);
+	std::vector<uLong> checksums(blockCount);
+	std::vector<char> failed(blockCount, 0);
+
+	ParallelFor(blockCount, _threadCount, [&](uint32_t _i)
+	{
+		size_t offset = (size_t)_i * COMPRESSION_BLOCK_SIZE;
+		size_t size = std::min<size_t>(_size - offset, COMPRESSION_BLOCK_SIZE);
+		size_t dictionarySize = std::min<size_t>(offset, COMPRESSION_WINDOW_SIZE);
+		failed[_i] = !DeflateBlock(_data + offset, size, dictionarySize, _i == blockCount - 1, _level, blocks[_i]);
+		checksums[_i] = adler32(adler32(0, Z_NULL, 0), (const Bytef*)(_data + offset), (uInt)size);
+	});
+
+	if (std::find(failed.begin(), failed.end(), 1) != failed.end())
+	{
+		return false;
+	}
+
+	// Header with deflate and 32K window, with the level as zlib sets it
+	uint32_t levelFlag = (_level < 2) ? 0 : ((_level < 6) ? 1 : ((_level == 6) ? 2 : 3));
+	uint32_t header = (0x78 << 8) | (levelFlag << 6);
+	header += 31 - (header % 31);
+
+	size_t size = 2 + 4;
+	for (const std::vector<char>& block : blocks)
+	{
+		size += block.size();
+	}
+	_out.clear();
+	_out.reserve(size);
+	_out.push_back((char)(header >> 8));
+	_out.push_back((char)(header & 0xFF));
+
+	uLong checksum = adler32(0, Z_NULL, 0);
+	for (uint32_t i = 0; i < blockCount; ++i)
+	{
+		_out.insert(_out.end(), blocks[i].begin(), blocks[i].end());
+		size_t blockSize = std::min<size_t>(_size - (size_t)i * COMPRESSION_BLOCK_SIZE, COMPRESSION_BLOCK_SIZE);
+		checksum = adler32_combine(checksum, checksums[i], (z_off_t)blockSize);
+	}
+
+	// Adler-32 is stored big endian
+	for (int shift = 24; shift >= 0; shift -= 8)
+	{
+		_out.push_back((char)((checksum >> shift) & 0xFF));
+	}
+	return true;
+}
+
+bool WriteCompressed(std::ostream& _file, const char* _data, size_t _size, const SConfig& _conf, std::ostream& _log)
+{
+	const char* data = _data;
+	size_t size = _size;
+
+	std::vector<char> filtered;
+	if (_conf.CompressionFilter != ECompressionFilter::None)
+	{
+		FilterBytes(data, size, _conf.CompressionFilter, _conf.GetVertexSize(), filtered);
+		data = filtered.data();
+		size = filtered.size();
+	}
+
+	std::vector<char> compressed;
+	if (!CompressZlib(data, size, _conf.CompressionLevel, _conf.ThreadCount, compressed))
+	{
+		_log << "ERROR: Could not compress the output!" << std::endl;
+		return false;
+	}
+
+	_file.write(compressed.data(), compressed.size());
+
+	_log << "Compressed: " << _size << " bytes into " << compressed.size() << " bytes ("
+		<< ((_size == 0) ? 0.0 : (100.0 * compressed.size() / _size)) << "%)" << std::endl;
+	return true;
+}
@@ -0,0 +1,25 @@
+#include <container.hpp>
+
+SStagingBuffer& SContainer::AddChunk(EChunk _id)
+{
+	SChunk& chunk = Chunks.emplace_back();
+	chunk.Id = _id;
+	return chunk.Payload;
+}
+
+void SContainer::Write(std::ostream& _file)
+{
+	SStagingBuffer header;
+	WriteSingle<uint32_t>(header, YAMC_CONTAINER_MAGIC);
+	WriteSingle<uint32_t>(header, YAMC_CONTAINER_VERSION);
+	WriteSingle<uint32_t>(header, Chunks.size());
+	header.Flush(_file);
+
+	for (SChunk& chunk : Chunks)
+	{
+		WriteSingle<uint32_t>(header, chunk.Id);
+		WriteSingle<uint32_t>(header, chunk.Payload.Data.size());
+		header.Flush(_file);
+		chunk.Payload.Flush(_file);
+	}
+}
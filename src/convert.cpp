@@ -0,0 +1,276 @@
+#include <cache.hpp>
+#include <compress.hpp>
+#include <convert.hpp>
+#include <io.hpp>
+#include <optimize.hpp>
+#include <tangentspace.hpp>
+#include <writing.hpp>
+
+#include <assimp/config.h>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <fstream>
+#include <memory>
+
+/// Post-processing steps in the order in which Assimp runs them.
+static const struct
+{
+	uint32_t Flag;
+	const char* Name;
+} POST_PROCESS_STEPS[] = {
+	{ aiProcess_ValidateDataStructure, "aiProcess_ValidateDataStructure" },
+	{ aiProcess_MakeLeftHanded, "aiProcess_MakeLeftHanded" },
+	{ aiProcess_FlipUVs, "aiProcess_FlipUVs" },
+	{ aiProcess_FlipWindingOrder, "aiProcess_FlipWindingOrder" },
+	{ aiProcess_RemoveComponent, "aiProcess_RemoveComponent" },
+	{ aiProcess_RemoveRedundantMaterials, "aiProcess_RemoveRedundantMaterials" },
+	{ aiProcess_EmbedTextures, "aiProcess_EmbedTextures" },
+	{ aiProcess_FindInstances, "aiProcess_FindInstances" },
+	{ aiProcess_OptimizeGraph, "aiProcess_OptimizeGraph" },
+	{ aiProcess_FindDegenerates, "aiProcess_FindDegenerates" },
+	{ aiProcess_GenUVCoords, "aiProcess_GenUVCoords" },
+	{ aiProcess_TransformUVCoords, "aiProcess_TransformUVCoords" },
+	{ aiProcess_GlobalScale, "aiProcess_GlobalScale" },
+	{ aiProcess_PopulateArmatureData, "aiProcess_PopulateArmatureData" },
+	{ aiProcess_PreTransformVertices, "aiProcess_PreTransformVertices" },
+	{ aiProcess_Triangulate, "aiProcess_Triangulate" },
+	{ aiProcess_SortByPType, "aiProcess_SortByPType" },
+	{ aiProcess_FindInvalidData, "aiProcess_FindInvalidData" },
+	{ aiProcess_OptimizeMeshes, "aiProcess_OptimizeMeshes" },
+	{ aiProcess_FixInfacingNormals, "aiProcess_FixInfacingNormals" },
+	{ aiProcess_SplitByBoneCount, "aiProcess_SplitByBoneCount" },
+	{ aiProcess_SplitLargeMeshes, "aiProcess_SplitLargeMeshes" },
+	{ aiProcess_GenNormals, "aiProcess_GenNormals" },
+	{ aiProcess_GenSmoothNormals, "aiProcess_GenSmoothNormals" },
+	{ aiProcess_CalcTangentSpace, "aiProcess_CalcTangentSpace" },
+	{ aiProcess_JoinIdenticalVertices, "aiProcess_JoinIdenticalVertices" },
+	{ aiProcess_Debone, "aiProcess_Debone" },
+	{ aiProcess_LimitBoneWeights, "aiProcess_LimitBoneWeights" },
+	{ aiProcess_ImproveCacheLocality, "aiProcess_ImproveCacheLocality" },
+	{ aiProcess_GenBoundingBoxes, "aiProcess_GenBoundingBoxes" },
+	{ aiProcess_DropNormals, "aiProcess_DropNormals" },
+};
+
+/// Components removed by aiProcess_RemoveComponent, as reported in the log.
+static const struct
+{
+	uint32_t Flag;
+	const char* Name;
+} COMPONENTS[] = {
+	{ aiComponent_NORMALS, "normals" },
+	{ aiComponent_TANGENTS_AND_BITANGENTS, "tangents" },
+	{ aiComponent_TEXCOORDS, "texture coordinates" },
+	{ 0xFE000000, "unused texture coordinate layers" }, // aiComponent_TEXCOORDSn
+	{ aiComponent_COLORS, "colors" },
+	{ 0x01F00000, "unused color sets" }, // aiComponent_COLORSn
+	{ aiComponent_BONEWEIGHTS, "bone weights" },
+	{ aiComponent_ANIMATIONS, "animations" },
+	{ aiComponent_TEXTURES, "embedded textures" },
+	{ aiComponent_LIGHTS, "lights" },
+	{ aiComponent_CAMERAS, "cameras" },
+};
+
+/// Configures the importer for post-processing steps and components planned by
+/// SConfig::PlanPostProcessing.
+static void SetImporterProperties(Assimp::Importer& _importer, const SConfig& _conf)
+{
+	_importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, (int)_conf.RemoveComponents);
+	_importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, _conf.SmoothingAngle);
+
+	// Skip parts of FBX files that are removed anyway, so they are not even
+	// parsed
+	_importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_ANIMATIONS, false);
+	_importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_CAMERAS, false);
+	_importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_LIGHTS, false);
+	_importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_READ_WEIGHTS, false);
+}
+
+/// Logs post-processing steps and removed components planned by
+/// SConfig::PlanPostProcessing.
+static void LogImportPlan(const SConfig& _conf, std::ostream& _log)
+{
+	_log << "INFO: Post-processing steps:";
+	const char* separator = " ";
+	for (const auto& step : POST_PROCESS_STEPS)
+	{
+		if ((_conf.Flags & step.Flag) != 0)
+		{
+			// Skip the "aiProcess_" prefix
+			_log << separator << (step.Name + 10);
+			separator = ", ";
+		}
+	}
+	_log << std::endl;
+
+	_log << "INFO: Removed components:";
+	separator = " ";
+	for (const auto& component : COMPONENTS)
+	{
+		if ((_conf.RemoveComponents & component.Flag) != 0)
+		{
+			_log << separator << component.Name;
+			separator = ", ";
+		}
+	}
+	_log << std::endl;
+}
+
+/// Runs post-processing steps given by _flags one at a time, each measured as
+/// a separate stage.
+static const aiScene* ApplyPostProcessingProfiled(
+	Assimp::Importer& _importer,
+	uint32_t _flags,
+	SProfiler& _profiler)
+{
+	SProfiler::SScope scope(&_profiler, "Post-processing");
+	const aiScene* scene = _importer.GetScene();
+
+	for (const auto& step : POST_PROCESS_STEPS)
+	{
+		if (scene && (_flags & step.Flag) != 0)
+		{
+			SProfiler::SScope stepScope(&_profiler, step.Name);
+			scene = _importer.ApplyPostProcessing(step.Flag);
+			_flags &= ~step.Flag;
+		}
+	}
+
+	// Flags that only modify other steps
+	if (scene && _flags != 0)
+	{
+		SProfiler::SScope stepScope(&_profiler, "Other");
+		scene = _importer.ApplyPostProcessing(_flags);
+	}
+
+	return scene;
+}
+
+EConvertResult ConvertFile(
+	Assimp::Importer& _importer,
+	const char* _pathIn,
+	const char* _pathOut,
+	const SConfig& _conf,
+	std::ostream& _log,
+	SProfiler* _profiler)
+{
+	if (_conf.Cache && RestoreFromCache(_pathIn, _pathOut, _conf, _log))
+	{
+		return EConvertResult::Success;
+	}
+
+	LogImportPlan(_conf, _log);
+	SetImporterProperties(_importer, _conf);
+
+	// Memory maps input files and records all files read by the importer as
+	// dependencies of the output. The importer owns it only until it is
+	// reset below, which hands it back without deleting it.
+	std::unique_ptr<SFileIOSystem> ioSystem = std::make_unique<SFileIOSystem>();
+	ioSystem->MeasureReadTime = (_profiler != nullptr);
+	_importer.SetIOHandler(ioSystem.get());
+
+	const aiScene* scene = nullptr;
+	if (_profiler)
+	{
+		// Post-processing steps are run separately to measure each of them
+		SProfiler::Clock::time_point importStart = SProfiler::Clock::now();
+		{
+			SProfiler::SScope scope(_profiler, "Import");
+			scene = _importer.ReadFile(_pathIn, 0);
+		}
+		_profiler->AddEvent("File read", importStart,
+			std::chrono::nanoseconds(ioSystem->ReadTime.load()), _profiler->Depth + 1);
+
+		if (scene)
+		{
+			scene = ApplyPostProcessingProfiled(_importer, _conf.Flags, *_profiler);
+		}
+	}
+	else
+	{
+		scene = _importer.ReadFile(_pathIn, _conf.Flags);
+	}
+
+	_importer.SetIOHandler(nullptr);
+	std::vector<std::string> dependencies = std::move(ioSystem->OpenedFiles);
+	ioSystem.reset();
+
+	if (!scene)
+	{
+		_log << "ERROR: Could not load model " << _pathIn << "!" << std::endl;
+		return EConvertResult::Failed;
+	}
+
+	if (scene->mNumMeshes == 0)
+	{
+		_log << "INFO: Model has no meshes, quitting..." << std::endl;
+		_importer.FreeScene();
+		return EConvertResult::Skipped;
+	}
+
+	if (_conf.Native && (_conf.WriteNormals || _conf.WriteTangents))
+	{
+		SProfiler::SScope scope(_profiler, "Tangent space");
+		// The scene is owned by the importer and freed right after writing, so
+		// it is safe to modify it in place
+		GenerateTangentSpace(*const_cast<aiScene*>(scene), _conf, _log);
+	}
+
+	if (_conf.Optimization != EOptimization::None)
+	{
+		SProfiler::SScope scope(_profiler, "Optimize");
+		OptimizeScene(*const_cast<aiScene*>(scene), _conf, _log);
+	}
+
+	// The manifest is written again only once the output is complete
+	RemoveCacheManifest(_pathOut);
+
+	std::ofstream file(_pathOut, std::ios::out | std::ios::binary);
+	if (!file.is_open())
+	{
+		_log << "ERROR: Could not open file " << _pathOut << " for writing!" << std::endl;
+		_importer.FreeScene();
+		return EConvertResult::Failed;
+	}
+
+	// Compressed files are first written into memory, which is compressed in
+	// place
+	SMemoryStreamBuffer memoryBuffer;
+	std::ostream memory(&memoryBuffer);
+	bool compressed = (_conf.CompressionLevel > 0);
+	std::ostream& out = compressed ? static_cast<std::ostream&>(memory) : file;
+	bool written = WriteScene(out, *scene, _conf, _log, _profiler);
+
+	{
+		SProfiler::SScope scope(_profiler, "Free scene");
+		_importer.FreeScene();
+	}
+
+	if (!written)
+	{
+		return EConvertResult::Failed;
+	}
+
+	if (compressed)
+	{
+		SProfiler::SScope scope(_profiler, "Compress");
+		if (!WriteCompressed(file, memoryBuffer.Data.data(), memoryBuffer.Data.size(), _conf, _log))
+		{
+			return EConvertResult::Failed;
+		}
+	}
+
+	{
+		SProfiler::SScope scope(_profiler, "Close output");
+		file.flush();
+		file.close();
+	}
+
+	_log << "SUCCESS: Wrote vertex buffer to " << _pathOut << "!" << std::endl;
+
+	if (_conf.Cache)
+	{
+		StoreInCache(_pathIn, _pathOut, _conf, dependencies, _log);
+	}
+	return EConvertResult::Success;
+}
@@ -0,0 +1,494 @@
+#include <encoder.hpp>
+#include <kernels.hpp>
+
+#include <cstring>
+#include <utility>
+
+// Flags of attributes written by a specialization of InterleaveVertices
+#define VERTEX_POSITION (1 << 0)
+#define VERTEX_NORMAL (1 << 1)
+#define VERTEX_TEXCOORD (1 << 2)
+#define VERTEX_TEXCOORD2 (1 << 3)
+#define VERTEX_COLOR (1 << 4)
+#define VERTEX_TANGENT (1 << 5)
+// Flags of attribute sizes
+#define VERTEX_POSITION_QUANTIZED (1 << 6)
+#define VERTEX_VECTOR_PACKED (1 << 7)
+#define VERTEX_TEXCOORD_HALF (1 << 8)
+#define VERTEX_VARIANT_COUNT (1 << 9)
+
+template<typename T>
+static inline void Store(char* _out, T _value)
+{
+	std::memcpy(_out, &_value, sizeof(T));
+}
+
+static inline void EncodePosition(char* _out, const aiVector3D& _position, const SConfig& _conf)
+{
+	if (_conf.PositionEncoding == EPositionEncoding::Quantized)
+	{
+		const aiAABB& bounds = _conf.PositionBounds;
+		aiVector3D size = bounds.mMax - bounds.mMin;
+		aiVector3D relative = _position - bounds.mMin;
+		Store<uint16_t>(_out + 0, EncodeUNorm16((size.x > 0.0f) ? (relative.x / size.x) : 0.0f));
+		Store<uint16_t>(_out + 2, EncodeUNorm16((size.y > 0.0f) ? (relative.y / size.y) : 0.0f));
+		Store<uint16_t>(_out + 4, EncodeUNorm16((size.z > 0.0f) ? (relative.z / size.z) : 0.0f));
+		Store<uint16_t>(_out + 6, 0);
+		return;
+	}
+
+	Store<float>(_out + 0, _position.x);
+	Store<float>(_out + 4, _position.y);
+	Store<float>(_out + 8, _position.z);
+}
+
+/// Encodes a normal vector, or a tangent vector if _bitangentSign is not 0.
+static inline void EncodeVector(char* _out, const aiVector3D& _vector, float _bitangentSign, const SConfig& _conf)
+{
+	switch (_conf.VectorEncoding)
+	{
+	case EVectorEncoding::Float:
+		Store<float>(_out + 0, _vector.x);
+		Store<float>(_out + 4, _vector.y);
+		Store<float>(_out + 8, _vector.z);
+		if (_bitangentSign != 0.0f)
+		{
+			Store<float>(_out + 12, _bitangentSign);
+		}
+		break;
+
+	case EVectorEncoding::SNorm:
+		Store<int8_t>(_out + 0, EncodeSNorm8(_vector.x));
+		Store<int8_t>(_out + 1, EncodeSNorm8(_vector.y));
+		Store<int8_t>(_out + 2, EncodeSNorm8(_vector.z));
+		Store<int8_t>(_out + 3, EncodeSNorm8(_bitangentSign));
+		break;
+
+	case EVectorEncoding::Octahedral:
+		{
+			float u, v;
+			EncodeOctahedral(_vector, u, v);
+			Store<uint16_t>(_out + 0, EncodeUNorm16(u * 0.5f + 0.5f));
+			if (_bitangentSign != 0.0f)
+			{
+				// 15 bits for the vector, highest bit set for negative sign
+				uint16_t encoded = EncodeUNorm16(v * 0.5f + 0.5f) >> 1;
+				Store<uint16_t>(_out + 2, encoded | ((_bitangentSign < 0.0f) ? 0x8000 : 0));
+			}
+			else
+			{
+				Store<uint16_t>(_out + 2, EncodeUNorm16(v * 0.5f + 0.5f));
+			}
+		}
+		break;
+	}
+}
+
+static inline void EncodeTexCoord(char* _out, float _u, float _v, const SConfig& _conf)
+{
+	if (_conf.TexCoordEncoding == ETexCoordEncoding::Half)
+	{
+		Store<uint16_t>(_out + 0, FloatToHalf(_u));
+		Store<uint16_t>(_out + 2, FloatToHalf(_v));
+		return;
+	}
+
+	Store<float>(_out + 0, _u);
+	Store<float>(_out + 4, _v);
+}
+
+/// Converts vectors into given up axis and encodes them into _out.
+static void EncodeVectors(
+	std::vector<char>& _out, const aiVector3D* _vectors, size_t _count, EAxis _up, const SConfig& _conf)
+{
+	if (_conf.VectorEncoding == EVectorEncoding::Float)
+	{
+		_out.resize(_count * sizeof(aiVector3D));
+		ConvertUpArray(_vectors, (aiVector3D*)_out.data(), _count, _up);
+		return;
+	}
+
+	std::vector<aiVector3D> converted(_count);
+	ConvertUpArray(_vectors, converted.data(), _count, _up);
+	_out.resize(_count * sizeof(uint32_t));
+	for (size_t i = 0; i < _count; ++i)
+	{
+		EncodeVector(_out.data() + i * sizeof(uint32_t), converted[i], 0.0f, _conf);
+	}
+}
+
+/// Encodes X and Y of texture coordinates into _out.
+static void EncodeTexCoords(std::vector<char>& _out, const aiVector3D* _texCoords, size_t _count, const SConfig& _conf)
+{
+	if (_conf.TexCoordEncoding == ETexCoordEncoding::Float)
+	{
+		_out.resize(_count * 2 * sizeof(float));
+		ExtractTexCoords(_texCoords, (float*)_out.data(), _count, _conf.FlipUVs);
+		return;
+	}
+
+	std::vector<float> extracted(_count * 2);
+	ExtractTexCoords(_texCoords, extracted.data(), _count, _conf.FlipUVs);
+	_out.resize(_count * 2 * sizeof(uint16_t));
+	for (size_t i = 0; i < _count; ++i)
+	{
+		EncodeTexCoord(_out.data() + i * 2 * sizeof(uint16_t), extracted[i * 2], extracted[i * 2 + 1], _conf);
+	}
+}
+
+template<uint32_t VARIANT>
+static void InterleaveVertices(const SMeshEncoder& _encoder, char* _out, const uint32_t* _indices, size_t _count)
+{
+	constexpr size_t positionSize = ((VARIANT & VERTEX_POSITION_QUANTIZED) != 0) ? 4 * sizeof(uint16_t) : 3 * sizeof(float);
+	constexpr size_t normalSize = ((VARIANT & VERTEX_VECTOR_PACKED) != 0) ? sizeof(uint32_t) : 3 * sizeof(float);
+	constexpr size_t texCoordSize = ((VARIANT & VERTEX_TEXCOORD_HALF) != 0) ? 2 * sizeof(uint16_t) : 2 * sizeof(float);
+	constexpr size_t tangentSize = ((VARIANT & VERTEX_VECTOR_PACKED) != 0) ? sizeof(uint32_t) : 4 * sizeof(float);
+
+	const uint32_t vertexSize = _encoder.VertexSize;
+
+	for (size_t i = 0; i < _count; ++i, _out += vertexSize)
+	{
+		size_t index = _indices ? _indices[i] : i;
+
+		std::memcpy(_out, _encoder.Template.data(), vertexSize);
+
+		if constexpr ((VARIANT & VERTEX_POSITION) != 0)
+		{
+			std::memcpy(_out, _encoder.Positions.data() + index * positionSize, positionSize);
+		}
+
+		if constexpr ((VARIANT & VERTEX_NORMAL) != 0)
+		{
+			std::memcpy(_out + _encoder.NormalOffset, _encoder.Normals.data() + index * normalSize, normalSize);
+		}
+
+		if constexpr ((VARIANT & VERTEX_TEXCOORD) != 0)
+		{
+			std::memcpy(_out + _encoder.TexCoordOffset, _encoder.TexCoords.data() + index * texCoordSize, texCoordSize);
+		}
+
+		if constexpr ((VARIANT & VERTEX_TEXCOORD2) != 0)
+		{
+			std::memcpy(_out + _encoder.TexCoord2Offset, _encoder.TexCoords2.data() + index * texCoordSize, texCoordSize);
+		}
+
+		if constexpr ((VARIANT & VERTEX_COLOR) != 0)
+		{
+			std::memcpy(_out + _encoder.ColorOffset, _encoder.Colors.data() + index * sizeof(uint32_t), sizeof(uint32_t));
+		}
+
+		if constexpr ((VARIANT & VERTEX_TANGENT) != 0)
+		{
+			std::memcpy(_out + _encoder.TangentOffset, _encoder.Tangents.data() + index * tangentSize, tangentSize);
+		}
+	}
+}
+
+template<uint32_t... VARIANTS>
+static constexpr std::array<SMeshEncoder::FEncode, sizeof...(VARIANTS)> MakeEncodeFunctions(
+	std::integer_sequence<uint32_t, VARIANTS...>)
+{
+	return { &InterleaveVertices<VARIANTS>... };
+}
+
+/// Specializations of InterleaveVertices for all combinations of VERTEX_* flags.
+static const std::array<SMeshEncoder::FEncode, VERTEX_VARIANT_COUNT> ENCODE_FUNCTIONS =
+	MakeEncodeFunctions(std::make_integer_sequence<uint32_t, VERTEX_VARIANT_COUNT>());
+
+/// Written in place of normals if a mesh has none.
+static const aiVector3D DEFAULT_NORMAL(0.0f, 1.0f, 0.0f);
+
+/// Transforms vectors by _matrix into _out and normalizes them.
+static void TransformDirections(
+	const aiVector3D* _vectors, size_t _count, const aiMatrix3x3& _matrix, std::vector<aiVector3D>& _out)
+{
+	_out.resize(_count);
+	for (size_t i = 0; i < _count; ++i)
+	{
+		_out[i] = (_matrix * _vectors[i]).NormalizeSafe();
+	}
+}
+
+/// Copies elements _vertices of _values into _out and returns its data, or
+/// returns _values if it is nullptr.
+template<typename T>
+static const T* GatherVertices(const T* _values, const std::vector<uint32_t>& _vertices, std::vector<T>& _out)
+{
+	if (!_values)
+	{
+		return nullptr;
+	}
+	_out.resize(_vertices.size());
+	for (size_t i = 0; i < _vertices.size(); ++i)
+	{
+		_out[i] = _values[_vertices[i]];
+	}
+	return _out.data();
+}
+
+SMeshEncoder::SMeshEncoder(
+	const aiScene& _scene,
+	const aiMesh& _mesh,
+	const SConfig& _conf,
+	const aiMatrix4x4* _transform,
+	const std::vector<uint32_t>* _vertices)
+	: NormalOffset(0)
+	, TexCoordOffset(0)
+	, TexCoord2Offset(0)
+	, ColorOffset(0)
+	, TangentOffset(0)
+{
+	size_t count = _mesh.mNumVertices;
+	bool hasNormals = _mesh.HasNormals();
+	bool hasTangents = _mesh.HasTangentsAndBitangents();
+
+	const aiVector3D* positions = _mesh.mVertices;
+	const aiVector3D* normals = _mesh.mNormals;
+	const aiVector3D* tangents = _mesh.mTangents;
+	const aiVector3D* bitangents = _mesh.mBitangents;
+	const aiVector3D* texCoords = _mesh.mTextureCoords[0];
+	const aiVector3D* texCoords2 = _mesh.mTextureCoords[1];
+	const aiColor4D* colors = _mesh.mColors[0];
+
+	// Instances that write only a part of the mesh (cells of the grid,
+	// clusters) gather attributes of their vertices first, so that each of
+	// them transforms and encodes only those
+	std::vector<aiVector3D> gatheredPositions;
+	std::vector<aiVector3D> gatheredNormals;
+	std::vector<aiVector3D> gatheredTangents;
+	std::vector<aiVector3D> gatheredBitangents;
+	std::vector<aiVector3D> gatheredTexCoords;
+	std::vector<aiVector3D> gatheredTexCoords2;
+	std::vector<aiColor4D> gatheredColors;
+	if (_vertices)
+	{
+		const std::vector<uint32_t>& vertices = *_vertices;
+		count = vertices.size();
+		if (_conf.WritePositions)
+		{
+			positions = GatherVertices(positions, vertices, gatheredPositions);
+		}
+		if (_conf.WriteNormals || _conf.WriteTangents)
+		{
+			normals = GatherVertices(normals, vertices, gatheredNormals);
+		}
+		if (_conf.WriteTangents)
+		{
+			tangents = GatherVertices(tangents, vertices, gatheredTangents);
+			bitangents = GatherVertices(bitangents, vertices, gatheredBitangents);
+		}
+		if (_conf.WriteTextureCoords)
+		{
+			texCoords = GatherVertices(texCoords, vertices, gatheredTexCoords);
+		}
+		if (_conf.WriteTextureCoords2)
+		{
+			texCoords2 = GatherVertices(texCoords2, vertices, gatheredTexCoords2);
+		}
+		if (_conf.WriteColors)
+		{
+			colors = GatherVertices(colors, vertices, gatheredColors);
+		}
+	}
+
+	// Instances placed by nodes are transformed into copies that live only
+	// while their streams are encoded. Normals use the inverse transpose,
+	// same as in aiProcess_PreTransformVertices.
+	std::vector<aiVector3D> transformedPositions;
+	std::vector<aiVector3D> transformedNormals;
+	std::vector<aiVector3D> transformedTangents;
+	std::vector<aiVector3D> transformedBitangents;
+	if (_transform)
+	{
+		if (_conf.WritePositions)
+		{
+			transformedPositions.resize(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				transformedPositions[i] = (*_transform) * positions[i];
+			}
+			positions = transformedPositions.data();
+		}
+
+		if (hasNormals && (_conf.WriteNormals || (_conf.WriteTangents && hasTangents)))
+		{
+			aiMatrix3x3 normalMatrix = aiMatrix3x3(*_transform).Inverse().Transpose();
+			TransformDirections(normals, count, normalMatrix, transformedNormals);
+			normals = transformedNormals.data();
+		}
+
+		if (hasTangents && _conf.WriteTangents)
+		{
+			aiMatrix3x3 matrix(*_transform);
+			TransformDirections(tangents, count, matrix, transformedTangents);
+			TransformDirections(bitangents, count, matrix, transformedBitangents);
+			tangents = transformedTangents.data();
+			bitangents = transformedBitangents.data();
+		}
+	}
+
+	uint32_t positionSize = (_conf.PositionEncoding == EPositionEncoding::Float) ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+	uint32_t normalSize = (_conf.VectorEncoding == EVectorEncoding::Float) ? 3 * sizeof(float) : sizeof(uint32_t);
+	uint32_t texCoordSize = (_conf.TexCoordEncoding == ETexCoordEncoding::Float) ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+	uint32_t tangentSize = (_conf.VectorEncoding == EVectorEncoding::Float) ? 4 * sizeof(float) : sizeof(uint32_t);
+
+	Template.fill(0);
+	char* out = Template.data();
+	uint32_t offset = 0;
+	uint32_t variant = 0;
+
+	if (_conf.WritePositions)
+	{
+		variant |= VERTEX_POSITION;
+		offset += positionSize;
+
+		if (_conf.PositionEncoding == EPositionEncoding::Float)
+		{
+			Positions.resize(count * sizeof(aiVector3D));
+			ConvertUpArray(positions, (aiVector3D*)Positions.data(), count, _conf.UpVector);
+		}
+		else
+		{
+			std::vector<aiVector3D> converted(count);
+			ConvertUpArray(positions, converted.data(), count, _conf.UpVector);
+			Positions.resize(count * positionSize);
+			for (size_t i = 0; i < count; ++i)
+			{
+				EncodePosition(Positions.data() + i * positionSize, converted[i], _conf);
+			}
+		}
+	}
+
+	if (_conf.WriteNormals)
+	{
+		NormalOffset = offset;
+		if (hasNormals)
+		{
+			variant |= VERTEX_NORMAL;
+			EncodeVectors(Normals, normals, count, _conf.UpVector, _conf);
+		}
+		else
+		{
+			EncodeVector(out + offset, Vec3ConvertUp(DEFAULT_NORMAL, _conf.UpVector), 0.0f, _conf);
+		}
+		offset += normalSize;
+	}
+
+	if (_conf.WriteTextureCoords)
+	{
+		TexCoordOffset = offset;
+		if (_mesh.HasTextureCoords(0))
+		{
+			variant |= VERTEX_TEXCOORD;
+			EncodeTexCoords(TexCoords, texCoords, count, _conf);
+		}
+		else
+		{
+			EncodeTexCoord(out + offset, 0.0f, 0.0f, _conf);
+		}
+		offset += texCoordSize;
+	}
+
+	if (_conf.WriteTextureCoords2)
+	{
+		TexCoord2Offset = offset;
+		if (_mesh.HasTextureCoords(1))
+		{
+			variant |= VERTEX_TEXCOORD2;
+			EncodeTexCoords(TexCoords2, texCoords2, count, _conf);
+		}
+		else
+		{
+			EncodeTexCoord(out + offset, 0.0f, 0.0f, _conf);
+		}
+		offset += texCoordSize;
+	}
+
+	if (_conf.WriteColors)
+	{
+		ColorOffset = offset;
+		if (_mesh.HasVertexColors(0))
+		{
+			variant |= VERTEX_COLOR;
+			Colors.resize(count * sizeof(uint32_t));
+			PackColors(colors, (uint32_t*)Colors.data(), count);
+		}
+		else
+		{
+			Store<uint32_t>(out + offset, 0xFFFFFFFF);
+		}
+		offset += sizeof(uint32_t);
+	}
+	else if (_conf.WriteMaterialColors)
+	{
+		aiMaterial* material = _scene.mMaterials[_mesh.mMaterialIndex];
+		aiColor3D materialColor(1.0f, 1.0f, 1.0f);
+		material->Get(AI_MATKEY_COLOR_DIFFUSE, materialColor);
+		float materialOpacity = 1.0f;
+		material->Get(AI_MATKEY_OPACITY, materialOpacity);
+
+		ColorOffset = offset;
+		Store<uint32_t>(out + offset, EncodeRGBA8(materialColor.r, materialColor.g, materialColor.b, materialOpacity));
+		offset += sizeof(uint32_t);
+	}
+
+	if (_conf.WriteTangents)
+	{
+		TangentOffset = offset;
+		if (hasTangents)
+		{
+			variant |= VERTEX_TANGENT;
+
+			std::vector<aiVector3D> convertedTangents(count);
+			std::vector<aiVector3D> convertedBitangents(count);
+			ConvertUpArray(tangents, convertedTangents.data(), count, _conf.UpVector);
+			ConvertUpArray(bitangents, convertedBitangents.data(), count, _conf.UpVector);
+
+			std::vector<aiVector3D> convertedNormals(hasNormals ? count : 1);
+			ConvertUpArray(hasNormals ? normals : &DEFAULT_NORMAL, convertedNormals.data(), convertedNormals.size(), _conf.UpVector);
+
+			std::vector<float> bitangentSigns(count);
+			ComputeBitangentSigns(
+				convertedNormals.data(), hasNormals ? 1 : 0,
+				convertedTangents.data(), convertedBitangents.data(),
+				bitangentSigns.data(), count);
+
+			Tangents.resize(count * tangentSize);
+			for (size_t i = 0; i < count; ++i)
+			{
+				EncodeVector(Tangents.data() + i * tangentSize, convertedTangents[i], bitangentSigns[i], _conf);
+			}
+		}
+		else
+		{
+			// Can ignore Vec3ConvertUp here since both Y and Z are 0
+			EncodeVector(out + offset, aiVector3D(1.0f, 0.0f, 0.0f), 1.0f, _conf);
+		}
+		offset += tangentSize;
+	}
+
+	if (_conf.Morph)
+	{
+		// Addresses of morph target deltas are written over the zeroed
+		// template by WriteSceneContainer, see SMorphTargets
+		offset += sizeof(uint32_t);
+	}
+
+	if (_conf.PositionEncoding == EPositionEncoding::Quantized)
+	{
+		variant |= VERTEX_POSITION_QUANTIZED;
+	}
+
+	if (_conf.VectorEncoding != EVectorEncoding::Float)
+	{
+		variant |= VERTEX_VECTOR_PACKED;
+	}
+
+	if (_conf.TexCoordEncoding == ETexCoordEncoding::Half)
+	{
+		variant |= VERTEX_TEXCOORD_HALF;
+	}
+
+	VertexSize = offset;
+	Function = ENCODE_FUNCTIONS[variant];
+}
@@ -0,0 +1,480 @@
+#include <compress.hpp>
+#include <container.hpp>
+#include <extension.hpp>
+#include <parallel.hpp>
+
+#include <zlib.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// A file being loaded.
+struct SLoadJob
+{
+	std::string Path;
+	bool Expand = false;
+	std::atomic<int> Status{YAMC_EXT_PENDING};
+	/// The decompressed file.
+	std::vector<char> Data;
+	/// Size of the result.
+	size_t Size = 0;
+};
+
+/// Worker threads processing tasks in order in which they were queued.
+struct SThreadPool
+{
+	void Start(uint32_t _threadCount)
+	{
+		Stopping = false;
+		for (uint32_t i = 0; i < _threadCount; ++i)
+		{
+			Threads.emplace_back([this]()
+			{
+				Work();
+			});
+		}
+	}
+
+	/// Finishes all queued tasks and joins the threads.
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Stopping = true;
+		}
+		Condition.notify_all();
+		for (std::thread& thread : Threads)
+		{
+			thread.join();
+		}
+		Threads.clear();
+	}
+
+	void Push(std::function<void()> _task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			Tasks.push_back(std::move(_task));
+		}
+		Condition.notify_one();
+	}
+
+	std::vector<std::thread> Threads;
+	std::deque<std::function<void()>> Tasks;
+	std::mutex Mutex;
+	std::condition_variable Condition;
+	bool Stopping = false;
+
+private:
+	void Work()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(Mutex);
+				Condition.wait(lock, [this]()
+				{
+					return Stopping || !Tasks.empty();
+				});
+				if (Tasks.empty())
+				{
+					return;
+				}
+				task = std::move(Tasks.front());
+				Tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+/// Worker threads and jobs of the extension.
+static struct
+{
+	SThreadPool Pool;
+	std::mutex JobsMutex;
+	std::unordered_map<uint32_t, std::shared_ptr<SLoadJob>> Jobs;
+	uint32_t NextJob = 1;
+} State;
+
+static std::shared_ptr<SLoadJob> FindJob(double _job)
+{
+	std::lock_guard<std::mutex> lock(State.JobsMutex);
+	auto it = State.Jobs.find((uint32_t)_job);
+	return (it != State.Jobs.end()) ? it->second : nullptr;
+}
+
+static bool ReadFile(const std::string& _path, std::vector<char>& _out)
+{
+	std::ifstream file(_path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	_out.resize((size_t)size);
+	return (bool)file.read(_out.data(), size);
+}
+
+/// Decompresses a zlib stream. Returns false if it is not one, e.g. a plain
+/// vertex buffer that starts with a valid zlib header by chance.
+static bool DecompressZlib(const std::vector<char>& _data, std::vector<char>& _out)
+{
+	if (_data.size() < 6
+		|| ((uint8_t)_data[0] & 0x0F) != 8
+		|| ((uint8_t)_data[0] * 256 + (uint8_t)_data[1]) % 31 != 0)
+	{
+		return false;
+	}
+
+	z_stream stream = {};
+	if (inflateInit(&stream) != Z_OK)
+	{
+		return false;
+	}
+	stream.next_in = (Bytef*)_data.data();
+	stream.avail_in = (uInt)_data.size();
+
+	// Vertex data usually compress to a quarter of their size or less
+	_out.resize(_data.size() * 4);
+	int result = Z_OK;
+	while (result == Z_OK)
+	{
+		if (stream.total_out == _out.size())
+		{
+			_out.resize(_out.size() * 2);
+		}
+		stream.next_out = (Bytef*)(_out.data() + stream.total_out);
+		stream.avail_out = (uInt)(_out.size() - stream.total_out);
+		result = inflate(&stream, Z_NO_FLUSH);
+	}
+	_out.resize(stream.total_out);
+	inflateEnd(&stream);
+	return (result == Z_STREAM_END);
+}
+
+/// Finds a chunk of a YAMC container file. Returns the offset of its payload
+/// or SIZE_MAX if there is no such chunk.
+static size_t FindChunk(const std::vector<char>& _data, EChunk _id)
+{
+	uint32_t chunkCount = 0;
+	std::memcpy(&chunkCount, _data.data() + 8, 4);
+	size_t offset = 12;
+	for (uint32_t i = 0; i < chunkCount && offset + 8 <= _data.size(); ++i)
+	{
+		uint32_t header[2];
+		std::memcpy(header, _data.data() + offset, 8);
+		offset += 8;
+		if (header[0] == (uint32_t)_id)
+		{
+			return offset;
+		}
+		offset += header[1];
+	}
+	return SIZE_MAX;
+}
+
+/// Data of a decompressed file, without the header of filtered data.
+struct SLayout
+{
+	const char* Data = nullptr;
+	/// Size of the unfiltered data.
+	size_t Size = 0;
+	ECompressionFilter Filter = ECompressionFilter::None;
+	uint32_t Stride = 0;
+};
+
+/// Reads the header of filtered data, if any. Returns false if it is invalid.
+static bool GetLayout(const std::vector<char>& _data, SLayout& _layout)
+{
+	_layout.Data = _data.data();
+	_layout.Size = _data.size();
+
+	uint32_t header[4] = {};
+	if (_data.size() >= sizeof(header))
+	{
+		std::memcpy(header, _data.data(), sizeof(header));
+	}
+	if (header[0] != COMPRESSION_FILTER_MAGIC)
+	{
+		return true;
+	}
+
+	if (header[1] < (uint32_t)ECompressionFilter::Shuffle
+		|| header[1] > (uint32_t)ECompressionFilter::Delta
+		|| header[2] == 0
+		|| _data.size() - sizeof(header) != header[3])
+	{
+		return false;
+	}
+	_layout.Data = _data.data() + sizeof(header);
+	_layout.Size = header[3];
+	_layout.Filter = (ECompressionFilter)header[1];
+	_layout.Stride = header[2];
+	return true;
+}
+
+/// Undoes FilterBytes into _out, which has _layout.Size bytes.
+static void UnfilterBytes(const SLayout& _layout, char* _out)
+{
+	size_t count = _layout.Size / _layout.Stride;
+	size_t filtered = count * _layout.Stride;
+	for (uint32_t b = 0; b < _layout.Stride; ++b)
+	{
+		const char* plane = _layout.Data + b * count;
+		uint8_t value = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			value = (_layout.Filter == ECompressionFilter::Delta)
+				? (uint8_t)(value + (uint8_t)plane[i])
+				: (uint8_t)plane[i];
+			_out[i * _layout.Stride + b] = (char)value;
+		}
+	}
+	std::memcpy(_out + filtered, _layout.Data + filtered, _layout.Size - filtered);
+}
+
+/// Vertices and indices of a YAMC container file.
+struct SContainerData
+{
+	const char* Vertices = nullptr;
+	uint32_t VertexSize = 0;
+	uint32_t VertexCount = 0;
+	const char* Indices = nullptr;
+	uint32_t IndexSize = 0;
+	uint32_t IndexCount = 0;
+};
+
+static bool IsContainer(const std::vector<char>& _data)
+{
+	uint32_t magic = 0;
+	if (_data.size() >= 12)
+	{
+		std::memcpy(&magic, _data.data(), 4);
+	}
+	return (magic == YAMC_CONTAINER_MAGIC);
+}
+
+static bool GetContainerData(const std::vector<char>& _data, SContainerData& _out)
+{
+	size_t vertexOffset = FindChunk(_data, EChunk::Vertices);
+	if (vertexOffset == SIZE_MAX || vertexOffset + 12 > _data.size())
+	{
+		return false;
+	}
+	std::memcpy(&_out.VertexSize, _data.data() + vertexOffset + 4, 4);
+	std::memcpy(&_out.VertexCount, _data.data() + vertexOffset + 8, 4);
+	_out.Vertices = _data.data() + vertexOffset + 12;
+	if (vertexOffset + 12 + (size_t)_out.VertexSize * _out.VertexCount > _data.size())
+	{
+		return false;
+	}
+
+	size_t indexOffset = FindChunk(_data, EChunk::Indices);
+	if (indexOffset == SIZE_MAX)
+	{
+		return true;
+	}
+	if (indexOffset + 8 > _data.size())
+	{
+		return false;
+	}
+	std::memcpy(&_out.IndexSize, _data.data() + indexOffset, 4);
+	std::memcpy(&_out.IndexCount, _data.data() + indexOffset + 4, 4);
+	_out.Indices = _data.data() + indexOffset + 8;
+	return ((_out.IndexSize == 2 || _out.IndexSize == 4)
+		&& indexOffset + 8 + (size_t)_out.IndexSize * _out.IndexCount <= _data.size());
+}
+
+/// Reads and decompresses the file of a job and computes the size of its
+/// result. Filtered files are unfiltered here already if they have to be
+/// expanded, since containers can only be parsed unfiltered.
+static bool LoadFile(SLoadJob& _job)
+{
+	std::vector<char> file;
+	if (!ReadFile(_job.Path, file))
+	{
+		return false;
+	}
+
+	std::vector<char> decompressed;
+	_job.Data = DecompressZlib(file, decompressed) ? std::move(decompressed) : std::move(file);
+
+	SLayout layout;
+	if (!GetLayout(_job.Data, layout))
+	{
+		return false;
+	}
+
+	if (!_job.Expand)
+	{
+		_job.Size = layout.Size;
+		return true;
+	}
+
+	if (layout.Filter != ECompressionFilter::None)
+	{
+		std::vector<char> unfiltered(layout.Size);
+		UnfilterBytes(layout, unfiltered.data());
+		_job.Data = std::move(unfiltered);
+	}
+
+	if (!IsContainer(_job.Data))
+	{
+		_job.Size = _job.Data.size();
+		return true;
+	}
+
+	SContainerData container;
+	if (!GetContainerData(_job.Data, container))
+	{
+		return false;
+	}
+	_job.Size = (size_t)container.VertexSize
+		* (container.Indices ? container.IndexCount : container.VertexCount);
+	return true;
+}
+
+/// Writes the result of a job into _out.
+static bool UnpackFile(SLoadJob& _job, char* _out)
+{
+	if (!_job.Expand)
+	{
+		SLayout layout;
+		GetLayout(_job.Data, layout);
+		if (layout.Filter != ECompressionFilter::None)
+		{
+			UnfilterBytes(layout, _out);
+		}
+		else
+		{
+			std::memcpy(_out, layout.Data, layout.Size);
+		}
+		return true;
+	}
+
+	if (!IsContainer(_job.Data))
+	{
+		std::memcpy(_out, _job.Data.data(), _job.Data.size());
+		return true;
+	}
+
+	SContainerData container;
+	GetContainerData(_job.Data, container);
+	if (!container.Indices)
+	{
+		std::memcpy(_out, container.Vertices, _job.Size);
+		return true;
+	}
+
+	for (uint32_t i = 0; i < container.IndexCount; ++i)
+	{
+		uint32_t index = 0;
+		std::memcpy(&index, container.Indices + (size_t)i * container.IndexSize, container.IndexSize);
+		if (index >= container.VertexCount)
+		{
+			return false;
+		}
+		std::memcpy(_out + (size_t)i * container.VertexSize,
+			container.Vertices + (size_t)index * container.VertexSize,
+			container.VertexSize);
+	}
+	return true;
+}
+
+double yamc_ext_init(double _threads)
+{
+	if (State.Pool.Threads.empty())
+	{
+		State.Pool.Start((_threads >= 1.0) ? (uint32_t)_threads : GetDefaultThreadCount());
+	}
+	return (double)State.Pool.Threads.size();
+}
+
+double yamc_ext_shutdown()
+{
+	State.Pool.Stop();
+	std::lock_guard<std::mutex> lock(State.JobsMutex);
+	State.Jobs.clear();
+	return 1.0;
+}
+
+double yamc_ext_load(const char* _path, double _expand)
+{
+	if (State.Pool.Threads.empty())
+	{
+		return 0.0;
+	}
+
+	std::shared_ptr<SLoadJob> job = std::make_shared<SLoadJob>();
+	job->Path = _path;
+	job->Expand = (_expand != 0.0);
+
+	uint32_t id;
+	{
+		std::lock_guard<std::mutex> lock(State.JobsMutex);
+		id = State.NextJob++;
+		State.Jobs[id] = job;
+	}
+
+	State.Pool.Push([job]()
+	{
+		job->Status = LoadFile(*job) ? YAMC_EXT_READY : YAMC_EXT_FAILED;
+	});
+	return (double)id;
+}
+
+double yamc_ext_status(double _job)
+{
+	std::shared_ptr<SLoadJob> job = FindJob(_job);
+	return job ? (double)job->Status.load() : (double)YAMC_EXT_FAILED;
+}
+
+double yamc_ext_size(double _job)
+{
+	std::shared_ptr<SLoadJob> job = FindJob(_job);
+	return (job && job->Status == YAMC_EXT_READY) ? (double)job->Size : 0.0;
+}
+
+double yamc_ext_complete(double _job, const char* _address)
+{
+	std::shared_ptr<SLoadJob> job = FindJob(_job);
+	int expected = YAMC_EXT_READY;
+	if (!job || !_address || !job->Status.compare_exchange_strong(expected, YAMC_EXT_PENDING))
+	{
+		return 0.0;
+	}
+
+	char* out = (char*)_address;
+	State.Pool.Push([job, out]()
+	{
+		bool unpacked = UnpackFile(*job, out);
+		job->Data = std::vector<char>();
+		job->Status = unpacked ? YAMC_EXT_DONE : YAMC_EXT_FAILED;
+	});
+	return 1.0;
+}
+
+double yamc_ext_free(double _job)
+{
+	std::lock_guard<std::mutex> lock(State.JobsMutex);
+	auto it = State.Jobs.find((uint32_t)_job);
+	if (it == State.Jobs.end() || it->second->Status == YAMC_EXT_PENDING)
+	{
+		return 0.0;
+	}
+	State.Jobs.erase(it);
+	return 1.0;
+}
@@ -0,0 +1,301 @@
+#include <grid.hpp>
+#include <math.hpp>
+#include <parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+/// A triangle or a whole mesh instance assigned to a cell of a grid.
+struct SGridItem
+{
+	uint32_t Instance = 0;
+	/// Index of the triangle's face, or UINT32_MAX for the whole instance.
+	uint32_t Face = 0;
+	aiVector3D Centroid;
+};
+
+/// Returns the position of a vertex of a mesh instance, as it is written.
+static aiVector3D GetWrittenPosition(const aiMesh& _mesh, const SMeshInstance& _instance, uint32_t _vertex, EAxis _up)
+{
+	aiVector3D position = _instance.Transformed
+		? (_instance.Transform * _mesh.mVertices[_vertex])
+		: _mesh.mVertices[_vertex];
+	return Vec3ConvertUp(position, _up);
+}
+
+/// Returns triangles of triangle meshes and whole instances of other meshes,
+/// ordered by instance and face, with their centroids.
+static std::vector<SGridItem> GetGridItems(
+	const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf)
+{
+	std::vector<size_t> offsets(_instances.size() + 1, 0);
+	for (size_t i = 0; i < _instances.size(); ++i)
+	{
+		const aiMesh& mesh = *_scene.mMeshes[_instances[i].MeshIndex];
+		offsets[i + 1] = offsets[i] + ((mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE) ? mesh.mNumFaces : 1);
+	}
+
+	std::vector<SGridItem> items(offsets.back());
+	ParallelFor((uint32_t)_instances.size(), _conf.ThreadCount, [&](uint32_t _i)
+	{
+		const SMeshInstance& instance = _instances[_i];
+		const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+		SGridItem* out = items.data() + offsets[_i];
+
+		if (mesh.mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+		{
+			aiAABB bounds = AABBEmpty();
+			for (uint32_t v = 0; v < mesh.mNumVertices; ++v)
+			{
+				AABBAddPoint(bounds, GetWrittenPosition(mesh, instance, v, _conf.UpVector));
+			}
+			out->Instance = _i;
+			out->Face = UINT32_MAX;
+			out->Centroid = AABBIsEmpty(bounds) ? aiVector3D() : ((bounds.mMin + bounds.mMax) * 0.5f);
+			return;
+		}
+
+		for (uint32_t f = 0; f < mesh.mNumFaces; ++f)
+		{
+			const aiFace& face = mesh.mFaces[f];
+			aiVector3D centroid;
+			for (uint32_t k = 0; k < face.mNumIndices; ++k)
+			{
+				centroid += GetWrittenPosition(mesh, instance, face.mIndices[k], _conf.UpVector);
+			}
+			out[f].Instance = _i;
+			out[f].Face = f;
+			out[f].Centroid = (face.mNumIndices > 0) ? (centroid / (float)face.mNumIndices) : centroid;
+		}
+	});
+
+	return items;
+}
+
+/// Assigns items to cells of a uniform grid aligned to the origin, ordered by
+/// their coordinates in the grid. Returns the cell of each item.
+static std::vector<uint32_t> AssignUniformCells(
+	const std::vector<SGridItem>& _items, float _cellSize, std::vector<SGridCell>& _cellsOut)
+{
+	std::vector<std::array<int64_t, 3>> keys(_items.size());
+	for (size_t i = 0; i < _items.size(); ++i)
+	{
+		const aiVector3D& centroid = _items[i].Centroid;
+		keys[i] = {
+			(int64_t)std::floor(centroid.z / _cellSize),
+			(int64_t)std::floor(centroid.y / _cellSize),
+			(int64_t)std::floor(centroid.x / _cellSize),
+		};
+	}
+
+	std::vector<uint32_t> order(_items.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b)
+	{
+		return keys[_a] < keys[_b];
+	});
+
+	std::vector<uint32_t> cells(_items.size(), 0);
+	for (size_t k = 0; k < order.size(); ++k)
+	{
+		const std::array<int64_t, 3>& key = keys[order[k]];
+		if (k == 0 || key != keys[order[k - 1]])
+		{
+			SGridCell cell;
+			cell.Origin = aiVector3D(
+				((float)key[2] + 0.5f) * _cellSize,
+				((float)key[1] + 0.5f) * _cellSize,
+				((float)key[0] + 0.5f) * _cellSize);
+			_cellsOut.push_back(cell);
+		}
+		cells[order[k]] = (uint32_t)_cellsOut.size() - 1;
+	}
+
+	return cells;
+}
+
+/// Recursively subdivides a cell of an octree with items _order[_begin] to
+/// _order[_end - 1] into octants until it has at most _maxItems items and
+/// writes the cell of each item into _cells. Leaves become cells in
+/// depth-first order, so that neighboring cells are mostly written together.
+static void SubdivideOctree(
+	const std::vector<SGridItem>& _items,
+	std::vector<uint32_t>& _order,
+	size_t _begin,
+	size_t _end,
+	const aiVector3D& _center,
+	float _halfSize,
+	uint32_t _depth,
+	uint32_t _maxItems,
+	std::vector<uint32_t>& _cells,
+	std::vector<SGridCell>& _cellsOut)
+{
+	if (_end - _begin <= _maxItems || _depth >= GRID_OCTREE_MAX_DEPTH)
+	{
+		SGridCell cell;
+		cell.Origin = _center;
+		for (size_t k = _begin; k < _end; ++k)
+		{
+			_cells[_order[k]] = (uint32_t)_cellsOut.size();
+		}
+		_cellsOut.push_back(cell);
+		return;
+	}
+
+	// Stable counting sort of items by their octant
+	auto getOctant = [&](uint32_t _item)
+	{
+		const aiVector3D& centroid = _items[_item].Centroid;
+		return (uint32_t)((centroid.x >= _center.x) ? 1 : 0)
+			| ((centroid.y >= _center.y) ? 2 : 0)
+			| ((centroid.z >= _center.z) ? 4 : 0);
+	};
+
+	std::array<size_t, 9> offsets = {};
+	for (size_t k = _begin; k < _end; ++k)
+	{
+		++offsets[getOctant(_order[k]) + 1];
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	std::vector<uint32_t> sorted(_end - _begin);
+	std::array<size_t, 8> cursors;
+	std::copy(offsets.begin(), offsets.end() - 1, cursors.begin());
+	for (size_t k = _begin; k < _end; ++k)
+	{
+		sorted[cursors[getOctant(_order[k])]++] = _order[k];
+	}
+	std::copy(sorted.begin(), sorted.end(), _order.begin() + _begin);
+
+	float quarterSize = _halfSize * 0.5f;
+	for (uint32_t o = 0; o < 8; ++o)
+	{
+		if (offsets[o] == offsets[o + 1])
+		{
+			continue;
+		}
+		aiVector3D center(
+			_center.x + (((o & 1) != 0) ? quarterSize : -quarterSize),
+			_center.y + (((o & 2) != 0) ? quarterSize : -quarterSize),
+			_center.z + (((o & 4) != 0) ? quarterSize : -quarterSize));
+		SubdivideOctree(
+			_items, _order, _begin + offsets[o], _begin + offsets[o + 1],
+			center, quarterSize, _depth + 1, _maxItems, _cells, _cellsOut);
+	}
+}
+
+/// Assigns items to leaves of an octree enclosing all their centroids.
+/// Returns the cell of each item.
+static std::vector<uint32_t> AssignOctreeCells(
+	const std::vector<SGridItem>& _items, uint32_t _maxItems, std::vector<SGridCell>& _cellsOut)
+{
+	aiAABB bounds = AABBEmpty();
+	for (const SGridItem& item : _items)
+	{
+		AABBAddPoint(bounds, item.Centroid);
+	}
+
+	aiVector3D extent = bounds.mMax - bounds.mMin;
+	float halfSize = std::max(extent.x, std::max(extent.y, extent.z)) * 0.5f;
+
+	std::vector<uint32_t> order(_items.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::vector<uint32_t> cells(_items.size(), 0);
+	SubdivideOctree(
+		_items, order, 0, order.size(), (bounds.mMin + bounds.mMax) * 0.5f, halfSize,
+		0, std::max(_maxItems, 1u), cells, _cellsOut);
+	return cells;
+}
+
+SSpatialGrid BuildSpatialGrid(const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf)
+{
+	SSpatialGrid grid;
+
+	std::vector<SGridItem> items = GetGridItems(_scene, _instances, _conf);
+	if (items.empty())
+	{
+		return grid;
+	}
+
+	std::vector<uint32_t> itemCells = (_conf.Grid == EGrid::Octree)
+		? AssignOctreeCells(items, _conf.GridCellTriangles, grid.Cells)
+		: AssignUniformCells(items, _conf.GridCellSize, grid.Cells);
+
+	// Items grouped by cell, keeping their order by instance and face within
+	// each cell
+	std::vector<size_t> offsets(grid.Cells.size() + 1, 0);
+	for (uint32_t cell : itemCells)
+	{
+		++offsets[cell + 1];
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	std::vector<uint32_t> order(items.size());
+	{
+		std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+		for (uint32_t i = 0; i < (uint32_t)items.size(); ++i)
+		{
+			order[cursors[itemCells[i]]++] = i;
+		}
+	}
+
+	// Runs of triangles of the same instance in the same cell become
+	// instances with their own triangle lists. These are allocated upfront,
+	// since instances point to them.
+	size_t triangleListCount = 0;
+	for (size_t k = 0; k < order.size(); ++k)
+	{
+		const SGridItem& item = items[order[k]];
+		if (item.Face != UINT32_MAX
+			&& (k == 0
+				|| itemCells[order[k - 1]] != itemCells[order[k]]
+				|| items[order[k - 1]].Instance != item.Instance))
+		{
+			++triangleListCount;
+		}
+	}
+	grid.Triangles.reserve(triangleListCount);
+
+	for (uint32_t c = 0; c < (uint32_t)grid.Cells.size(); ++c)
+	{
+		SGridCell& cell = grid.Cells[c];
+		cell.Box = AABBEmpty();
+
+		for (size_t k = offsets[c]; k < offsets[c + 1]; ++k)
+		{
+			const SGridItem& item = items[order[k]];
+			const SMeshInstance& instance = _instances[item.Instance];
+			const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+
+			if (item.Face == UINT32_MAX)
+			{
+				for (uint32_t v = 0; v < mesh.mNumVertices; ++v)
+				{
+					AABBAddPoint(cell.Box, GetWrittenPosition(mesh, instance, v, _conf.UpVector));
+				}
+				grid.Instances.push_back(instance);
+				grid.Instances.back().Cell = c;
+				continue;
+			}
+
+			if (k == offsets[c] || items[order[k - 1]].Instance != item.Instance)
+			{
+				grid.Triangles.emplace_back();
+				grid.Instances.push_back(instance);
+				grid.Instances.back().Cell = c;
+				grid.Instances.back().Triangles = &grid.Triangles.back();
+			}
+
+			const aiFace& face = mesh.mFaces[item.Face];
+			for (uint32_t i = 0; i < face.mNumIndices; ++i)
+			{
+				grid.Triangles.back().push_back(face.mIndices[i]);
+				AABBAddPoint(cell.Box, GetWrittenPosition(mesh, instance, face.mIndices[i], _conf.UpVector));
+			}
+			++cell.TriangleCount;
+		}
+	}
+
+	return grid;
+}
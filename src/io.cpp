@@ -0,0 +1,280 @@
+#include <io.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// Adds time elapsed since its construction to an atomic counter of
+/// nanoseconds on destruction. Does nothing if the counter is nullptr.
+struct SReadTimer
+{
+	explicit SReadTimer(std::atomic<uint64_t>* _counter)
+		: Counter(_counter)
+	{
+		if (Counter)
+		{
+			Start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~SReadTimer()
+	{
+		if (Counter)
+		{
+			auto duration = std::chrono::steady_clock::now() - Start;
+			*Counter += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+		}
+	}
+
+	std::atomic<uint64_t>* Counter;
+	std::chrono::steady_clock::time_point Start;
+};
+
+#ifdef _WIN32
+#define FILE_SEEK _fseeki64
+#define FILE_TELL _ftelli64
+#else
+#define FILE_SEEK fseeko
+#define FILE_TELL ftello
+#endif
+
+SFileIOStream::SFileIOStream(FILE* _file)
+	: File(_file)
+{
+}
+
+SFileIOStream::~SFileIOStream()
+{
+	fclose(File);
+}
+
+size_t SFileIOStream::Read(void* _buffer, size_t _size, size_t _count)
+{
+	SReadTimer timer(ReadTime);
+	return fread(_buffer, _size, _count, File);
+}
+
+size_t SFileIOStream::Write(const void* _buffer, size_t _size, size_t _count)
+{
+	return fwrite(_buffer, _size, _count, File);
+}
+
+aiReturn SFileIOStream::Seek(size_t _offset, aiOrigin _origin)
+{
+	int origin = (_origin == aiOrigin_CUR) ? SEEK_CUR
+		: ((_origin == aiOrigin_END) ? SEEK_END : SEEK_SET);
+	return (FILE_SEEK(File, _offset, origin) == 0) ? aiReturn_SUCCESS : aiReturn_FAILURE;
+}
+
+size_t SFileIOStream::Tell() const
+{
+	return (size_t)FILE_TELL(File);
+}
+
+size_t SFileIOStream::FileSize() const
+{
+	auto position = FILE_TELL(File);
+	FILE_SEEK(File, 0, SEEK_END);
+	auto size = FILE_TELL(File);
+	FILE_SEEK(File, position, SEEK_SET);
+	return (size_t)size;
+}
+
+void SFileIOStream::Flush()
+{
+	fflush(File);
+}
+
+SMappedIOStream* SMappedIOStream::Open(const char* _path)
+{
+	void* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(_path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (GetFileType(file) == FILE_TYPE_DISK
+		&& GetFileSizeEx(file, &fileSize)
+		&& fileSize.QuadPart > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			size = (size_t)fileSize.QuadPart;
+			// The view keeps the mapping alive
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = open(_path, O_RDONLY);
+	if (file == -1)
+	{
+		return nullptr;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) == 0
+		&& S_ISREG(info.st_mode)
+		&& info.st_size > 0)
+	{
+		size = (size_t)info.st_size;
+		data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED)
+		{
+			data = nullptr;
+		}
+		else
+		{
+			madvise(data, size, MADV_SEQUENTIAL);
+		}
+	}
+	// The mapping stays valid after closing the file
+	close(file);
+#endif
+
+	if (!data)
+	{
+		return nullptr;
+	}
+
+	SMappedIOStream* stream = new SMappedIOStream();
+	stream->Data = (const char*)data;
+	stream->Size = size;
+	return stream;
+}
+
+SMappedIOStream::~SMappedIOStream()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(Data);
+#else
+	munmap((void*)Data, Size);
+#endif
+}
+
+size_t SMappedIOStream::Read(void* _buffer, size_t _size, size_t _count)
+{
+	SReadTimer timer(ReadTime);
+	if (_size == 0 || Position >= Size)
+	{
+		return 0;
+	}
+	size_t count = std::min(_count, (Size - Position) / _size);
+	std::memcpy(_buffer, Data + Position, count * _size);
+	Position += count * _size;
+	return count;
+}
+
+size_t SMappedIOStream::Write(const void* /*_buffer*/, size_t /*_size*/, size_t /*_count*/)
+{
+	return 0;
+}
+
+aiReturn SMappedIOStream::Seek(size_t _offset, aiOrigin _origin)
+{
+	size_t base = (_origin == aiOrigin_CUR) ? Position
+		: ((_origin == aiOrigin_END) ? Size : 0);
+	if (base + _offset > Size)
+	{
+		return aiReturn_FAILURE;
+	}
+	Position = base + _offset;
+	return aiReturn_SUCCESS;
+}
+
+size_t SMappedIOStream::Tell() const
+{
+	return Position;
+}
+
+size_t SMappedIOStream::FileSize() const
+{
+	return Size;
+}
+
+void SMappedIOStream::Flush()
+{
+}
+
+bool SFileIOSystem::Exists(const char* _path) const
+{
+	std::error_code error;
+	return std::filesystem::exists(std::filesystem::path(_path), error);
+}
+
+char SFileIOSystem::getOsSeparator() const
+{
+#ifdef _WIN32
+	return '\\';
+#else
+	return '/';
+#endif
+}
+
+Assimp::IOStream* SFileIOSystem::Open(const char* _path, const char* _mode)
+{
+	bool reading = (strchr(_mode, 'w') == nullptr
+		&& strchr(_mode, 'a') == nullptr
+		&& strchr(_mode, '+') == nullptr);
+	std::atomic<uint64_t>* readTime = (reading && MeasureReadTime) ? &ReadTime : nullptr;
+	SReadTimer timer(readTime);
+
+	// Pipes, empty files etc. cannot be mapped and fall back to stdio
+	Assimp::IOStream* stream = nullptr;
+	if (SMappedIOStream* mapped = (reading ? SMappedIOStream::Open(_path) : nullptr))
+	{
+		mapped->ReadTime = readTime;
+		stream = mapped;
+	}
+	else
+	{
+		FILE* file = fopen(_path, _mode);
+		if (!file)
+		{
+			return nullptr;
+		}
+		SFileIOStream* fileStream = new SFileIOStream(file);
+		fileStream->ReadTime = readTime;
+		stream = fileStream;
+	}
+
+	if (reading)
+	{
+		std::error_code error;
+		std::string path = std::filesystem::absolute(std::filesystem::path(_path), error)
+			.lexically_normal().string();
+
+		std::lock_guard<std::mutex> lock(Mutex);
+		if (std::find(OpenedFiles.begin(), OpenedFiles.end(), path) == OpenedFiles.end())
+		{
+			OpenedFiles.push_back(path);
+		}
+	}
+
+	return stream;
+}
+
+void SFileIOSystem::Close(Assimp::IOStream* _stream)
+{
+	delete _stream;
+}
@@ -0,0 +1,353 @@
+#include <encoding.hpp>
+#include <kernels.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KERNELS_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(KERNELS_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define KERNELS_AVX2
+#endif
+
+// MSVC allows AVX2 intrinsics anywhere, GCC and Clang only in functions
+// compiled for AVX2
+#if defined(__GNUC__)
+#define KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KERNEL_TARGET_AVX2
+#endif
+
+static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "Kernels require single precision Assimp!");
+static_assert(sizeof(aiColor4D) == 4 * sizeof(float), "Kernels require single precision Assimp!");
+
+#ifdef KERNELS_AVX2
+static bool DetectAVX2()
+{
+#if defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS must save AVX registers on context switches
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+static bool HasAVX2()
+{
+	static const bool hasAVX2 = DetectAVX2();
+	return hasAVX2;
+}
+#endif
+
+const char* GetKernelInstructionSet()
+{
+#if defined(KERNELS_AVX2)
+	if (HasAVX2())
+	{
+		return "AVX2";
+	}
+#endif
+#if defined(KERNELS_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+#ifdef KERNELS_SSE2
+/// Loads four consecutive vectors and transposes them into X, Y and Z.
+static inline void LoadVec3x4(const float* _in, __m128& _x, __m128& _y, __m128& _z)
+{
+	// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+	__m128 a0 = _mm_loadu_ps(_in);
+	__m128 a1 = _mm_loadu_ps(_in + 4);
+	__m128 a2 = _mm_loadu_ps(_in + 8);
+
+	__m128 t = _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(1, 1, 2, 2));
+	_x = _mm_shuffle_ps(a0, t, _MM_SHUFFLE(2, 0, 3, 0));
+
+	t = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(0, 0, 1, 1));
+	__m128 u = _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(2, 2, 3, 3));
+	_y = _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 2, 0));
+
+	t = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 1, 2, 2));
+	_z = _mm_shuffle_ps(t, a2, _MM_SHUFFLE(3, 0, 2, 0));
+}
+#endif
+
+/// Flips signs of Y and Z of vectors stored as a flat array of floats.
+static size_t NegateYZScalar(const float* _in, float* _out, size_t _start, size_t _count)
+{
+	for (size_t i = _start; i < _count; ++i)
+	{
+		_out[i * 3 + 0] = _in[i * 3 + 0];
+		_out[i * 3 + 1] = -_in[i * 3 + 1];
+		_out[i * 3 + 2] = -_in[i * 3 + 2];
+	}
+	return _count;
+}
+
+#ifdef KERNELS_SSE2
+static size_t NegateYZSSE2(const float* _in, float* _out, size_t _count)
+{
+	// Sign masks for four vectors, i.e. twelve floats
+	float pattern[12];
+	for (int i = 0; i < 12; ++i)
+	{
+		pattern[i] = ((i % 3) != 0) ? -0.0f : 0.0f;
+	}
+	__m128 m0 = _mm_loadu_ps(pattern);
+	__m128 m1 = _mm_loadu_ps(pattern + 4);
+	__m128 m2 = _mm_loadu_ps(pattern + 8);
+
+	size_t i = 0;
+	for (; i + 4 <= _count; i += 4)
+	{
+		const float* in = _in + i * 3;
+		float* out = _out + i * 3;
+		__m128 a0 = _mm_loadu_ps(in);
+		__m128 a1 = _mm_loadu_ps(in + 4);
+		__m128 a2 = _mm_loadu_ps(in + 8);
+		_mm_storeu_ps(out, _mm_xor_ps(a0, m0));
+		_mm_storeu_ps(out + 4, _mm_xor_ps(a1, m1));
+		_mm_storeu_ps(out + 8, _mm_xor_ps(a2, m2));
+	}
+	return i;
+}
+#endif
+
+#ifdef KERNELS_AVX2
+KERNEL_TARGET_AVX2
+static size_t NegateYZAVX2(const float* _in, float* _out, size_t _count)
+{
+	// Sign masks for eight vectors, i.e. twenty four floats
+	float pattern[24];
+	for (int i = 0; i < 24; ++i)
+	{
+		pattern[i] = ((i % 3) != 0) ? -0.0f : 0.0f;
+	}
+	__m256 m0 = _mm256_loadu_ps(pattern);
+	__m256 m1 = _mm256_loadu_ps(pattern + 8);
+	__m256 m2 = _mm256_loadu_ps(pattern + 16);
+
+	size_t i = 0;
+	for (; i + 8 <= _count; i += 8)
+	{
+		const float* in = _in + i * 3;
+		float* out = _out + i * 3;
+		__m256 a0 = _mm256_loadu_ps(in);
+		__m256 a1 = _mm256_loadu_ps(in + 8);
+		__m256 a2 = _mm256_loadu_ps(in + 16);
+		_mm256_storeu_ps(out, _mm256_xor_ps(a0, m0));
+		_mm256_storeu_ps(out + 8, _mm256_xor_ps(a1, m1));
+		_mm256_storeu_ps(out + 16, _mm256_xor_ps(a2, m2));
+	}
+	return i;
+}
+#endif
+
+void ConvertUpArray(const aiVector3D* _in, aiVector3D* _out, size_t _count, EAxis _up)
+{
+	if (_up != EAxis::NegativeY)
+	{
+		for (size_t i = 0; i < _count; ++i)
+		{
+			_out[i] = Vec3ConvertUp(_in[i], _up);
+		}
+		return;
+	}
+
+	const float* in = &_in[0].x;
+	float* out = &_out[0].x;
+	size_t done = 0;
+
+#if defined(KERNELS_AVX2)
+	if (HasAVX2())
+	{
+		done = NegateYZAVX2(in, out, _count);
+	}
+	else
+#endif
+	{
+#if defined(KERNELS_SSE2)
+		done = NegateYZSSE2(in, out, _count);
+#endif
+	}
+
+	NegateYZScalar(in, out, done, _count);
+}
+
+void ComputeBitangentSigns(
+	const aiVector3D* _normals,
+	size_t _normalStride,
+	const aiVector3D* _tangents,
+	const aiVector3D* _bitangents,
+	float* _out,
+	size_t _count)
+{
+	size_t i = 0;
+
+#if defined(KERNELS_SSE2)
+	if (_normalStride <= 1 && _count >= 4)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 minusOne = _mm_set1_ps(-1.0f);
+		__m128 nx = _mm_set1_ps(_normals[0].x);
+		__m128 ny = _mm_set1_ps(_normals[0].y);
+		__m128 nz = _mm_set1_ps(_normals[0].z);
+
+		for (; i + 4 <= _count; i += 4)
+		{
+			if (_normalStride == 1)
+			{
+				LoadVec3x4(&_normals[i].x, nx, ny, nz);
+			}
+
+			__m128 tx, ty, tz, bx, by, bz;
+			LoadVec3x4(&_tangents[i].x, tx, ty, tz);
+			LoadVec3x4(&_bitangents[i].x, bx, by, bz);
+
+			// Same order of operations as in GetBitangentSign
+			__m128 cx = _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty));
+			__m128 cy = _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz));
+			__m128 cz = _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx));
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, bx), _mm_mul_ps(cy, by)), _mm_mul_ps(cz, bz));
+
+			__m128 negative = _mm_cmplt_ps(dot, zero);
+			_mm_storeu_ps(_out + i, _mm_or_ps(_mm_and_ps(negative, minusOne), _mm_andnot_ps(negative, one)));
+		}
+	}
+#endif
+
+	for (; i < _count; ++i)
+	{
+		_out[i] = GetBitangentSign(_normals[i * _normalStride], _tangents[i], _bitangents[i]);
+	}
+}
+
+void ExtractTexCoords(const aiVector3D* _in, float* _out, size_t _count, bool _flip)
+{
+	size_t i = 0;
+
+#if defined(KERNELS_SSE2)
+	__m128 one = _mm_set1_ps(1.0f);
+
+	for (; i + 4 <= _count; i += 4)
+	{
+		__m128 u, v, w;
+		LoadVec3x4(&_in[i].x, u, v, w);
+		if (_flip)
+		{
+			v = _mm_sub_ps(one, v);
+		}
+		_mm_storeu_ps(_out + i * 2, _mm_unpacklo_ps(u, v));
+		_mm_storeu_ps(_out + i * 2 + 4, _mm_unpackhi_ps(u, v));
+	}
+#endif
+
+	for (; i < _count; ++i)
+	{
+		_out[i * 2] = _in[i].x;
+		_out[i * 2 + 1] = _flip ? (1.0f - _in[i].y) : _in[i].y;
+	}
+}
+
+#ifdef KERNELS_SSE2
+/// Clamps, scales and rounds a color the same way as EncodeUNorm8.
+static inline __m128i QuantizeColor(__m128 _color)
+{
+	_color = _mm_min_ps(_color, _mm_set1_ps(1.0f));
+	_color = _mm_max_ps(_color, _mm_setzero_ps());
+	_color = _mm_add_ps(_mm_mul_ps(_color, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+	return _mm_cvttps_epi32(_color);
+}
+
+static size_t PackColorsSSE2(const aiColor4D* _in, uint32_t* _out, size_t _count)
+{
+	size_t i = 0;
+	for (; i + 4 <= _count; i += 4)
+	{
+		__m128i c0 = QuantizeColor(_mm_loadu_ps(&_in[i].r));
+		__m128i c1 = QuantizeColor(_mm_loadu_ps(&_in[i + 1].r));
+		__m128i c2 = QuantizeColor(_mm_loadu_ps(&_in[i + 2].r));
+		__m128i c3 = QuantizeColor(_mm_loadu_ps(&_in[i + 3].r));
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+		_mm_storeu_si128((__m128i*)(_out + i), packed);
+	}
+	return i;
+}
+#endif
+
+#ifdef KERNELS_AVX2
+KERNEL_TARGET_AVX2
+static inline __m256i QuantizeColorAVX2(__m256 _colors)
+{
+	_colors = _mm256_min_ps(_colors, _mm256_set1_ps(1.0f));
+	_colors = _mm256_max_ps(_colors, _mm256_setzero_ps());
+	_colors = _mm256_add_ps(_mm256_mul_ps(_colors, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f));
+	return _mm256_cvttps_epi32(_colors);
+}
+
+KERNEL_TARGET_AVX2
+static size_t PackColorsAVX2(const aiColor4D* _in, uint32_t* _out, size_t _count)
+{
+	// Packing works within 128-bit lanes, so colors end up in order
+	// 0 2 4 6 1 3 5 7
+	__m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	size_t i = 0;
+	for (; i + 8 <= _count; i += 8)
+	{
+		const float* in = &_in[i].r;
+		__m256i c01 = QuantizeColorAVX2(_mm256_loadu_ps(in));
+		__m256i c23 = QuantizeColorAVX2(_mm256_loadu_ps(in + 8));
+		__m256i c45 = QuantizeColorAVX2(_mm256_loadu_ps(in + 16));
+		__m256i c67 = QuantizeColorAVX2(_mm256_loadu_ps(in + 24));
+		__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(c01, c23), _mm256_packs_epi32(c45, c67));
+		_mm256_storeu_si256((__m256i*)(_out + i), _mm256_permutevar8x32_epi32(packed, order));
+	}
+	return i;
+}
+#endif
+
+void PackColors(const aiColor4D* _in, uint32_t* _out, size_t _count)
+{
+	size_t i = 0;
+
+#if defined(KERNELS_AVX2)
+	if (HasAVX2())
+	{
+		i = PackColorsAVX2(_in, _out, _count);
+	}
+#endif
+#if defined(KERNELS_SSE2)
+	i += PackColorsSSE2(_in + i, _out + i, _count - i);
+#endif
+
+	for (; i < _count; ++i)
+	{
+		const aiColor4D& color = _in[i];
+		_out[i] = EncodeRGBA8(color.r, color.g, color.b, color.a);
+	}
+}
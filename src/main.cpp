@@ -1,12 +1,13 @@
 #include <Args.hpp>
 #include <Config.hpp>
-#include <writing.hpp>
+#include <batch.hpp>
+#include <cache.hpp>
+#include <convert.hpp>
+#include <profiler.hpp>
 
 #include <assimp/Importer.hpp>
-#include <assimp/scene.h>
 
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 
 int main(int argc, const char** argv)
@@ -20,23 +21,20 @@ int main(int argc, const char** argv)
 	SConfig conf;
 	conf.FromArgs(args);
 
-	Assimp::Importer importer;
-
-	const aiScene* scene = importer.ReadFile(args.PathIn, conf.Flags);
-	if (!scene)
+	if (args.Batch)
 	{
-		std::cout << "ERROR: Could not load model " << args.PathIn << "!" << std::endl;
-		return EXIT_FAILURE;
+		return RunBatch(args, conf);
 	}
 
-	if (scene->mNumMeshes == 0)
+	if (conf.Cache && IsCacheUpToDate(args.PathIn, args.PathOut, conf))
 	{
-		std::cout << "INFO: Model has no meshes, quitting..." << std::endl;
+		std::cout << "INFO: Output file " << args.PathOut << " is up to date, quitting..." << std::endl;
 		return EXIT_SUCCESS;
 	}
 
 	if (!args.OverrideOutputFile
-		&& std::filesystem::exists(std::filesystem::path(args.PathOut)))
+		&& std::filesystem::exists(std::filesystem::path(args.PathOut))
+		&& !(conf.Cache && HasCacheManifest(args.PathOut)))
 	{
 		std::cout << "Output file already exists! Would you like to override it? (y/n): ";
 		while (true)
@@ -53,21 +51,26 @@ int main(int argc, const char** argv)
 		}
 	}
 
-	std::ofstream file(args.PathOut, std::ios::out | std::ios::binary);
-	if (!file.is_open())
-	{
-		std::cout << "ERROR: Could not open file " << args.PathOut << " for writing!" << std::endl;
-		return EXIT_FAILURE;
-	}
+	Assimp::Importer importer;
+	SProfiler profiler;
+
+	EConvertResult result = ConvertFile(importer, args.PathIn, args.PathOut, conf, std::cout,
+		conf.Profile ? &profiler : nullptr);
 
-	if (!WriteScene(file, *scene, conf))
+	if (conf.Profile && !profiler.Events.empty())
 	{
-		return EXIT_FAILURE;
-	}
+		profiler.PrintBreakdown(std::cout);
 
-	file.flush();
-	file.close();
+		if (!conf.ProfileTrace.empty())
+		{
+			if (!profiler.WriteChromeTrace(conf.ProfileTrace))
+			{
+				std::cout << "ERROR: Could not write trace " << conf.ProfileTrace << "!" << std::endl;
+				return EXIT_FAILURE;
+			}
+			std::cout << "INFO: Wrote trace to " << conf.ProfileTrace << std::endl;
+		}
+	}
 
-	std::cout << "SUCCESS: Wrote vertex buffer to " << args.PathOut << "!" << std::endl;
-	return EXIT_SUCCESS;
+	return (result == EConvertResult::Failed) ? EXIT_FAILURE : EXIT_SUCCESS;
 }
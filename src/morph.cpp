@@ -0,0 +1,354 @@
+#include <math.hpp>
+#include <morph.hpp>
+#include <parallel.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+/// An offset of a vertex of a mesh by a morph target, before quantization.
+struct SMorphDelta
+{
+	uint32_t Vertex = 0;
+	uint32_t Target = 0;
+	aiVector3D Position;
+	aiVector3D Normal;
+};
+
+/// Returns a normal of a mesh instance as it is written, i.e. transformed by
+/// _normalMatrix (unless it is nullptr), normalized and converted into the up
+/// axis.
+static aiVector3D GetWrittenNormal(const aiVector3D& _normal, const aiMatrix3x3* _normalMatrix, EAxis _up)
+{
+	aiVector3D normal = _normal;
+	if (_normalMatrix)
+	{
+		normal = ((*_normalMatrix) * _normal).NormalizeSafe();
+	}
+	return Vec3ConvertUp(normal, _up);
+}
+
+/// Returns offsets of vertices _vertices of a mesh instance by each of its
+/// morph targets, in the order of the vertices. _targets maps animation meshes
+/// of the mesh to indices of targets, UINT32_MAX for ones that are skipped.
+/// Offsets that are exactly zero are dropped.
+static std::vector<SMorphDelta> CollectDeltas(
+	const aiMesh& _mesh,
+	const SMeshInstance& _instance,
+	const std::vector<uint32_t>& _targets,
+	const std::vector<uint32_t>& _vertices,
+	const SConfig& _conf)
+{
+	aiMatrix3x3 matrix(_instance.Transform);
+	aiMatrix3x3 normalMatrix = aiMatrix3x3(_instance.Transform).Inverse().Transpose();
+	bool writeNormals = (_conf.WriteNormals && _mesh.HasNormals());
+
+	std::vector<SMorphDelta> deltas;
+	for (uint32_t v : _vertices)
+	{
+		for (uint32_t a = 0; a < _mesh.mNumAnimMeshes; ++a)
+		{
+			const aiAnimMesh& anim = *_mesh.mAnimMeshes[a];
+			if (_targets[a] == UINT32_MAX)
+			{
+				continue;
+			}
+
+			SMorphDelta delta;
+			delta.Vertex = v;
+			delta.Target = _targets[a];
+
+			if (anim.HasPositions())
+			{
+				aiVector3D offset = anim.mVertices[v] - _mesh.mVertices[v];
+				delta.Position = Vec3ConvertUp(_instance.Transformed ? (matrix * offset) : offset, _conf.UpVector);
+			}
+
+			if (writeNormals && anim.HasNormals())
+			{
+				const aiMatrix3x3* transform = _instance.Transformed ? &normalMatrix : nullptr;
+				delta.Normal = GetWrittenNormal(anim.mNormals[v], transform, _conf.UpVector)
+					- GetWrittenNormal(_mesh.mNormals[v], transform, _conf.UpVector);
+			}
+
+			if (delta.Position != aiVector3D() || delta.Normal != aiVector3D())
+			{
+				deltas.push_back(delta);
+			}
+		}
+	}
+
+	return deltas;
+}
+
+/// Quantizes a coordinate of a position offset into a 16-bit signed integer
+/// relative to _scale.
+static int16_t QuantizePositionOffset(float _value, float _scale)
+{
+	return (_scale > 0.0f)
+		? (int16_t)std::lround(std::clamp(_value / _scale, -1.0f, 1.0f) * 32767.0f)
+		: 0;
+}
+
+/// Quantizes a coordinate of a normal offset, which is in range [-2, 2] since
+/// both normals are unit vectors, into an 8-bit signed integer.
+static int8_t QuantizeNormalOffset(float _value)
+{
+	return (int8_t)std::lround(std::clamp(_value * 0.5f, -1.0f, 1.0f) * 127.0f);
+}
+
+bool BuildMorphTargets(
+	const aiScene& _scene,
+	const std::vector<SMeshInstance>& _instances,
+	const SConfig& _conf,
+	SMorphTargets& _out,
+	std::ostream& _log)
+{
+	_out = SMorphTargets();
+	_out.Addresses.resize(_instances.size());
+
+	// Targets get indices in order of their first reference, so that targets
+	// with the same name in multiple meshes are blended by the same weight
+	std::vector<std::vector<uint32_t>> meshTargets(_scene.mNumMeshes);
+	std::vector<bool> visited(_scene.mNumMeshes, false);
+	std::unordered_map<std::string, uint32_t> targetIndices;
+	for (const SMeshInstance& instance : _instances)
+	{
+		if (visited[instance.MeshIndex])
+		{
+			continue;
+		}
+		visited[instance.MeshIndex] = true;
+
+		const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+		std::vector<uint32_t>& targets = meshTargets[instance.MeshIndex];
+		targets.resize(mesh.mNumAnimMeshes, UINT32_MAX);
+		for (uint32_t a = 0; a < mesh.mNumAnimMeshes; ++a)
+		{
+			const aiAnimMesh& anim = *mesh.mAnimMeshes[a];
+			if (anim.mNumVertices != mesh.mNumVertices)
+			{
+				_log
+					<< "WARNING: Morph target " << a << " of mesh " << mesh.mName.C_Str()
+					<< " does not match its vertices and is skipped!" << std::endl;
+				continue;
+			}
+
+			std::string name = (anim.mName.length > 0) ? anim.mName.C_Str() : std::to_string(a);
+			auto inserted = targetIndices.emplace(name, (uint32_t)_out.Targets.size());
+			if (inserted.second)
+			{
+				SMorphTarget target;
+				target.Name = name;
+				target.Weight = anim.mWeight;
+				_out.Targets.push_back(target);
+			}
+			targets[a] = inserted.first->second;
+		}
+	}
+
+	if (_out.Targets.size() > MORPH_MAX_TARGETS)
+	{
+		_log
+			<< "ERROR: Model has " << _out.Targets.size() << " morph targets, but at most "
+			<< MORPH_MAX_TARGETS << " are supported!" << std::endl;
+		return false;
+	}
+
+	if (_out.Targets.empty())
+	{
+		return true;
+	}
+
+	// Instances of the same mesh with the same transform, i.e. its levels of
+	// detail, cells of the grid and clusters, share deltas
+	uint32_t instanceCount = (uint32_t)_instances.size();
+	std::vector<std::vector<uint32_t>> groups;
+	std::vector<uint32_t> groupOf(instanceCount, UINT32_MAX);
+	std::vector<std::vector<uint32_t>> groupsOfMesh(_scene.mNumMeshes);
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		const SMeshInstance& instance = _instances[i];
+		if (_scene.mMeshes[instance.MeshIndex]->mNumAnimMeshes == 0)
+		{
+			continue;
+		}
+
+		for (uint32_t group : groupsOfMesh[instance.MeshIndex])
+		{
+			if (_instances[groups[group][0]].Transform == instance.Transform)
+			{
+				groupOf[i] = group;
+				break;
+			}
+		}
+
+		if (groupOf[i] == UINT32_MAX)
+		{
+			groupOf[i] = (uint32_t)groups.size();
+			groupsOfMesh[instance.MeshIndex].push_back(groupOf[i]);
+			groups.emplace_back();
+		}
+		groups[groupOf[i]].push_back(i);
+	}
+
+	std::vector<std::vector<uint32_t>> faceIndices(instanceCount);
+	ParallelFor(instanceCount, _conf.ThreadCount, [&](uint32_t _i)
+	{
+		if (groupOf[_i] != UINT32_MAX)
+		{
+			faceIndices[_i] = GetFaceIndices(*_scene.mMeshes[_instances[_i].MeshIndex], _conf, &_instances[_i]);
+		}
+	});
+
+	// Offsets are collected for vertices in order of their first use by
+	// instances of the group, so that deltas follow the order of written
+	// vertices
+	uint32_t groupCount = (uint32_t)groups.size();
+	std::vector<std::vector<SMorphDelta>> deltas(groupCount);
+	std::vector<float> scales(groupCount, 0.0f);
+	ParallelFor(groupCount, _conf.ThreadCount, [&](uint32_t _g)
+	{
+		const SMeshInstance& instance = _instances[groups[_g][0]];
+		const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+
+		std::vector<bool> used(mesh.mNumVertices, false);
+		std::vector<uint32_t> vertices;
+		for (uint32_t i : groups[_g])
+		{
+			for (uint32_t index : faceIndices[i])
+			{
+				if (!used[index])
+				{
+					used[index] = true;
+					vertices.push_back(index);
+				}
+			}
+		}
+
+		deltas[_g] = CollectDeltas(mesh, instance, meshTargets[instance.MeshIndex], vertices, _conf);
+		for (const SMorphDelta& delta : deltas[_g])
+		{
+			scales[_g] = std::max(scales[_g], std::max(
+				std::abs(delta.Position.x), std::max(std::abs(delta.Position.y), std::abs(delta.Position.z))));
+		}
+	});
+
+	_out.PositionScale = scales.empty() ? 0.0f : *std::max_element(scales.begin(), scales.end());
+
+	// Offsets are quantized first, since the ones that quantize to zero are
+	// dropped, and then concatenated with addresses made absolute
+	std::vector<std::vector<char>> encoded(groupCount);
+	std::vector<std::vector<uint32_t>> localAddresses(groupCount);
+	ParallelFor(groupCount, _conf.ThreadCount, [&](uint32_t _g)
+	{
+		const aiMesh& mesh = *_scene.mMeshes[_instances[groups[_g][0]].MeshIndex];
+		std::vector<uint32_t>& addresses = localAddresses[_g];
+		addresses.resize(mesh.mNumVertices, 0);
+		for (const SMorphDelta& delta : deltas[_g])
+		{
+			int16_t position[4] = {
+				QuantizePositionOffset(delta.Position.x, _out.PositionScale),
+				QuantizePositionOffset(delta.Position.y, _out.PositionScale),
+				QuantizePositionOffset(delta.Position.z, _out.PositionScale),
+				(int16_t)delta.Target,
+			};
+			int8_t normal[4] = {
+				QuantizeNormalOffset(delta.Normal.x),
+				QuantizeNormalOffset(delta.Normal.y),
+				QuantizeNormalOffset(delta.Normal.z),
+				0,
+			};
+			if (position[0] == 0 && position[1] == 0 && position[2] == 0
+				&& normal[0] == 0 && normal[1] == 0 && normal[2] == 0)
+			{
+				continue;
+			}
+
+			// Deltas of a vertex are contiguous, so the first one sets its
+			// offset and each one increases its count
+			uint32_t& address = addresses[delta.Vertex];
+			if (address == 0)
+			{
+				address = (uint32_t)(encoded[_g].size() / MORPH_DELTA_SIZE);
+			}
+			address += 1u << 24;
+
+			size_t offset = encoded[_g].size();
+			encoded[_g].resize(offset + MORPH_DELTA_SIZE);
+			std::memcpy(encoded[_g].data() + offset, position, sizeof(position));
+			std::memcpy(encoded[_g].data() + offset + sizeof(position), normal, sizeof(normal));
+		}
+		deltas[_g] = std::vector<SMorphDelta>();
+	});
+
+	std::vector<uint32_t> firstDeltas(groupCount, 0);
+	size_t deltaCount = 0;
+	for (uint32_t g = 0; g < groupCount; ++g)
+	{
+		firstDeltas[g] = (uint32_t)std::min(deltaCount, (size_t)MORPH_MAX_TOTAL_DELTAS);
+		deltaCount += encoded[g].size() / MORPH_DELTA_SIZE;
+	}
+
+	if (deltaCount > MORPH_MAX_TOTAL_DELTAS)
+	{
+		_log
+			<< "ERROR: Morph targets of the model have " << deltaCount << " deltas, but at most "
+			<< MORPH_MAX_TOTAL_DELTAS << " are supported!" << std::endl;
+		return false;
+	}
+
+	for (const std::vector<uint32_t>& addresses : localAddresses)
+	{
+		for (uint32_t address : addresses)
+		{
+			_out.MaxVertexDeltas = std::max(_out.MaxVertexDeltas, address >> 24);
+		}
+	}
+
+	if (_out.Targets.size() > MORPH_SHADER_MAX_TARGETS)
+	{
+		_log
+			<< "WARNING: Model has " << _out.Targets.size() << " morph targets, but ShBasic.vsh has weights for only "
+			<< MORPH_SHADER_MAX_TARGETS << " by default, increase its MORPH_MAX_TARGETS!" << std::endl;
+	}
+
+	if (_out.MaxVertexDeltas > MORPH_SHADER_MAX_VERTEX_DELTAS)
+	{
+		_log
+			<< "WARNING: Up to " << _out.MaxVertexDeltas << " morph targets move a single vertex, but ShBasic.vsh "
+			<< "blends only " << MORPH_SHADER_MAX_VERTEX_DELTAS << " by default, increase its MORPH_MAX_VERTEX_DELTAS!"
+			<< std::endl;
+	}
+
+	_out.Deltas.reserve(deltaCount * MORPH_DELTA_SIZE);
+	for (uint32_t g = 0; g < groupCount; ++g)
+	{
+		if (encoded[g].empty())
+		{
+			localAddresses[g] = std::vector<uint32_t>();
+		}
+		_out.Deltas.insert(_out.Deltas.end(), encoded[g].begin(), encoded[g].end());
+		encoded[g] = std::vector<char>();
+	}
+
+	ParallelFor(instanceCount, _conf.ThreadCount, [&](uint32_t _i)
+	{
+		uint32_t group = groupOf[_i];
+		if (group == UINT32_MAX || localAddresses[group].empty())
+		{
+			return;
+		}
+
+		std::vector<uint32_t>& addresses = _out.Addresses[_i];
+		addresses.resize(faceIndices[_i].size(), 0);
+		for (size_t k = 0; k < faceIndices[_i].size(); ++k)
+		{
+			uint32_t address = localAddresses[group][faceIndices[_i][k]];
+			addresses[k] = (address != 0) ? (address + firstDeltas[group]) : 0;
+		}
+	});
+
+	return true;
+}
@@ -0,0 +1,661 @@
+#include <optimize.hpp>
+#include <math.hpp>
+#include <parallel.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+// Size of the LRU cache simulated by OptimizeVertexCache
+#define FORSYTH_CACHE_SIZE 32
+
+double SVertexCacheStats::GetACMR() const
+{
+	return (TriangleCount > 0) ? ((double)TransformCount / (double)TriangleCount) : 0.0;
+}
+
+double SVertexCacheStats::GetATVR() const
+{
+	return (VertexCount > 0) ? ((double)TransformCount / (double)VertexCount) : 0.0;
+}
+
+void SVertexCacheStats::Add(const SVertexCacheStats& _other)
+{
+	TriangleCount += _other.TriangleCount;
+	VertexCount += _other.VertexCount;
+	TransformCount += _other.TransformCount;
+}
+
+static bool IsTriangleMesh(const aiMesh& _mesh)
+{
+	if (_mesh.mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+	{
+		return false;
+	}
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		if (_mesh.mFaces[f].mNumIndices != 3)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::vector<uint32_t> GetIndices(const aiMesh& _mesh)
+{
+	std::vector<uint32_t> indices(_mesh.mNumFaces * 3);
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		const aiFace& face = _mesh.mFaces[f];
+		indices[f * 3 + 0] = face.mIndices[0];
+		indices[f * 3 + 1] = face.mIndices[1];
+		indices[f * 3 + 2] = face.mIndices[2];
+	}
+	return indices;
+}
+
+static void SetIndices(aiMesh& _mesh, const std::vector<uint32_t>& _indices)
+{
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		aiFace& face = _mesh.mFaces[f];
+		face.mIndices[0] = _indices[f * 3 + 0];
+		face.mIndices[1] = _indices[f * 3 + 1];
+		face.mIndices[2] = _indices[f * 3 + 2];
+	}
+}
+
+static SVertexCacheStats AnalyzeIndices(const std::vector<uint32_t>& _indices, uint32_t _vertexCount, uint32_t _cacheSize)
+{
+	SVertexCacheStats stats;
+	stats.TriangleCount = _indices.size() / 3;
+
+	// A vertex is in the cache if it was inserted less than _cacheSize
+	// insertions ago
+	std::vector<uint32_t> insertedAt(_vertexCount, 0);
+	std::vector<bool> referenced(_vertexCount, false);
+	uint32_t time = _cacheSize + 1;
+
+	for (uint32_t index : _indices)
+	{
+		if (time - insertedAt[index] > _cacheSize)
+		{
+			insertedAt[index] = time++;
+			++stats.TransformCount;
+		}
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			++stats.VertexCount;
+		}
+	}
+
+	return stats;
+}
+
+SVertexCacheStats AnalyzeVertexCache(const aiMesh& _mesh, uint32_t _cacheSize)
+{
+	if (!IsTriangleMesh(_mesh))
+	{
+		return SVertexCacheStats();
+	}
+	return AnalyzeIndices(GetIndices(_mesh), _mesh.mNumVertices, _cacheSize);
+}
+
+static float GetForsythVertexScore(int32_t _cachePosition, uint32_t _valence)
+{
+	if (_valence == 0)
+	{
+		// No triangles left to use this vertex
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (_cachePosition >= 0)
+	{
+		if (_cachePosition < 3)
+		{
+			// Vertices of the last triangle, fixed score to not favor using
+			// them again right away
+			score = 0.75f;
+		}
+		else
+		{
+			float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (_cachePosition - 3) * scale, 1.5f);
+		}
+	}
+
+	// Boost vertices with few triangles left, to get rid of them
+	score += 2.0f / std::sqrt((float)_valence);
+	return score;
+}
+
+void OptimizeVertexCache(aiMesh& _mesh)
+{
+	if (!IsTriangleMesh(_mesh) || _mesh.mNumFaces == 0)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> indices = GetIndices(_mesh);
+	OptimizeVertexCache(indices, _mesh.mNumVertices);
+	SetIndices(_mesh, indices);
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& _indices, uint32_t _vertexCount)
+{
+	if (_indices.empty())
+	{
+		return;
+	}
+
+	uint32_t triangleCount = (uint32_t)(_indices.size() / 3);
+	uint32_t vertexCount = _vertexCount;
+
+	// Triangles adjacent to each vertex, removed as triangles are emitted
+	std::vector<uint32_t> valence(vertexCount, 0);
+	for (uint32_t index : _indices)
+	{
+		++valence[index];
+	}
+
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + valence[v];
+	}
+
+	std::vector<uint32_t> adjacency(_indices.size());
+	{
+		std::vector<uint32_t> filled(vertexCount, 0);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				uint32_t v = _indices[t * 3 + i];
+				adjacency[adjacencyOffset[v] + filled[v]++] = t;
+			}
+		}
+	}
+
+	std::vector<int32_t> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScore[v] = GetForsythVertexScore(-1, valence[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[_indices[t * 3]]
+			+ vertexScore[_indices[t * 3 + 1]]
+			+ vertexScore[_indices[t * 3 + 2]];
+	}
+
+	// Three extra slots for vertices pushed out of the cache by the emitted
+	// triangle, so that their scores are updated too
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> cacheNew;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	cacheNew.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	std::vector<uint32_t> result;
+	result.reserve(_indices.size());
+
+	uint32_t nextUnemitted = 0;
+	int64_t bestTriangle = -1;
+
+	for (uint32_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		if (bestTriangle < 0)
+		{
+			// Nothing in the cache, continue with the first triangle left
+			while (emitted[nextUnemitted])
+			{
+				++nextUnemitted;
+			}
+			bestTriangle = nextUnemitted;
+		}
+
+		uint32_t triangle = (uint32_t)bestTriangle;
+		emitted[triangle] = true;
+
+		cacheNew.clear();
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			uint32_t v = _indices[triangle * 3 + i];
+			result.push_back(v);
+			cacheNew.push_back(v);
+
+			// Remove the triangle from the vertex's adjacency
+			uint32_t* begin = adjacency.data() + adjacencyOffset[v];
+			uint32_t* end = begin + valence[v];
+			*std::find(begin, end, triangle) = *(end - 1);
+			--valence[v];
+		}
+
+		for (uint32_t v : cache)
+		{
+			if (v != cacheNew[0] && v != cacheNew[1] && v != cacheNew[2])
+			{
+				cacheNew.push_back(v);
+			}
+		}
+		std::swap(cache, cacheNew);
+
+		// Update scores of all vertices in the cache, including those that just
+		// fell out of it, and pick the best triangle that uses them
+		float bestScore = -1.0f;
+		bestTriangle = -1;
+		for (uint32_t i = 0; i < cache.size(); ++i)
+		{
+			uint32_t v = cache[i];
+			cachePosition[v] = (i < FORSYTH_CACHE_SIZE) ? (int32_t)i : -1;
+			float score = GetForsythVertexScore(cachePosition[v], valence[v]);
+			float scoreDelta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (uint32_t a = 0; a < valence[v]; ++a)
+			{
+				uint32_t t = adjacency[adjacencyOffset[v] + a];
+				triangleScore[t] += scoreDelta;
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (cache.size() > FORSYTH_CACHE_SIZE)
+		{
+			cache.resize(FORSYTH_CACHE_SIZE);
+		}
+	}
+
+	_indices = std::move(result);
+}
+
+void OptimizeOverdraw(aiMesh& _mesh, bool _invertWinding)
+{
+	if (!IsTriangleMesh(_mesh) || _mesh.mNumFaces == 0)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> indices = GetIndices(_mesh);
+	uint32_t triangleCount = _mesh.mNumFaces;
+
+	// Split triangles into clusters at hard boundaries, i.e. triangles whose
+	// vertices all miss the cache, so that reordering clusters does not affect
+	// vertex cache efficiency much
+	std::vector<uint32_t> clusterStart;
+	{
+		std::vector<uint32_t> insertedAt(_mesh.mNumVertices, 0);
+		uint32_t time = OPTIMIZE_STATS_CACHE_SIZE + 1;
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			uint32_t misses = 0;
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				uint32_t v = indices[t * 3 + i];
+				if (time - insertedAt[v] > OPTIMIZE_STATS_CACHE_SIZE)
+				{
+					insertedAt[v] = time++;
+					++misses;
+				}
+			}
+			if (misses == 3 || t == 0)
+			{
+				clusterStart.push_back(t);
+			}
+		}
+	}
+
+	uint32_t clusterCount = (uint32_t)clusterStart.size();
+	clusterStart.push_back(triangleCount);
+
+	// Area weighted centroid and normal of each cluster
+	std::vector<aiVector3D> clusterCentroid(clusterCount);
+	std::vector<aiVector3D> clusterNormal(clusterCount);
+	aiVector3D meshCentroid(0.0f, 0.0f, 0.0f);
+	float meshArea = 0.0f;
+
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		aiVector3D centroid(0.0f, 0.0f, 0.0f);
+		aiVector3D normal(0.0f, 0.0f, 0.0f);
+		float area = 0.0f;
+
+		for (uint32_t t = clusterStart[c]; t < clusterStart[c + 1]; ++t)
+		{
+			const aiVector3D& p0 = _mesh.mVertices[indices[t * 3]];
+			const aiVector3D& p1 = _mesh.mVertices[indices[t * 3 + 1]];
+			const aiVector3D& p2 = _mesh.mVertices[indices[t * 3 + 2]];
+			aiVector3D cross = Vec3Cross(p1 - p0, p2 - p0);
+			float triangleArea = cross.Length();
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+		clusterCentroid[c] = (area > 0.0f) ? (centroid / area) : _mesh.mVertices[indices[clusterStart[c] * 3]];
+		clusterNormal[c] = normal;
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	// Clusters facing away from the center go first. Normals of reversed
+	// faces point inward.
+	float sign = _invertWinding ? 1.0f : -1.0f;
+	std::vector<float> sortKey(clusterCount);
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		float length = clusterNormal[c].Length();
+		sortKey[c] = (length > 0.0f)
+			? sign * Vec3Dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / length)
+			: 0.0f;
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b)
+	{
+		return sortKey[_a] > sortKey[_b];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t c : order)
+	{
+		result.insert(result.end(),
+			indices.begin() + clusterStart[c] * 3,
+			indices.begin() + clusterStart[c + 1] * 3);
+	}
+
+	SetIndices(_mesh, result);
+}
+
+template<typename T>
+static void PermuteArray(T* _array, const std::vector<uint32_t>& _remap)
+{
+	if (!_array)
+	{
+		return;
+	}
+	std::vector<T> copy(_array, _array + _remap.size());
+	for (size_t i = 0; i < _remap.size(); ++i)
+	{
+		_array[_remap[i]] = copy[i];
+	}
+}
+
+void OptimizeVertexFetch(aiMesh& _mesh)
+{
+	uint32_t vertexCount = _mesh.mNumVertices;
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		const aiFace& face = _mesh.mFaces[f];
+		for (uint32_t i = 0; i < face.mNumIndices; ++i)
+		{
+			uint32_t& target = remap[face.mIndices[i]];
+			if (target == UINT32_MAX)
+			{
+				target = next++;
+			}
+		}
+	}
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] == UINT32_MAX)
+		{
+			remap[v] = next++;
+		}
+	}
+
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		aiFace& face = _mesh.mFaces[f];
+		for (uint32_t i = 0; i < face.mNumIndices; ++i)
+		{
+			face.mIndices[i] = remap[face.mIndices[i]];
+		}
+	}
+
+	PermuteArray(_mesh.mVertices, remap);
+	PermuteArray(_mesh.mNormals, remap);
+	PermuteArray(_mesh.mTangents, remap);
+	PermuteArray(_mesh.mBitangents, remap);
+	for (uint32_t c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c)
+	{
+		PermuteArray(_mesh.mColors[c], remap);
+	}
+	for (uint32_t t = 0; t < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++t)
+	{
+		PermuteArray(_mesh.mTextureCoords[t], remap);
+	}
+
+	for (uint32_t a = 0; a < _mesh.mNumAnimMeshes; ++a)
+	{
+		aiAnimMesh& animMesh = *_mesh.mAnimMeshes[a];
+		if (animMesh.mNumVertices != vertexCount)
+		{
+			continue;
+		}
+		PermuteArray(animMesh.mVertices, remap);
+		PermuteArray(animMesh.mNormals, remap);
+		PermuteArray(animMesh.mTangents, remap);
+		PermuteArray(animMesh.mBitangents, remap);
+		for (uint32_t c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c)
+		{
+			PermuteArray(animMesh.mColors[c], remap);
+		}
+		for (uint32_t t = 0; t < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++t)
+		{
+			PermuteArray(animMesh.mTextureCoords[t], remap);
+		}
+	}
+
+	for (uint32_t b = 0; b < _mesh.mNumBones; ++b)
+	{
+		aiBone& bone = *_mesh.mBones[b];
+		for (uint32_t w = 0; w < bone.mNumWeights; ++w)
+		{
+			bone.mWeights[w].mVertexId = remap[bone.mWeights[w].mVertexId];
+		}
+	}
+}
+
+std::vector<uint32_t> StripifyTriangles(const std::vector<uint32_t>& _indices, uint32_t _vertexCount)
+{
+	uint32_t triangleCount = (uint32_t)(_indices.size() / 3);
+	std::vector<uint32_t> result;
+	if (triangleCount == 0)
+	{
+		return result;
+	}
+
+	// Triangles adjacent to each vertex
+	std::vector<uint32_t> offsets(_vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		++offsets[_indices[i] + 1];
+	}
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+		{
+			adjacency[cursors[_indices[i]]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	std::vector<bool> used(triangleCount, false);
+	// Triangles visited by the current walk, which may not have been used yet
+	std::vector<uint32_t> visited(triangleCount, 0);
+	uint32_t walk = 0;
+
+	// Returns an unvisited triangle with edge _from -> _to in its winding order
+	// and writes its third vertex into _thirdOut, or UINT32_MAX if there is none
+	auto findTriangle = [&](uint32_t _from, uint32_t _to, uint32_t& _thirdOut)
+	{
+		for (uint32_t a = offsets[_from]; a < offsets[_from + 1]; ++a)
+		{
+			uint32_t t = adjacency[a];
+			if (used[t] || visited[t] == walk)
+			{
+				continue;
+			}
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				if (_indices[t * 3 + k] == _from && _indices[t * 3 + (k + 1) % 3] == _to)
+				{
+					_thirdOut = _indices[t * 3 + (k + 2) % 3];
+					return t;
+				}
+			}
+		}
+		return UINT32_MAX;
+	};
+
+	// Walks a strip starting with triangle _start rotated by _rotation and
+	// returns the number of its triangles. If _strip is not nullptr, its
+	// vertices are appended to it and its triangles are marked as used.
+	auto walkStrip = [&](uint32_t _start, uint32_t _rotation, std::vector<uint32_t>* _strip)
+	{
+		++walk;
+		uint32_t v0 = _indices[_start * 3 + _rotation];
+		uint32_t v1 = _indices[_start * 3 + (_rotation + 1) % 3];
+		uint32_t v2 = _indices[_start * 3 + (_rotation + 2) % 3];
+		visited[_start] = walk;
+		if (_strip)
+		{
+			_strip->insert(_strip->end(), { v0, v1, v2 });
+			used[_start] = true;
+		}
+
+		uint32_t count = 1;
+		while (true)
+		{
+			// Triangles at odd positions of a strip have inverted winding order
+			uint32_t third = 0;
+			uint32_t t = (count % 2 == 0) ? findTriangle(v1, v2, third) : findTriangle(v2, v1, third);
+			if (t == UINT32_MAX)
+			{
+				break;
+			}
+
+			visited[t] = walk;
+			if (_strip)
+			{
+				_strip->push_back(third);
+				used[t] = true;
+			}
+			v1 = v2;
+			v2 = third;
+			++count;
+		}
+		return count;
+	};
+
+	std::vector<uint32_t> strip;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		if (used[t])
+		{
+			continue;
+		}
+
+		uint32_t bestRotation = 0;
+		uint32_t bestCount = 0;
+		for (uint32_t rotation = 0; rotation < 3; ++rotation)
+		{
+			uint32_t count = walkStrip(t, rotation, nullptr);
+			if (count > bestCount)
+			{
+				bestCount = count;
+				bestRotation = rotation;
+			}
+		}
+
+		strip.clear();
+		walkStrip(t, bestRotation, &strip);
+
+		// Degenerate triangles connect the strip to the previous one, or to
+		// whatever comes before the result. Strips must start at even
+		// positions to keep their winding order.
+		if (!result.empty())
+		{
+			result.push_back(result.back());
+		}
+		result.push_back(strip[0]);
+		if (result.size() % 2 != 0)
+		{
+			result.push_back(strip[0]);
+		}
+		result.insert(result.end(), strip.begin(), strip.end());
+	}
+
+	// Degenerate triangles to whatever comes after the result
+	result.push_back(result.back());
+	if (result.size() % 2 != 0)
+	{
+		result.push_back(result.back());
+	}
+
+	return result;
+}
+
+void OptimizeScene(aiScene& _scene, const SConfig& _conf, std::ostream& _log)
+{
+	std::vector<SVertexCacheStats> statsBefore(_scene.mNumMeshes);
+	std::vector<SVertexCacheStats> statsAfter(_scene.mNumMeshes);
+
+	ParallelFor(_scene.mNumMeshes, _conf.ThreadCount, [&](uint32_t _i)
+	{
+		aiMesh& mesh = *_scene.mMeshes[_i];
+		if (!IsTriangleMesh(mesh))
+		{
+			return;
+		}
+
+		statsBefore[_i] = AnalyzeVertexCache(mesh, OPTIMIZE_STATS_CACHE_SIZE);
+
+		OptimizeVertexCache(mesh);
+		if (_conf.Optimization == EOptimization::Overdraw)
+		{
+			OptimizeOverdraw(mesh, _conf.InvertWinding);
+		}
+		OptimizeVertexFetch(mesh);
+
+		statsAfter[_i] = AnalyzeVertexCache(mesh, OPTIMIZE_STATS_CACHE_SIZE);
+	});
+
+	SVertexCacheStats before;
+	SVertexCacheStats after;
+	for (uint32_t i = 0; i < _scene.mNumMeshes; ++i)
+	{
+		before.Add(statsBefore[i]);
+		after.Add(statsAfter[i]);
+	}
+
+	_log
+		<< "Vertex cache (FIFO " << OPTIMIZE_STATS_CACHE_SIZE << "): "
+		<< "ACMR " << before.GetACMR() << " -> " << after.GetACMR() << ", "
+		<< "ATVR " << before.GetATVR() << " -> " << after.GetATVR() << std::endl;
+}
@@ -0,0 +1,170 @@
+#include <profiler.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+SProfiler::SScope::SScope(SProfiler* _profiler, const std::string& _name)
+	: Profiler(_profiler)
+	, Index(0)
+{
+	if (Profiler)
+	{
+		// The event is added right away, so that it is listed before events
+		// nested in it
+		Index = Profiler->Events.size();
+		Profiler->AddEvent(_name, Clock::now(), Clock::duration::zero(), Profiler->Depth++);
+	}
+}
+
+SProfiler::SScope::~SScope()
+{
+	End();
+}
+
+SProfiler::Clock::duration SProfiler::SScope::End()
+{
+	if (!Profiler)
+	{
+		return Clock::duration::zero();
+	}
+	SEvent& event = Profiler->Events[Index];
+	event.Duration = Clock::now() - event.Start;
+	--Profiler->Depth;
+	Profiler = nullptr;
+	return event.Duration;
+}
+
+void SProfiler::AddEvent(const std::string& _name, Clock::time_point _start, Clock::duration _duration, uint32_t _depth)
+{
+	SEvent event;
+	event.Name = _name;
+	event.Start = _start;
+	event.Duration = _duration;
+	event.Depth = _depth;
+	Events.push_back(event);
+}
+
+void SProfiler::Merge(const SProfiler& _other, const std::string& _name, uint32_t _thread)
+{
+	if (_other.Events.empty())
+	{
+		return;
+	}
+
+	Clock::time_point start = _other.Events.front().Start;
+	Clock::time_point end = start;
+	for (const SEvent& event : _other.Events)
+	{
+		start = std::min(start, event.Start);
+		end = std::max(end, event.Start + event.Duration);
+	}
+
+	AddEvent(_name, start, end - start, 0);
+	Events.back().Thread = _thread;
+
+	for (const SEvent& event : _other.Events)
+	{
+		Events.push_back(event);
+		Events.back().Depth += 1;
+		Events.back().Thread = _thread;
+	}
+}
+
+static double ToMilliseconds(SProfiler::Clock::duration _duration)
+{
+	return std::chrono::duration<double, std::milli>(_duration).count();
+}
+
+void SProfiler::PrintBreakdown(std::ostream& _log) const
+{
+	Clock::duration total = Clock::duration::zero();
+	for (const SEvent& event : Events)
+	{
+		if (event.Depth == 0)
+		{
+			total += event.Duration;
+		}
+	}
+
+	std::ios_base::fmtflags flags = _log.flags();
+	std::streamsize precision = _log.precision();
+
+	_log << "Profile:" << std::endl << std::fixed << std::setprecision(2);
+	for (const SEvent& event : Events)
+	{
+		std::string name = std::string(2 + event.Depth * 2, ' ') + event.Name;
+		_log << std::left << std::setw(40) << name << std::right
+			<< std::setw(10) << ToMilliseconds(event.Duration) << " ms";
+		if (total > Clock::duration::zero())
+		{
+			_log << std::setw(8) << (100.0 * ToMilliseconds(event.Duration) / ToMilliseconds(total)) << " %";
+		}
+		_log << std::endl;
+	}
+	_log << std::left << std::setw(40) << "  Total" << std::right
+		<< std::setw(10) << ToMilliseconds(total) << " ms" << std::endl;
+
+	_log.flags(flags);
+	_log.precision(precision);
+}
+
+static void WriteJsonString(std::ostream& _stream, const std::string& _value)
+{
+	_stream << '"';
+	for (char c : _value)
+	{
+		switch (c)
+		{
+		case '"':
+			_stream << "\\\"";
+			break;
+
+		case '\\':
+			_stream << "\\\\";
+			break;
+
+		default:
+			if ((unsigned char)c < 0x20)
+			{
+				_stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c
+					<< std::dec << std::setfill(' ');
+			}
+			else
+			{
+				_stream << c;
+			}
+			break;
+		}
+	}
+	_stream << '"';
+}
+
+bool SProfiler::WriteChromeTrace(const std::string& _path) const
+{
+	std::ofstream file(_path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file << "{\"traceEvents\":[" << std::endl << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < Events.size(); ++i)
+	{
+		const SEvent& event = Events[i];
+		double start = std::chrono::duration<double, std::micro>(event.Start - Epoch).count();
+		double duration = std::chrono::duration<double, std::micro>(event.Duration).count();
+
+		file << "{\"name\":";
+		WriteJsonString(file, event.Name);
+		file
+			<< ",\"cat\":\"yamc\",\"ph\":\"X\""
+			<< ",\"ts\":" << start
+			<< ",\"dur\":" << duration
+			<< ",\"pid\":1,\"tid\":" << event.Thread << "}"
+			<< ((i + 1 < Events.size()) ? "," : "") << std::endl;
+	}
+	file << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+
+	return file.good();
+}
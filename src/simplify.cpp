@@ -0,0 +1,697 @@
+#include <simplify.hpp>
+#include <hash.hpp>
+#include <math.hpp>
+#include <optimize.hpp>
+#include <parallel.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+/// Kinds of vertices, which determine edges they can be collapsed along.
+enum class EVertexKind : uint8_t
+{
+	/// All edges of the vertex are shared by two triangles and its attributes
+	/// are continuous. Can be collapsed into any neighbor.
+	Manifold,
+	/// The vertex is split into two vertices with different attributes along
+	/// an attribute seam. Can be collapsed only along the seam.
+	Seam,
+	/// The vertex is on a border of the mesh, on a non-manifold edge or where
+	/// multiple seams meet. Is never collapsed.
+	Locked,
+};
+
+/// Quadric error function, a symmetric 4x4 matrix with the sum of squared
+/// distances to planes of triangles, weighted by their area.
+struct SQuadric
+{
+	void Add(const SQuadric& _other)
+	{
+		A00 += _other.A00;
+		A11 += _other.A11;
+		A22 += _other.A22;
+		A01 += _other.A01;
+		A02 += _other.A02;
+		A12 += _other.A12;
+		B0 += _other.B0;
+		B1 += _other.B1;
+		B2 += _other.B2;
+		C += _other.C;
+		W += _other.W;
+	}
+
+	/// Returns the weighted average of squared distances of a point to the
+	/// planes.
+	double GetError(const aiVector3D& _point) const
+	{
+		if (W <= 0.0)
+		{
+			return 0.0;
+		}
+		double x = _point.x;
+		double y = _point.y;
+		double z = _point.z;
+		double error = A00 * x * x + A11 * y * y + A22 * z * z
+			+ 2.0 * (A01 * x * y + A02 * x * z + A12 * y * z)
+			+ 2.0 * (B0 * x + B1 * y + B2 * z)
+			+ C;
+		return std::fabs(error) / W;
+	}
+
+	double A00 = 0.0;
+	double A11 = 0.0;
+	double A22 = 0.0;
+	double A01 = 0.0;
+	double A02 = 0.0;
+	double A12 = 0.0;
+	double B0 = 0.0;
+	double B1 = 0.0;
+	double B2 = 0.0;
+	double C = 0.0;
+	/// Sum of weights.
+	double W = 0.0;
+};
+
+/// Returns the quadric of the plane of a triangle, weighted by its area.
+/// Degenerate triangles have zero weight.
+static SQuadric GetTriangleQuadric(const aiVector3D& _p0, const aiVector3D& _p1, const aiVector3D& _p2)
+{
+	SQuadric quadric;
+	aiVector3D normal = Vec3Cross(_p1 - _p0, _p2 - _p0);
+	float length = normal.Length();
+	if (length == 0.0f)
+	{
+		return quadric;
+	}
+	normal /= length;
+
+	double a = normal.x;
+	double b = normal.y;
+	double c = normal.z;
+	double d = -Vec3Dot(normal, _p0);
+	double w = length * 0.5;
+
+	quadric.A00 = w * a * a;
+	quadric.A11 = w * b * b;
+	quadric.A22 = w * c * c;
+	quadric.A01 = w * a * b;
+	quadric.A02 = w * a * c;
+	quadric.A12 = w * b * c;
+	quadric.B0 = w * a * d;
+	quadric.B1 = w * b * d;
+	quadric.B2 = w * c * d;
+	quadric.C = w * d * d;
+	quadric.W = w;
+	return quadric;
+}
+
+/// Open addressing hash set of directed edges between vertices.
+struct SEdgeSet
+{
+	explicit SEdgeSet(size_t _edgeCount)
+	{
+		size_t size = 2;
+		while (size < _edgeCount * 2)
+		{
+			size <<= 1;
+		}
+		Keys.assign(size, UINT64_MAX);
+	}
+
+	void Insert(uint32_t _from, uint32_t _to)
+	{
+		uint64_t key = GetKey(_from, _to);
+		Keys[FindSlot(key)] = key;
+	}
+
+	bool Contains(uint32_t _from, uint32_t _to) const
+	{
+		uint64_t key = GetKey(_from, _to);
+		return (Keys[FindSlot(key)] == key);
+	}
+
+	static uint64_t GetKey(uint32_t _from, uint32_t _to)
+	{
+		return ((uint64_t)_from << 32) | _to;
+	}
+
+	size_t FindSlot(uint64_t _key) const
+	{
+		size_t mask = Keys.size() - 1;
+		size_t slot = HashBytes(&_key, sizeof(_key)) & mask;
+		while (Keys[slot] != UINT64_MAX && Keys[slot] != _key)
+		{
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	std::vector<uint64_t> Keys;
+};
+
+/// An edge collapse, which moves vertex From into the position of vertex To.
+struct SCollapse
+{
+	uint32_t From = 0;
+	uint32_t To = 0;
+	/// Geometric error plus the difference of normals, used to order collapses.
+	double Cost = DBL_MAX;
+	/// Squared geometric error.
+	double Error = 0.0;
+};
+
+static bool HasSameAttributes(const aiMesh& _mesh, uint32_t _a, uint32_t _b)
+{
+	if (_mesh.mNormals && _mesh.mNormals[_a] != _mesh.mNormals[_b])
+	{
+		return false;
+	}
+
+	if (_mesh.mTangents && _mesh.mTangents[_a] != _mesh.mTangents[_b])
+	{
+		return false;
+	}
+
+	if (_mesh.mBitangents && _mesh.mBitangents[_a] != _mesh.mBitangents[_b])
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++i)
+	{
+		if (_mesh.mTextureCoords[i] && _mesh.mTextureCoords[i][_a] != _mesh.mTextureCoords[i][_b])
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; ++i)
+	{
+		if (_mesh.mColors[i] && _mesh.mColors[i][_a] != _mesh.mColors[i][_b])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Maps each vertex referenced by _indices to the first one with the same
+/// position (_remapOut) and to the first one with the same position and
+/// attributes (_weldOut). Welded vertices that share a position, i.e. the
+/// wedges of the position, are linked into circular lists (_wedgeOut).
+/// Unreferenced vertices are mapped to UINT32_MAX.
+static void WeldVertices(
+	const aiMesh& _mesh,
+	const std::vector<uint32_t>& _indices,
+	std::vector<uint32_t>& _remapOut,
+	std::vector<uint32_t>& _weldOut,
+	std::vector<uint32_t>& _wedgeOut)
+{
+	uint32_t vertexCount = _mesh.mNumVertices;
+	_remapOut.assign(vertexCount, UINT32_MAX);
+	_weldOut.assign(vertexCount, UINT32_MAX);
+	_wedgeOut.assign(vertexCount, UINT32_MAX);
+
+	// Open addressing hash table of the first vertex with each position
+	size_t tableSize = 1;
+	while (tableSize < (size_t)vertexCount * 2)
+	{
+		tableSize <<= 1;
+	}
+	std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+	for (uint32_t index : _indices)
+	{
+		if (_weldOut[index] != UINT32_MAX)
+		{
+			continue;
+		}
+
+		const aiVector3D& position = _mesh.mVertices[index];
+		size_t slot = HashBytes(&position, sizeof(position)) & (tableSize - 1);
+		while (table[slot] != UINT32_MAX && _mesh.mVertices[table[slot]] != position)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == UINT32_MAX)
+		{
+			table[slot] = index;
+			_remapOut[index] = index;
+			_weldOut[index] = index;
+			_wedgeOut[index] = index;
+			continue;
+		}
+
+		uint32_t first = table[slot];
+		_remapOut[index] = first;
+
+		uint32_t wedge = first;
+		do
+		{
+			if (HasSameAttributes(_mesh, wedge, index))
+			{
+				_weldOut[index] = wedge;
+				break;
+			}
+			wedge = _wedgeOut[wedge];
+		}
+		while (wedge != first);
+
+		if (_weldOut[index] == UINT32_MAX)
+		{
+			_weldOut[index] = index;
+			_wedgeOut[index] = _wedgeOut[first];
+			_wedgeOut[first] = index;
+		}
+	}
+}
+
+/// Classifies vertices referenced by triangles _indices by their open edges,
+/// i.e. edges without a triangle on the other side.
+static void ClassifyVertices(
+	const std::vector<uint32_t>& _indices,
+	const std::vector<uint32_t>& _remap,
+	const std::vector<uint32_t>& _wedge,
+	const SEdgeSet& _edges,
+	std::vector<EVertexKind>& _kindsOut)
+{
+	uint32_t vertexCount = (uint32_t)_remap.size();
+
+	// The only open edge going into and out of each vertex, UINT32_MAX if
+	// there is none and the vertex itself if there are more
+	std::vector<uint32_t> openIn(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> openOut(vertexCount, UINT32_MAX);
+
+	for (size_t i = 0; i < _indices.size(); i += 3)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t a = _indices[i + k];
+			uint32_t b = _indices[i + (k + 1) % 3];
+			if (!_edges.Contains(b, a))
+			{
+				openOut[a] = (openOut[a] == UINT32_MAX) ? b : a;
+				openIn[b] = (openIn[b] == UINT32_MAX) ? a : b;
+			}
+		}
+	}
+
+	_kindsOut.assign(vertexCount, EVertexKind::Locked);
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if (_remap[v] != v)
+		{
+			continue;
+		}
+
+		EVertexKind kind = EVertexKind::Locked;
+		uint32_t w = _wedge[v];
+
+		if (w == v)
+		{
+			if (openIn[v] == UINT32_MAX && openOut[v] == UINT32_MAX)
+			{
+				kind = EVertexKind::Manifold;
+			}
+		}
+		else if (_wedge[w] == v)
+		{
+			// Both wedges must have exactly one open edge going in and out and
+			// these must connect the same positions on both sides of the seam
+			uint32_t inV = openIn[v];
+			uint32_t outV = openOut[v];
+			uint32_t inW = openIn[w];
+			uint32_t outW = openOut[w];
+			if (inV != UINT32_MAX && inV != v && outV != UINT32_MAX && outV != v
+				&& inW != UINT32_MAX && inW != w && outW != UINT32_MAX && outW != w
+				&& _remap[inV] == _remap[outW]
+				&& _remap[outV] == _remap[inW]
+				&& _remap[inV] != _remap[outV])
+			{
+				kind = EVertexKind::Seam;
+			}
+		}
+
+		uint32_t wedge = v;
+		do
+		{
+			_kindsOut[wedge] = kind;
+			wedge = _wedge[wedge];
+		}
+		while (wedge != v);
+	}
+}
+
+static bool CanCollapse(
+	uint32_t _from, uint32_t _to, const std::vector<EVertexKind>& _kinds, const SEdgeSet& _edges)
+{
+	switch (_kinds[_from])
+	{
+	case EVertexKind::Manifold:
+		return true;
+
+	case EVertexKind::Seam:
+		// Only along the seam, whose edges have no opposite edge
+		return (_kinds[_to] == EVertexKind::Seam
+			&& !(_edges.Contains(_from, _to) && _edges.Contains(_to, _from)));
+
+	default:
+		return false;
+	}
+}
+
+/// Returns true if collapsing vertex _from into _to flips any of the triangles
+/// around _from that are not removed by the collapse.
+static bool HasTriangleFlips(
+	const aiVector3D* _positions,
+	const std::vector<uint32_t>& _indices,
+	const std::vector<uint32_t>& _remap,
+	const std::vector<uint32_t>& _adjacencyOffsets,
+	const std::vector<uint32_t>& _adjacency,
+	uint32_t _from,
+	uint32_t _to)
+{
+	uint32_t from = _remap[_from];
+	uint32_t to = _remap[_to];
+
+	for (uint32_t a = _adjacencyOffsets[from]; a < _adjacencyOffsets[from + 1]; ++a)
+	{
+		const uint32_t* triangle = &_indices[(size_t)_adjacency[a] * 3];
+		if (_remap[triangle[0]] == to || _remap[triangle[1]] == to || _remap[triangle[2]] == to)
+		{
+			continue;
+		}
+
+		aiVector3D before[3];
+		aiVector3D after[3];
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			before[k] = _positions[triangle[k]];
+			after[k] = (_remap[triangle[k]] == from) ? _positions[_to] : before[k];
+		}
+
+		aiVector3D normalBefore = Vec3Cross(before[1] - before[0], before[2] - before[0]);
+		aiVector3D normalAfter = Vec3Cross(after[1] - after[0], after[2] - after[0]);
+		// Rejects turns by more than about 75 degrees, since many turns by
+		// just under 90 degrees would still flip triangles over multiple
+		// collapses
+		float dot = Vec3Dot(normalBefore, normalAfter);
+		if (dot <= 0.25f * normalBefore.Length() * normalAfter.Length())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::vector<uint32_t> SimplifyMesh(
+	const aiMesh& _mesh,
+	const std::vector<uint32_t>& _indices,
+	size_t _targetIndexCount,
+	float _targetError,
+	float& _errorOut)
+{
+	_errorOut = 0.0f;
+
+	uint32_t vertexCount = _mesh.mNumVertices;
+	const aiVector3D* positions = _mesh.mVertices;
+	const aiVector3D* normals = _mesh.mNormals;
+
+	std::vector<uint32_t> remap;
+	std::vector<uint32_t> weld;
+	std::vector<uint32_t> wedge;
+	WeldVertices(_mesh, _indices, remap, weld, wedge);
+
+	std::vector<uint32_t> indices(_indices.size());
+	aiAABB bounds = AABBEmpty();
+	for (size_t i = 0; i < _indices.size(); ++i)
+	{
+		indices[i] = weld[_indices[i]];
+		AABBAddPoint(bounds, positions[indices[i]]);
+	}
+
+	float size = 0.0f;
+	if (!AABBIsEmpty(bounds))
+	{
+		aiVector3D extent = bounds.mMax - bounds.mMin;
+		size = std::max(extent.x, std::max(extent.y, extent.z));
+	}
+	double normalWeight = (double)(SIMPLIFY_NORMAL_WEIGHT * size) * (SIMPLIFY_NORMAL_WEIGHT * size);
+
+	// Quadrics are accumulated per position, so wedges share them
+	std::vector<SQuadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		SQuadric quadric = GetTriangleQuadric(
+			positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			quadrics[remap[indices[i + k]]].Add(quadric);
+		}
+	}
+
+	double errorLimit = (double)_targetError * (double)_targetError;
+	double maxError = 0.0;
+
+	std::vector<EVertexKind> kinds;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<SCollapse> collapses;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<uint8_t> locked(vertexCount);
+
+	// Each pass collapses the cheapest edges that do not share triangles, so
+	// that their costs stay valid, and then removes degenerate triangles
+	while (indices.size() > _targetIndexCount)
+	{
+		SEdgeSet edges(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			edges.Insert(indices[i], indices[i + 1]);
+			edges.Insert(indices[i + 1], indices[i + 2]);
+			edges.Insert(indices[i + 2], indices[i]);
+		}
+
+		ClassifyVertices(indices, remap, wedge, edges, kinds);
+
+		// Triangles around each position
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : indices)
+		{
+			++adjacencyOffsets[remap[index] + 1];
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(indices.size());
+		{
+			std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i)
+			{
+				adjacency[cursors[remap[indices[i]]]++] = (uint32_t)(i / 3);
+			}
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				uint32_t a = indices[i + k];
+				uint32_t b = indices[i + (k + 1) % 3];
+
+				// Edges shared by two triangles are visited only once
+				if (edges.Contains(b, a) && remap[a] > remap[b])
+				{
+					continue;
+				}
+
+				SCollapse collapse;
+				for (uint32_t d = 0; d < 2; ++d)
+				{
+					uint32_t from = (d == 0) ? a : b;
+					uint32_t to = (d == 0) ? b : a;
+					if (!CanCollapse(from, to, kinds, edges))
+					{
+						continue;
+					}
+
+					double error = quadrics[remap[from]].GetError(positions[to]);
+					double cost = error;
+					if (normals)
+					{
+						float distance = (normals[from] - normals[to]).SquareLength();
+						if (kinds[from] == EVertexKind::Seam)
+						{
+							distance = std::max(distance, (normals[wedge[from]] - normals[wedge[to]]).SquareLength());
+						}
+						cost += normalWeight * distance;
+					}
+
+					if (cost < collapse.Cost)
+					{
+						collapse.From = from;
+						collapse.To = to;
+						collapse.Cost = cost;
+						collapse.Error = error;
+					}
+				}
+
+				if (collapse.Cost < DBL_MAX)
+				{
+					collapses.push_back(collapse);
+				}
+			}
+		}
+
+		if (collapses.empty())
+		{
+			break;
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const SCollapse& _a, const SCollapse& _b)
+		{
+			return _a.Cost < _b.Cost;
+		});
+
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+		std::fill(locked.begin(), locked.end(), 0);
+
+		size_t triangleGoal = (indices.size() - _targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		size_t collapseCount = 0;
+
+		for (const SCollapse& collapse : collapses)
+		{
+			if (trianglesRemoved >= triangleGoal)
+			{
+				break;
+			}
+
+			uint32_t from = remap[collapse.From];
+			uint32_t to = remap[collapse.To];
+			if (collapse.Error > errorLimit
+				|| locked[from]
+				|| locked[to]
+				|| HasTriangleFlips(positions, indices, remap, adjacencyOffsets, adjacency, collapse.From, collapse.To))
+			{
+				continue;
+			}
+
+			collapseRemap[collapse.From] = collapse.To;
+			if (kinds[collapse.From] == EVertexKind::Seam)
+			{
+				// Wedges on the other side of the seam
+				collapseRemap[wedge[collapse.From]] = wedge[collapse.To];
+			}
+			quadrics[to].Add(quadrics[from]);
+
+			for (uint32_t t = adjacencyOffsets[from]; t < adjacencyOffsets[from + 1]; ++t)
+			{
+				const uint32_t* triangle = &indices[(size_t)adjacency[t] * 3];
+				locked[remap[triangle[0]]] = 1;
+				locked[remap[triangle[1]]] = 1;
+				locked[remap[triangle[2]]] = 1;
+			}
+
+			maxError = std::max(maxError, collapse.Error);
+			// Both an edge in the interior and one along a seam are shared by
+			// two triangles
+			trianglesRemoved += 2;
+			++collapseCount;
+		}
+
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		size_t count = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32_t a = collapseRemap[indices[i]];
+			uint32_t b = collapseRemap[indices[i + 1]];
+			uint32_t c = collapseRemap[indices[i + 2]];
+			if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a])
+			{
+				indices[count++] = a;
+				indices[count++] = b;
+				indices[count++] = c;
+			}
+		}
+		indices.resize(count);
+	}
+
+	_errorOut = (float)std::sqrt(maxError);
+	return indices;
+}
+
+std::vector<SMeshLods> GenerateLods(const aiScene& _scene, const SConfig& _conf)
+{
+	uint32_t lodCount = _conf.GetLodCount();
+	std::vector<SMeshLods> lods(_scene.mNumMeshes);
+
+	ParallelFor(_scene.mNumMeshes, _conf.ThreadCount, [&](uint32_t _i)
+	{
+		const aiMesh& mesh = *_scene.mMeshes[_i];
+		SMeshLods& meshLods = lods[_i];
+
+		if (mesh.mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+		{
+			meshLods.Errors.assign(lodCount, 0.0f);
+			return;
+		}
+
+		std::vector<uint32_t> indices;
+		indices.reserve((size_t)mesh.mNumFaces * 3);
+		aiAABB bounds = AABBEmpty();
+		for (uint32_t f = 0; f < mesh.mNumFaces; ++f)
+		{
+			const aiFace& face = mesh.mFaces[f];
+			if (face.mNumIndices == 3)
+			{
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					indices.push_back(face.mIndices[k]);
+					AABBAddPoint(bounds, mesh.mVertices[face.mIndices[k]]);
+				}
+			}
+		}
+
+		float size = 0.0f;
+		if (!AABBIsEmpty(bounds))
+		{
+			aiVector3D extent = bounds.mMax - bounds.mMin;
+			size = std::max(extent.x, std::max(extent.y, extent.z));
+		}
+
+		size_t triangleCount = indices.size() / 3;
+		float error = 0.0f;
+
+		for (uint32_t l = 0; l < lodCount; ++l)
+		{
+			float ratio = (l < _conf.LodRatios.size()) ? _conf.LodRatios[l] : 0.0f;
+			size_t targetIndexCount = (size_t)(triangleCount * ratio) * 3;
+			float targetError = (_conf.LodError > 0.0f)
+				? std::max(_conf.LodError * size - error, 0.0f)
+				: FLT_MAX;
+
+			float levelError = 0.0f;
+			indices = SimplifyMesh(mesh, indices, targetIndexCount, targetError, levelError);
+			if (_conf.Optimization != EOptimization::None)
+			{
+				OptimizeVertexCache(indices, mesh.mNumVertices);
+			}
+
+			error += levelError;
+			meshLods.Triangles.push_back(indices);
+			meshLods.Errors.push_back(error);
+		}
+	});
+
+	return lods;
+}
@@ -0,0 +1,710 @@
+#include <hash.hpp>
+#include <math.hpp>
+#include <parallel.hpp>
+#include <tangentspace.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/// Number of faces, vertices or vertex groups processed by a single task.
+#define TANGENT_SPACE_BLOCK_SIZE 4096
+
+/// Meshes with fewer vertices are processed on a single thread each, in
+/// parallel with other small meshes. Larger meshes are processed one at a time
+/// on all threads.
+#define TANGENT_SPACE_LARGE_MESH 65536
+
+static bool IsTriangleMesh(const aiMesh& _mesh)
+{
+	if (_mesh.mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+	{
+		return false;
+	}
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		if (_mesh.mFaces[f].mNumIndices != 3)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Calls _fn(begin, end) for consecutive ranges of [0, _count) with up to
+/// _blockSize items on up to _threadCount threads.
+template<typename FN>
+static void ParallelForBlocks(uint32_t _count, uint32_t _blockSize, uint32_t _threadCount, FN&& _fn)
+{
+	uint32_t blockCount = (_count + _blockSize - 1) / _blockSize;
+	ParallelFor(blockCount, _threadCount, [&](uint32_t _block)
+	{
+		uint32_t begin = _block * _blockSize;
+		uint32_t end = std::min(_count, begin + _blockSize);
+		_fn(begin, end);
+	});
+}
+
+/// Vertices grouped by equal keys.
+struct SVertexGroups
+{
+	/// Vertex indices, vertices of each group are adjacent.
+	std::vector<uint32_t> Vertices;
+	/// Offsets of groups into Vertices, followed by the number of vertices.
+	std::vector<uint32_t> Offsets;
+
+	uint32_t GetGroupCount() const { return (uint32_t)Offsets.size() - 1; }
+};
+
+template<size_t SIZE>
+using TVertexKey = std::array<uint32_t, SIZE>;
+
+/// Returns bits of a float, with negative zero turned into zero.
+static inline uint32_t GetKeyBits(float _value)
+{
+	_value += 0.0f;
+	uint32_t bits;
+	std::memcpy(&bits, &_value, sizeof(bits));
+	return bits;
+}
+
+/// Groups vertices 0 to _count - 1 by keys returned by _getKey(vertex).
+/// Vertices are first distributed into buckets by hashes of their keys, then
+/// the buckets are sorted independently of each other on up to _threadCount
+/// threads. Vertices within a group are in ascending order and groups are in
+/// order of their first vertices.
+template<size_t SIZE, typename FN>
+static SVertexGroups GroupVertices(uint32_t _count, uint32_t _threadCount, FN&& _getKey)
+{
+	std::vector<uint64_t> hashes(_count);
+	ParallelForBlocks(_count, TANGENT_SPACE_BLOCK_SIZE, _threadCount, [&](uint32_t _begin, uint32_t _end)
+	{
+		for (uint32_t v = _begin; v < _end; ++v)
+		{
+			TVertexKey<SIZE> key = _getKey(v);
+			// Fibonacci hashing spreads the hash into the high bits used for
+			// buckets
+			hashes[v] = HashBytes(key.data(), sizeof(key)) * 0x9E3779B97F4A7C15ull;
+		}
+	});
+
+	// About 64 vertices per bucket
+	uint32_t bucketBits = 0;
+	while (bucketBits < 24 && ((uint64_t)64 << bucketBits) < _count)
+	{
+		++bucketBits;
+	}
+	uint32_t bucketCount = 1u << bucketBits;
+	auto getBucket = [&](uint32_t _vertex)
+	{
+		return (bucketBits > 0) ? (uint32_t)(hashes[_vertex] >> (64 - bucketBits)) : 0;
+	};
+
+	std::vector<uint32_t> bucketOffsets(bucketCount + 1, 0);
+	for (uint32_t v = 0; v < _count; ++v)
+	{
+		++bucketOffsets[getBucket(v) + 1];
+	}
+	for (uint32_t b = 0; b < bucketCount; ++b)
+	{
+		bucketOffsets[b + 1] += bucketOffsets[b];
+	}
+
+	SVertexGroups groups;
+	groups.Vertices.resize(_count);
+	{
+		std::vector<uint32_t> next(bucketOffsets.begin(), bucketOffsets.end() - 1);
+		for (uint32_t v = 0; v < _count; ++v)
+		{
+			groups.Vertices[next[getBucket(v)]++] = v;
+		}
+	}
+
+	// Sort buckets and mark first vertices of groups
+	std::vector<uint8_t> groupStarts(_count, 0);
+	ParallelForBlocks(bucketCount, TANGENT_SPACE_BLOCK_SIZE / 64, _threadCount, [&](uint32_t _begin, uint32_t _end)
+	{
+		for (uint32_t b = _begin; b < _end; ++b)
+		{
+			uint32_t* first = groups.Vertices.data() + bucketOffsets[b];
+			uint32_t* last = groups.Vertices.data() + bucketOffsets[b + 1];
+
+			std::sort(first, last, [&](uint32_t _a, uint32_t _b)
+			{
+				if (hashes[_a] != hashes[_b])
+				{
+					return hashes[_a] < hashes[_b];
+				}
+				TVertexKey<SIZE> keyA = _getKey(_a);
+				TVertexKey<SIZE> keyB = _getKey(_b);
+				if (keyA != keyB)
+				{
+					return keyA < keyB;
+				}
+				return _a < _b;
+			});
+
+			for (uint32_t* it = first; it != last; ++it)
+			{
+				bool start = (it == first
+					|| hashes[*it] != hashes[*(it - 1)]
+					|| _getKey(*it) != _getKey(*(it - 1)));
+				groupStarts[it - groups.Vertices.data()] = start ? 1 : 0;
+			}
+		}
+	});
+
+	// Reorder groups by their first vertices, so that they are processed in
+	// roughly the same order as the vertices and faces they reference
+	std::vector<uint32_t> groupFirst;
+	std::vector<uint32_t> groupOffsets;
+	for (uint32_t i = 0; i < _count; ++i)
+	{
+		if (groupStarts[i])
+		{
+			groupFirst.push_back(groups.Vertices[i]);
+			groupOffsets.push_back(i);
+		}
+	}
+	groupOffsets.push_back(_count);
+
+	std::vector<uint32_t> groupOfFirst(_count, UINT32_MAX);
+	for (uint32_t g = 0; g < (uint32_t)groupFirst.size(); ++g)
+	{
+		groupOfFirst[groupFirst[g]] = g;
+	}
+
+	std::vector<uint32_t> vertices;
+	vertices.reserve(_count);
+	groups.Offsets.reserve(groupFirst.size() + 1);
+	for (uint32_t v = 0; v < _count; ++v)
+	{
+		uint32_t g = groupOfFirst[v];
+		if (g != UINT32_MAX)
+		{
+			groups.Offsets.push_back((uint32_t)vertices.size());
+			vertices.insert(vertices.end(),
+				groups.Vertices.begin() + groupOffsets[g],
+				groups.Vertices.begin() + groupOffsets[g + 1]);
+		}
+	}
+	groups.Offsets.push_back(_count);
+	groups.Vertices = std::move(vertices);
+
+	return groups;
+}
+
+/// Corners of faces (face index * 3 + corner) that reference each vertex.
+struct SVertexCorners
+{
+	/// Corners ordered by vertices, then faces.
+	std::vector<uint32_t> Corners;
+	/// Offsets of vertices into Corners, followed by the number of corners.
+	std::vector<uint32_t> Offsets;
+
+	SVertexCorners(const aiMesh& _mesh);
+};
+
+SVertexCorners::SVertexCorners(const aiMesh& _mesh)
+	: Corners((size_t)_mesh.mNumFaces * 3)
+	, Offsets(_mesh.mNumVertices + 1, 0)
+{
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			++Offsets[_mesh.mFaces[f].mIndices[k] + 1];
+		}
+	}
+	for (uint32_t v = 0; v < _mesh.mNumVertices; ++v)
+	{
+		Offsets[v + 1] += Offsets[v];
+	}
+
+	std::vector<uint32_t> next(Offsets.begin(), Offsets.end() - 1);
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			Corners[next[_mesh.mFaces[f].mIndices[k]]++] = f * 3 + k;
+		}
+	}
+}
+
+/// Returns the normal of a face. Faces were reversed by
+/// aiProcess_FlipWindingOrder, so the cross product is reversed too, same as in
+/// Assimp's aiProcess_GenNormals, to point out of faces wound counter-clockwise
+/// in the model file.
+static inline aiVector3D GetFaceNormal(const aiMesh& _mesh, const aiFace& _face)
+{
+	const aiVector3D& v0 = _mesh.mVertices[_face.mIndices[0]];
+	const aiVector3D& v1 = _mesh.mVertices[_face.mIndices[1]];
+	const aiVector3D& v2 = _mesh.mVertices[_face.mIndices[2]];
+	return Vec3Cross(v2 - v0, v1 - v0).NormalizeSafe();
+}
+
+bool GenerateNormals(aiMesh& _mesh, bool _smooth, float _smoothingAngle, uint32_t _threadCount)
+{
+	if (_mesh.HasNormals() || !IsTriangleMesh(_mesh))
+	{
+		return false;
+	}
+
+	uint32_t vertexCount = _mesh.mNumVertices;
+	uint32_t faceCount = _mesh.mNumFaces;
+
+	std::vector<aiVector3D> faceNormals(faceCount);
+	ParallelForBlocks(faceCount, TANGENT_SPACE_BLOCK_SIZE, _threadCount, [&](uint32_t _begin, uint32_t _end)
+	{
+		for (uint32_t f = _begin; f < _end; ++f)
+		{
+			faceNormals[f] = GetFaceNormal(_mesh, _mesh.mFaces[f]);
+		}
+	});
+
+	if (!_smooth)
+	{
+		// Vertices shared by multiple faces get the normal of the last one,
+		// same as in Assimp
+		aiVector3D* normals = new aiVector3D[vertexCount];
+		for (uint32_t f = 0; f < faceCount; ++f)
+		{
+			const aiFace& face = _mesh.mFaces[f];
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				normals[face.mIndices[k]] = faceNormals[f];
+			}
+		}
+		_mesh.mNormals = normals;
+		return true;
+	}
+
+	SVertexCorners corners(_mesh);
+
+	SVertexGroups groups = GroupVertices<3>(vertexCount, _threadCount, [&](uint32_t _vertex)
+	{
+		const aiVector3D& position = _mesh.mVertices[_vertex];
+		return TVertexKey<3>{ GetKeyBits(position.x), GetKeyBits(position.y), GetKeyBits(position.z) };
+	});
+
+	bool smoothAll = (_smoothingAngle >= SMOOTHING_ANGLE_FULL);
+	float cosLimit = std::cos(_smoothingAngle * (float)AI_MATH_PI / 180.0f);
+
+	// Unlike in Assimp, normals of all faces of a vertex are averaged, not
+	// only of the last one, which matters only for meshes that share vertices
+	// between faces. Whether a face is within the smoothing angle is decided by
+	// the vertex's last face.
+	aiVector3D* normals = new aiVector3D[vertexCount];
+	ParallelForBlocks(groups.GetGroupCount(), TANGENT_SPACE_BLOCK_SIZE, _threadCount, [&](uint32_t _begin, uint32_t _end)
+	{
+		for (uint32_t g = _begin; g < _end; ++g)
+		{
+			const uint32_t* first = groups.Vertices.data() + groups.Offsets[g];
+			const uint32_t* last = groups.Vertices.data() + groups.Offsets[g + 1];
+
+			if (smoothAll)
+			{
+				aiVector3D sum(0.0f, 0.0f, 0.0f);
+				for (const uint32_t* it = first; it != last; ++it)
+				{
+					for (uint32_t c = corners.Offsets[*it]; c < corners.Offsets[*it + 1]; ++c)
+					{
+						sum += faceNormals[corners.Corners[c] / 3];
+					}
+				}
+				sum.NormalizeSafe();
+				for (const uint32_t* it = first; it != last; ++it)
+				{
+					normals[*it] = sum;
+				}
+				continue;
+			}
+
+			for (const uint32_t* it = first; it != last; ++it)
+			{
+				uint32_t cornerCount = corners.Offsets[*it + 1] - corners.Offsets[*it];
+				if (cornerCount == 0)
+				{
+					continue;
+				}
+
+				const aiVector3D& reference = faceNormals[corners.Corners[corners.Offsets[*it + 1] - 1] / 3];
+				float referenceLength = reference.Length();
+				aiVector3D sum(0.0f, 0.0f, 0.0f);
+				for (const uint32_t* other = first; other != last; ++other)
+				{
+					for (uint32_t c = corners.Offsets[*other]; c < corners.Offsets[*other + 1]; ++c)
+					{
+						const aiVector3D& normal = faceNormals[corners.Corners[c] / 3];
+						if (Vec3Dot(normal, reference) >= cosLimit * referenceLength * normal.Length())
+						{
+							sum += normal;
+						}
+					}
+				}
+				normals[*it] = sum.NormalizeSafe();
+			}
+		}
+	});
+
+	_mesh.mNormals = normals;
+	return true;
+}
+
+/// Returns _vector projected onto a plane with normal _normal.
+static inline aiVector3D ProjectOnPlane(const aiVector3D& _vector, const aiVector3D& _normal)
+{
+	return _vector - _normal * Vec3Dot(_normal, _vector);
+}
+
+/// Returns any unit vector perpendicular to _normal, used for vertices whose
+/// texture space is degenerate.
+static aiVector3D GetAnyTangent(const aiVector3D& _normal)
+{
+	aiVector3D tangent = ProjectOnPlane(aiVector3D(1.0f, 0.0f, 0.0f), _normal);
+	if (tangent.SquareLength() < 1e-6f)
+	{
+		tangent = ProjectOnPlane(aiVector3D(0.0f, 1.0f, 0.0f), _normal);
+	}
+	tangent.NormalizeSafe();
+	return (tangent.SquareLength() > 0.0f) ? tangent : aiVector3D(1.0f, 0.0f, 0.0f);
+}
+
+/// Orientation of texture space of a face whose area in texture space or in
+/// model space is zero, which does not contribute to tangents.
+#define FACE_ORIENTATION_NONE 2
+
+/// Appends copies of vertices _sources to a per-vertex array with _count
+/// elements, unless the mesh does not have it.
+template<typename T>
+static void AppendVertices(T*& _array, uint32_t _count, const std::vector<uint32_t>& _sources)
+{
+	if (!_array)
+	{
+		return;
+	}
+	T* array = new T[_count + _sources.size()];
+	std::copy(_array, _array + _count, array);
+	for (size_t i = 0; i < _sources.size(); ++i)
+	{
+		array[_count + i] = _array[_sources[i]];
+	}
+	delete[] _array;
+	_array = array;
+}
+
+/// Appends copies of vertices _sources to all per-vertex data of a mesh,
+/// including morph targets and bone weights. _duplicates maps vertices to
+/// their copies or UINT32_MAX.
+static void SplitVertices(aiMesh& _mesh, const std::vector<uint32_t>& _sources, const std::vector<uint32_t>& _duplicates)
+{
+	uint32_t count = _mesh.mNumVertices;
+	uint32_t newCount = count + (uint32_t)_sources.size();
+
+	AppendVertices(_mesh.mVertices, count, _sources);
+	AppendVertices(_mesh.mNormals, count, _sources);
+	AppendVertices(_mesh.mTangents, count, _sources);
+	AppendVertices(_mesh.mBitangents, count, _sources);
+	for (uint32_t c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c)
+	{
+		AppendVertices(_mesh.mColors[c], count, _sources);
+	}
+	for (uint32_t t = 0; t < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++t)
+	{
+		AppendVertices(_mesh.mTextureCoords[t], count, _sources);
+	}
+	_mesh.mNumVertices = newCount;
+
+	for (uint32_t a = 0; a < _mesh.mNumAnimMeshes; ++a)
+	{
+		aiAnimMesh& animMesh = *_mesh.mAnimMeshes[a];
+		if (animMesh.mNumVertices != count)
+		{
+			continue;
+		}
+		AppendVertices(animMesh.mVertices, count, _sources);
+		AppendVertices(animMesh.mNormals, count, _sources);
+		AppendVertices(animMesh.mTangents, count, _sources);
+		AppendVertices(animMesh.mBitangents, count, _sources);
+		for (uint32_t c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c)
+		{
+			AppendVertices(animMesh.mColors[c], count, _sources);
+		}
+		for (uint32_t t = 0; t < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++t)
+		{
+			AppendVertices(animMesh.mTextureCoords[t], count, _sources);
+		}
+		animMesh.mNumVertices = newCount;
+	}
+
+	for (uint32_t b = 0; b < _mesh.mNumBones; ++b)
+	{
+		aiBone& bone = *_mesh.mBones[b];
+		std::vector<aiVertexWeight> weights(bone.mWeights, bone.mWeights + bone.mNumWeights);
+		for (uint32_t w = 0; w < bone.mNumWeights; ++w)
+		{
+			uint32_t duplicate = _duplicates[bone.mWeights[w].mVertexId];
+			if (duplicate != UINT32_MAX)
+			{
+				weights.emplace_back(duplicate, bone.mWeights[w].mWeight);
+			}
+		}
+		if (weights.size() != bone.mNumWeights)
+		{
+			delete[] bone.mWeights;
+			bone.mWeights = new aiVertexWeight[weights.size()];
+			std::copy(weights.begin(), weights.end(), bone.mWeights);
+			bone.mNumWeights = (uint32_t)weights.size();
+		}
+	}
+}
+
+bool GenerateTangents(aiMesh& _mesh, uint32_t _threadCount)
+{
+	if (_mesh.HasTangentsAndBitangents()
+		|| !_mesh.HasNormals()
+		|| !_mesh.HasTextureCoords(0)
+		|| !IsTriangleMesh(_mesh))
+	{
+		return false;
+	}
+
+	uint32_t vertexCount = _mesh.mNumVertices;
+	uint32_t faceCount = _mesh.mNumFaces;
+	const aiVector3D* positions = _mesh.mVertices;
+	const aiVector3D* normals = _mesh.mNormals;
+	const aiVector3D* texCoords = _mesh.mTextureCoords[0];
+
+	// Tangents of faces projected onto normals of their corners and weighted by
+	// angles of the corners
+	std::vector<aiVector3D> cornerTangents((size_t)faceCount * 3);
+	// 1 if a face's texture space preserves orientation, 0 if it is mirrored or
+	// FACE_ORIENTATION_NONE. That is whether the tangent, bitangent and normal
+	// are right-handed, which does not depend on the winding order of the face.
+	std::vector<uint8_t> faceOrientations(faceCount);
+
+	ParallelForBlocks(faceCount, TANGENT_SPACE_BLOCK_SIZE, _threadCount, [&](uint32_t _begin, uint32_t _end)
+	{
+		for (uint32_t f = _begin; f < _end; ++f)
+		{
+			const uint32_t* indices = _mesh.mFaces[f].mIndices;
+			const aiVector3D& p0 = positions[indices[0]];
+			const aiVector3D& t0 = texCoords[indices[0]];
+			aiVector3D d1 = positions[indices[1]] - p0;
+			aiVector3D d2 = positions[indices[2]] - p0;
+			float t1x = texCoords[indices[1]].x - t0.x;
+			float t1y = texCoords[indices[1]].y - t0.y;
+			float t2x = texCoords[indices[2]].x - t0.x;
+			float t2y = texCoords[indices[2]].y - t0.y;
+
+			// Direction of increasing U, scaled by the area of the face in
+			// texture space
+			float signedArea = t1x * t2y - t1y * t2x;
+			float areaSign = (signedArea < 0.0f) ? -1.0f : 1.0f;
+			aiVector3D tangent = (d1 * t2y - d2 * t1y) * areaSign;
+
+			aiVector3D normal = normals[indices[0]] + normals[indices[1]] + normals[indices[2]];
+			float facing = Vec3Dot(Vec3Cross(d1, d2), normal);
+			if (signedArea == 0.0f || facing == 0.0f)
+			{
+				faceOrientations[f] = FACE_ORIENTATION_NONE;
+			}
+			else
+			{
+				faceOrientations[f] = ((facing < 0.0f) == (signedArea < 0.0f)) ? 1 : 0;
+			}
+
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				uint32_t current = indices[k];
+				uint32_t next = indices[(k + 1) % 3];
+				uint32_t previous = indices[(k + 2) % 3];
+				const aiVector3D& normal = normals[current];
+
+				aiVector3D edge1 = ProjectOnPlane(positions[next] - positions[current], normal).NormalizeSafe();
+				aiVector3D edge2 = ProjectOnPlane(positions[previous] - positions[current], normal).NormalizeSafe();
+				float angle = std::acos(std::clamp(Vec3Dot(edge1, edge2), -1.0f, 1.0f));
+
+				cornerTangents[(size_t)f * 3 + k] = ProjectOnPlane(tangent, normal).NormalizeSafe() * angle;
+			}
+		}
+	});
+
+	// Same as in MikkTSpace, vertices used by faces with both orientations are
+	// split, so that each corner gets the tangent of its own orientation. Copies
+	// are used by faces whose orientation differs from the vertex's first face.
+	std::vector<uint8_t> vertexOrientations(vertexCount, FACE_ORIENTATION_NONE);
+	std::vector<uint32_t> duplicates(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> sources;
+	for (uint32_t f = 0; f < faceCount; ++f)
+	{
+		uint8_t orientation = faceOrientations[f];
+		if (orientation == FACE_ORIENTATION_NONE)
+		{
+			continue;
+		}
+		uint32_t* indices = _mesh.mFaces[f].mIndices;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t vertex = indices[k];
+			if (vertexOrientations[vertex] == FACE_ORIENTATION_NONE)
+			{
+				vertexOrientations[vertex] = orientation;
+			}
+			else if (vertexOrientations[vertex] != orientation)
+			{
+				if (duplicates[vertex] == UINT32_MAX)
+				{
+					duplicates[vertex] = vertexCount + (uint32_t)sources.size();
+					sources.push_back(vertex);
+				}
+				indices[k] = duplicates[vertex];
+			}
+		}
+	}
+
+	if (!sources.empty())
+	{
+		SplitVertices(_mesh, sources, duplicates);
+		for (uint32_t source : sources)
+		{
+			vertexOrientations.push_back(1 - vertexOrientations[source]);
+		}
+		vertexCount = _mesh.mNumVertices;
+		positions = _mesh.mVertices;
+		normals = _mesh.mNormals;
+		texCoords = _mesh.mTextureCoords[0];
+	}
+
+	SVertexCorners corners(_mesh);
+
+	// Vertices with equal position, normal and texture coordinate are welded
+	SVertexGroups groups = GroupVertices<8>(vertexCount, _threadCount, [&](uint32_t _vertex)
+	{
+		const aiVector3D& position = positions[_vertex];
+		const aiVector3D& normal = normals[_vertex];
+		const aiVector3D& texCoord = texCoords[_vertex];
+		return TVertexKey<8>{
+			GetKeyBits(position.x), GetKeyBits(position.y), GetKeyBits(position.z),
+			GetKeyBits(normal.x), GetKeyBits(normal.y), GetKeyBits(normal.z),
+			GetKeyBits(texCoord.x), GetKeyBits(texCoord.y),
+		};
+	});
+
+	aiVector3D* tangents = new aiVector3D[vertexCount];
+	aiVector3D* bitangents = new aiVector3D[vertexCount];
+
+	ParallelForBlocks(groups.GetGroupCount(), TANGENT_SPACE_BLOCK_SIZE, _threadCount, [&](uint32_t _begin, uint32_t _end)
+	{
+		for (uint32_t g = _begin; g < _end; ++g)
+		{
+			const uint32_t* first = groups.Vertices.data() + groups.Offsets[g];
+			const uint32_t* last = groups.Vertices.data() + groups.Offsets[g + 1];
+
+			// Sums of corner tangents for mirrored and preserved orientation
+			aiVector3D sums[2] = {
+				aiVector3D(0.0f, 0.0f, 0.0f),
+				aiVector3D(0.0f, 0.0f, 0.0f),
+			};
+			for (const uint32_t* it = first; it != last; ++it)
+			{
+				for (uint32_t c = corners.Offsets[*it]; c < corners.Offsets[*it + 1]; ++c)
+				{
+					uint32_t corner = corners.Corners[c];
+					uint8_t orientation = faceOrientations[corner / 3];
+					if (orientation != FACE_ORIENTATION_NONE)
+					{
+						sums[orientation] += cornerTangents[corner];
+					}
+				}
+			}
+
+			for (const uint32_t* it = first; it != last; ++it)
+			{
+				uint32_t vertex = *it;
+				const aiVector3D& normal = normals[vertex];
+
+				// Vertices used only by faces without texture space keep the
+				// default orientation
+				uint32_t orientation = vertexOrientations[vertex];
+				if (orientation == FACE_ORIENTATION_NONE)
+				{
+					orientation = 1;
+				}
+
+				aiVector3D tangent = sums[orientation];
+				tangent.NormalizeSafe();
+				if (tangent.SquareLength() == 0.0f)
+				{
+					tangent = GetAnyTangent(normal);
+				}
+
+				// Same as in Assimp, bitangents point towards decreasing V, which
+				// is increasing V once SConfig::FlipUVs flips texture coordinates
+				tangents[vertex] = tangent;
+				bitangents[vertex] = Vec3Cross(normal, tangent) * ((orientation != 0) ? -1.0f : 1.0f);
+			}
+		}
+	});
+
+	_mesh.mTangents = tangents;
+	_mesh.mBitangents = bitangents;
+	return true;
+}
+
+void GenerateTangentSpace(aiScene& _scene, const SConfig& _conf, std::ostream& _log)
+{
+	std::vector<uint8_t> normalsGenerated(_scene.mNumMeshes, 0);
+	std::vector<uint8_t> tangentsGenerated(_scene.mNumMeshes, 0);
+
+	auto processMesh = [&](uint32_t _index, uint32_t _threadCount)
+	{
+		aiMesh& mesh = *_scene.mMeshes[_index];
+		if (_conf.WriteNormals)
+		{
+			normalsGenerated[_index] = GenerateNormals(mesh, _conf.SmoothNormals, _conf.SmoothingAngle, _threadCount);
+		}
+		if (_conf.WriteTangents)
+		{
+			tangentsGenerated[_index] = GenerateTangents(mesh, _threadCount);
+		}
+	};
+
+	std::vector<uint32_t> smallMeshes;
+	std::vector<uint32_t> largeMeshes;
+	for (uint32_t i = 0; i < _scene.mNumMeshes; ++i)
+	{
+		if (_scene.mMeshes[i]->mNumVertices < TANGENT_SPACE_LARGE_MESH)
+		{
+			smallMeshes.push_back(i);
+		}
+		else
+		{
+			largeMeshes.push_back(i);
+		}
+	}
+
+	ParallelFor((uint32_t)smallMeshes.size(), _conf.ThreadCount, [&](uint32_t _i)
+	{
+		processMesh(smallMeshes[_i], 1);
+	});
+
+	for (uint32_t index : largeMeshes)
+	{
+		processMesh(index, _conf.ThreadCount);
+	}
+
+	uint32_t normalCount = 0;
+	uint32_t tangentCount = 0;
+	for (uint32_t i = 0; i < _scene.mNumMeshes; ++i)
+	{
+		normalCount += normalsGenerated[i];
+		tangentCount += tangentsGenerated[i];
+	}
+
+	_log
+		<< "Generated normals for " << normalCount << " and tangents for "
+		<< tangentCount << " of " << _scene.mNumMeshes << " meshes" << std::endl;
+}
@@ -1,38 +1,151 @@
+#include <cluster.hpp>
+#include <container.hpp>
+#include <encoder.hpp>
+#include <grid.hpp>
+#include <hash.hpp>
+#include <kernels.hpp>
+#include <morph.hpp>
+#include <optimize.hpp>
+#include <parallel.hpp>
+#include <simplify.hpp>
 #include <writing.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
 
-#define PRIMITIVE_TYPE_NAME(_type) \
+/// Triangles are written as strips if _strip is true.
+#define PRIMITIVE_TYPE_NAME(_type, _strip) \
 	(((_type & aiPrimitiveType_POINT) != 0) ? "pr_pointlist" \
 	: (((_type & aiPrimitiveType_LINE) != 0) ? "pr_linelist" \
-	: (((_type & aiPrimitiveType_TRIANGLE) != 0) ? "pr_trianglelist" \
+	: (((_type & aiPrimitiveType_TRIANGLE) != 0) ? ((_strip) ? "pr_trianglestrip" : "pr_trianglelist") \
 	: "unknown")))
 
+#define PRIMITIVE_TYPE_GM(_type, _strip) \
+	(((_type & aiPrimitiveType_POINT) != 0) ? 1 \
+	: (((_type & aiPrimitiveType_LINE) != 0) ? 2 \
+	: (((_type & aiPrimitiveType_TRIANGLE) != 0) ? ((_strip) ? 5 : 4) \
+	: 0)))
+
 #define MESSAGE_MULTIPLE_MATERIALS \
 "WARNING: Model consists of multiple materials, but this tool collapses the\n" \
 "entire model into a single vertex buffer! It is recommended to use a single\n" \
-"material for the entire model instead!"
+"material for the entire model instead, or argument --submeshes!"
 
-void WriteString(std::ofstream& _file, const char* _value)
+void SStagingBuffer::Reserve(size_t _size)
 {
-	_file.write(_value, strlen(_value) + 1);
+	Data.reserve(Data.size() + _size);
 }
 
-void WriteMesh(std::ofstream& _file, const aiScene& _scene, const aiMesh& _mesh, const SConfig& _conf)
+void SStagingBuffer::Flush(std::ostream& _file)
 {
-	bool hasNormals = _mesh.HasNormals();
-	bool hasTextureCoords = _mesh.HasTextureCoords(0);
-	bool hasTextureCoords2 = _mesh.HasTextureCoords(1);
-	bool hasVertexColors = _mesh.HasVertexColors(0);
-	bool hasTangentsAndBitangents = _mesh.HasTangentsAndBitangents();
-	aiVector3D up(0.0f, 1.0f, 0.0f);
+	if (!Data.empty())
+	{
+		_file.write(Data.data(), Data.size());
+		Data.clear();
+	}
+}
+
+void WriteString(SStagingBuffer& _buffer, const char* _value)
+{
+	_buffer.Write(_value, strlen(_value) + 1);
+}
+
+uint32_t GetVertexCount(const aiMesh& _mesh)
+{
+	uint32_t count = 0;
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		count += _mesh.mFaces[f].mNumIndices;
+	}
+	return count;
+}
+
+std::vector<SMeshInstance> GetMeshInstances(const aiScene& _scene, const SConfig& _conf)
+{
+	std::vector<SMeshInstance> instances;
+
+	if (!_conf.WalksNodes() || !_scene.mRootNode)
+	{
+		instances.resize(_scene.mNumMeshes);
+		for (uint32_t i = 0; i < _scene.mNumMeshes; ++i)
+		{
+			instances[i].MeshIndex = i;
+		}
+		return instances;
+	}
+
+	// Depth-first, with an explicit stack since hierarchies can be deep
+	std::vector<std::pair<const aiNode*, aiMatrix4x4>> stack;
+	stack.emplace_back(_scene.mRootNode, _scene.mRootNode->mTransformation);
+
+	while (!stack.empty())
+	{
+		const aiNode* node = stack.back().first;
+		aiMatrix4x4 transform = stack.back().second;
+		stack.pop_back();
+
+		for (uint32_t i = 0; i < node->mNumMeshes; ++i)
+		{
+			SMeshInstance instance;
+			instance.MeshIndex = node->mMeshes[i];
+			instance.Transform = transform;
+			instance.Transformed = !transform.IsIdentity();
+			instance.Mirrored = (transform.Determinant() < 0.0f);
+			instances.push_back(instance);
+		}
+
+		for (uint32_t i = node->mNumChildren; i > 0; --i)
+		{
+			const aiNode* child = node->mChildren[i - 1];
+			stack.emplace_back(child, transform * child->mTransformation);
+		}
+	}
+
+	return instances;
+}
+
+std::vector<SMeshInstance> GetUniqueMeshes(const aiScene& _scene, const std::vector<SMeshInstance>& _instances)
+{
+	std::vector<SMeshInstance> meshes;
+	std::vector<bool> added(_scene.mNumMeshes, false);
+	for (const SMeshInstance& instance : _instances)
+	{
+		if (!added[instance.MeshIndex])
+		{
+			added[instance.MeshIndex] = true;
+			SMeshInstance mesh;
+			mesh.MeshIndex = instance.MeshIndex;
+			meshes.push_back(mesh);
+		}
+	}
+	return meshes;
+}
+
+std::vector<uint32_t> GetFaceIndices(const aiMesh& _mesh, const SConfig& _conf, const SMeshInstance* _instance)
+{
+	bool invertWinding = (_conf.InvertWinding != (_instance && _instance->Mirrored));
+
+	std::vector<uint32_t> indices;
+
+	if (_instance && _instance->Triangles)
+	{
+		const std::vector<uint32_t>& triangles = *_instance->Triangles;
+		indices.reserve(triangles.size());
+		for (size_t t = 0; t < triangles.size(); t += 3)
+		{
+			for (uint32_t v = 0; v < 3; ++v)
+			{
+				uint32_t vReal = invertWinding ? (3 - (v + 1)) : v;
+				indices.push_back(triangles[t + vReal]);
+			}
+		}
+		return indices;
+	}
 
-	aiMaterial* material = _scene.mMaterials[_mesh.mMaterialIndex];
-	aiColor3D materialColor(1.0f, 1.0f, 1.0f);
-	material->Get(AI_MATKEY_COLOR_DIFFUSE, materialColor);
-	float materialOpacity = 1.0f;
-	material->Get(AI_MATKEY_OPACITY, materialOpacity);
+	indices.reserve(GetVertexCount(_mesh));
 
 	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
 	{
@@ -40,178 +153,1077 @@ void WriteMesh(std::ofstream& _file, const aiScene& _scene, const aiMesh& _mesh,
 
 		for (uint32_t v = 0; v < face.mNumIndices; ++v)
 		{
-			uint32_t vReal = _conf.InvertWinding ? (face.mNumIndices - (v + 1)) : v;
-			uint32_t i = face.mIndices[vReal];
+			uint32_t vReal = invertWinding ? (face.mNumIndices - (v + 1)) : v;
+			indices.push_back(face.mIndices[vReal]);
+		}
+	}
+
+	return indices;
+}
+
+/// Returns true if triangles of a mesh are written as a triangle strip.
+static bool IsStrip(const aiMesh& _mesh, const SConfig& _conf)
+{
+	return (_conf.Strip && _mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE);
+}
+
+/// Maps each of _count encoded vertices to the first vertex with identical
+/// bytes.
+static std::vector<uint32_t> WeldEncodedVertices(const char* _encoded, size_t _vertexSize, uint32_t _count)
+{
+	size_t tableSize = 1;
+	while (tableSize < (size_t)_count * 2)
+	{
+		tableSize <<= 1;
+	}
+	std::vector<uint32_t> table(tableSize, UINT32_MAX);
+	std::vector<uint32_t> weld(_count);
+
+	for (uint32_t i = 0; i < _count; ++i)
+	{
+		const char* vertex = _encoded + (size_t)i * _vertexSize;
+		size_t slot = HashBytes(vertex, _vertexSize) & (tableSize - 1);
+		while (table[slot] != UINT32_MAX
+			&& memcmp(vertex, _encoded + (size_t)table[slot] * _vertexSize, _vertexSize) != 0)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == UINT32_MAX)
+		{
+			table[slot] = i;
+		}
+		weld[i] = table[slot];
+	}
+
+	return weld;
+}
+
+/// If the instance writes only some triangles of the mesh, replaces indices of
+/// vertices of the mesh in _indices with indices into _vertices, which gets
+/// the vertices they reference in ascending order, and returns a pointer to
+/// it. Returns nullptr if the instance writes the whole mesh.
+static const std::vector<uint32_t>* CompactInstanceIndices(
+	const SMeshInstance* _instance, std::vector<uint32_t>& _indices, std::vector<uint32_t>& _vertices)
+{
+	if (!_instance || !_instance->Triangles)
+	{
+		return nullptr;
+	}
+
+	_vertices = _indices;
+	std::sort(_vertices.begin(), _vertices.end());
+	_vertices.erase(std::unique(_vertices.begin(), _vertices.end()), _vertices.end());
+	for (uint32_t& index : _indices)
+	{
+		index = (uint32_t)(std::lower_bound(_vertices.begin(), _vertices.end(), index) - _vertices.begin());
+	}
+	return &_vertices;
+}
+
+void WriteMesh(
+	SStagingBuffer& _buffer,
+	const aiScene& _scene,
+	const aiMesh& _mesh,
+	const SConfig& _conf,
+	const SMeshInstance* _instance)
+{
+	std::vector<uint32_t> indices = GetFaceIndices(_mesh, _conf, _instance);
+	std::vector<uint32_t> instanceVertices;
+	const std::vector<uint32_t>* vertices = CompactInstanceIndices(_instance, indices, instanceVertices);
+	uint32_t vertexCount = vertices ? (uint32_t)vertices->size() : _mesh.mNumVertices;
+	SMeshEncoder encoder(_scene, _mesh, _conf, _instance ? _instance->GetTransform() : nullptr, vertices);
+
+	if (IsStrip(_mesh, _conf))
+	{
+		// Vertices are welded by their encoded bytes first, so that triangles
+		// share edges of strips even if the mesh repeats identical vertices
+		size_t vertexSize = encoder.VertexSize;
+		std::vector<char> encoded((size_t)vertexCount * vertexSize);
+		encoder.Encode(encoded.data(), nullptr, vertexCount);
+		std::vector<uint32_t> weld = WeldEncodedVertices(encoded.data(), vertexSize, vertexCount);
+		for (uint32_t& index : indices)
+		{
+			index = weld[index];
+		}
+
+		std::vector<uint32_t> strip = StripifyTriangles(indices, vertexCount);
+		size_t offset = _buffer.Data.size();
+		_buffer.Data.resize(offset + strip.size() * vertexSize);
+		for (size_t i = 0; i < strip.size(); ++i)
+		{
+			memcpy(_buffer.Data.data() + offset + i * vertexSize, encoded.data() + (size_t)strip[i] * vertexSize, vertexSize);
+		}
+		return;
+	}
+
+	size_t offset = _buffer.Data.size();
+	_buffer.Data.resize(offset + indices.size() * encoder.VertexSize);
+	encoder.Encode(_buffer.Data.data() + offset, indices.data(), indices.size());
+}
+
+void WriteMeshIndexed(
+	SStagingBuffer& _vertices,
+	std::vector<uint32_t>& _indices,
+	const aiScene& _scene,
+	const aiMesh& _mesh,
+	const SConfig& _conf,
+	const SMeshInstance* _instance)
+{
+	std::vector<uint32_t> faceIndices = GetFaceIndices(_mesh, _conf, _instance);
+	std::vector<uint32_t> instanceVertices;
+	const std::vector<uint32_t>* vertices = CompactInstanceIndices(_instance, faceIndices, instanceVertices);
+	uint32_t vertexCount = vertices ? (uint32_t)vertices->size() : _mesh.mNumVertices;
+
+	SMeshEncoder encoder(_scene, _mesh, _conf, _instance ? _instance->GetTransform() : nullptr, vertices);
+	size_t vertexSize = encoder.VertexSize;
+	uint32_t baseVertex = (uint32_t)(_vertices.Data.size() / vertexSize);
+	uint32_t uniqueCount = 0;
+
+	// All vertices of the mesh (or of the instance's part of it) are encoded
+	// at once and then deduplicated by their encoded bytes
+	std::vector<char> encoded((size_t)vertexCount * vertexSize);
+	encoder.Encode(encoded.data(), nullptr, vertexCount);
+
+	// Open addressing hash table of unique vertices, storing their index + 1
+	size_t tableSize = 1;
+	while (tableSize < (size_t)vertexCount * 2)
+	{
+		tableSize <<= 1;
+	}
+	std::vector<uint32_t> table(tableSize, 0);
+
+	// Maps encoded vertices to the deduplicated ones
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
 
-			// Position
-			if (_conf.WritePositions)
+	size_t firstIndex = _indices.size();
+	_indices.reserve(_indices.size() + faceIndices.size());
+
+	for (uint32_t i : faceIndices)
+	{
+		if (remap[i] == UINT32_MAX)
+		{
+			const char* vertex = encoded.data() + (size_t)i * vertexSize;
+			size_t slot = HashBytes(vertex, vertexSize) & (tableSize - 1);
+			while (table[slot] != 0)
 			{
-				aiVector3D position = Vec3ConvertUp(_mesh.mVertices[i], _conf.UpVector);
-				WriteSingle<float>(_file, position.x);
-				WriteSingle<float>(_file, position.y);
-				WriteSingle<float>(_file, position.z);
-				// std::cout << position.x << ", " << position.y << ", " << position.z << ", ";
+				const char* other = _vertices.Data.data()
+					+ (baseVertex + table[slot] - 1) * vertexSize;
+				if (memcmp(vertex, other, vertexSize) == 0)
+				{
+					break;
+				}
+				slot = (slot + 1) & (tableSize - 1);
 			}
 
-			// Normal vectors
-			aiVector3D normal = Vec3ConvertUp(hasNormals ? _mesh.mNormals[i] : up, _conf.UpVector);
+			if (table[slot] == 0)
+			{
+				table[slot] = ++uniqueCount;
+				_vertices.Write(vertex, vertexSize);
+			}
+
+			remap[i] = baseVertex + table[slot] - 1;
+		}
+
+		_indices.push_back(remap[i]);
+	}
+
+	if (IsStrip(_mesh, _conf))
+	{
+		// Deduplicated vertices already share indices
+		std::vector<uint32_t> triangles(_indices.begin() + firstIndex, _indices.end());
+		for (uint32_t& index : triangles)
+		{
+			index -= baseVertex;
+		}
+		std::vector<uint32_t> strip = StripifyTriangles(triangles, uniqueCount);
+		_indices.resize(firstIndex);
+		for (uint32_t index : strip)
+		{
+			_indices.push_back(baseVertex + index);
+		}
+	}
+}
+
+/// Computes bounding boxes of positions of mesh instances in parallel, after
+/// their transforms and conversion into the up axis are applied.
+static std::vector<aiAABB> ComputeInstanceBounds(
+	const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf)
+{
+	std::vector<aiAABB> bounds(_instances.size());
+	ParallelFor((uint32_t)_instances.size(), _conf.ThreadCount, [&](uint32_t _i)
+	{
+		const SMeshInstance& instance = _instances[_i];
+		const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+		bounds[_i] = AABBEmpty();
+		uint32_t count = instance.Triangles ? (uint32_t)instance.Triangles->size() : mesh.mNumVertices;
+		for (uint32_t k = 0; k < count; ++k)
+		{
+			uint32_t v = instance.Triangles ? (*instance.Triangles)[k] : k;
+			aiVector3D position = instance.Transformed
+				? (instance.Transform * mesh.mVertices[v])
+				: mesh.mVertices[v];
+			AABBAddPoint(bounds[_i], Vec3ConvertUp(position, _conf.UpVector));
+		}
+	});
+	return bounds;
+}
 
-			if (_conf.WriteNormals)
+static aiAABB ComputePositionBounds(
+	const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf)
+{
+	aiAABB bounds = AABBEmpty();
+	for (const aiAABB& instanceBounds : ComputeInstanceBounds(_scene, _instances, _conf))
+	{
+		AABBAdd(bounds, instanceBounds);
+	}
+	return bounds;
+}
+
+/// Encodes all mesh instances in parallel, each into its own buffer.
+static std::vector<SStagingBuffer> WriteMeshes(
+	const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf)
+{
+	std::vector<SStagingBuffer> buffers(_instances.size());
+	ParallelFor((uint32_t)_instances.size(), _conf.ThreadCount, [&](uint32_t _i)
+	{
+		const aiMesh& mesh = *_scene.mMeshes[_instances[_i].MeshIndex];
+		size_t vertexCount = _instances[_i].Triangles ? _instances[_i].Triangles->size() : GetVertexCount(mesh);
+		buffers[_i].Reserve(vertexCount * _conf.GetVertexSize());
+		WriteMesh(buffers[_i], _scene, mesh, _conf, &_instances[_i]);
+	});
+	return buffers;
+}
+
+/// Writes the number of vertices encoded per second into _log.
+static void LogEncodeThroughput(std::ostream& _log, uint64_t _vertexCount, SProfiler::Clock::duration _duration)
+{
+	double seconds = std::chrono::duration<double>(_duration).count();
+	_log << "Encoded " << _vertexCount << " vertices (";
+	if (seconds > 0.0)
+	{
+		_log << (uint64_t)(_vertexCount / seconds) << " vertices/s, ";
+	}
+	_log << GetKernelInstructionSet() << ")" << std::endl;
+}
+
+/// A contiguous range of mesh instances with the same material, primitive type,
+/// level of detail and cell, written as a single sub-mesh.
+struct SMeshRange
+{
+	uint32_t Lod = 0;
+	uint32_t Cell = 0;
+	uint32_t MaterialIndex = 0;
+	uint32_t PrimitiveType = 0;
+	uint32_t VertexOffset = 0;
+	uint32_t VertexCount = 0;
+	uint32_t IndexOffset = 0;
+	uint32_t IndexCount = 0;
+};
+
+/// Returns indices of mesh instances in the order in which they are written.
+/// Instances are grouped by their level of detail and cell and with sub-meshes
+/// enabled also by material and primitive type of their meshes, otherwise they
+/// are written in their original order.
+static std::vector<uint32_t> GetMeshOrder(
+	const aiScene& _scene, const std::vector<SMeshInstance>& _instances, const SConfig& _conf)
+{
+	std::vector<uint32_t> order(_instances.size());
+	for (uint32_t i = 0; i < (uint32_t)_instances.size(); ++i)
+	{
+		order[i] = i;
+	}
+
+	if (_conf.SubMeshes || _conf.GetLodCount() > 0 || _conf.Grid != EGrid::None)
+	{
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b)
+		{
+			if (_instances[_a].Lod != _instances[_b].Lod)
+			{
+				return _instances[_a].Lod < _instances[_b].Lod;
+			}
+			if (_instances[_a].Cell != _instances[_b].Cell)
 			{
-				WriteSingle<float>(_file, normal.x);
-				WriteSingle<float>(_file, normal.y);
-				WriteSingle<float>(_file, normal.z);
-				// std::cout << normal.x << ", " << normal.y << ", " << normal.z << ", ";
+				return _instances[_a].Cell < _instances[_b].Cell;
 			}
+			if (!_conf.SubMeshes)
+			{
+				return false;
+			}
+			const aiMesh& a = *_scene.mMeshes[_instances[_a].MeshIndex];
+			const aiMesh& b = *_scene.mMeshes[_instances[_b].MeshIndex];
+			if (a.mMaterialIndex != b.mMaterialIndex)
+			{
+				return a.mMaterialIndex < b.mMaterialIndex;
+			}
+			return a.mPrimitiveTypes < b.mPrimitiveTypes;
+		});
+	}
+
+	return order;
+}
+
+/// Bounding box and sphere of positions.
+struct SBounds
+{
+	aiAABB Box = AABBEmpty();
+	aiVector3D Center;
+	float Radius = 0.0f;
+};
+
+/// Computes bounds of groups of mesh instances, where _groups holds the index
+/// of the group of each instance. Spheres are centered at the centers of the
+/// boxes.
+static std::vector<SBounds> ComputeGroupBounds(
+	const aiScene& _scene,
+	const std::vector<SMeshInstance>& _instances,
+	const std::vector<uint32_t>& _groups,
+	uint32_t _groupCount,
+	const SConfig& _conf)
+{
+	std::vector<SBounds> bounds(_groupCount);
+	std::vector<aiAABB> instanceBounds = ComputeInstanceBounds(_scene, _instances, _conf);
+	for (size_t i = 0; i < _instances.size(); ++i)
+	{
+		AABBAdd(bounds[_groups[i]].Box, instanceBounds[i]);
+	}
+
+	for (SBounds& group : bounds)
+	{
+		if (!AABBIsEmpty(group.Box))
+		{
+			group.Center = (group.Box.mMin + group.Box.mMax) * 0.5f;
+		}
+	}
+
+	std::vector<float> radii(_instances.size(), 0.0f);
+	ParallelFor((uint32_t)_instances.size(), _conf.ThreadCount, [&](uint32_t _i)
+	{
+		const SMeshInstance& instance = _instances[_i];
+		const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+		const aiVector3D& center = bounds[_groups[_i]].Center;
+		float radiusSqr = 0.0f;
+		uint32_t count = instance.Triangles ? (uint32_t)instance.Triangles->size() : mesh.mNumVertices;
+		for (uint32_t k = 0; k < count; ++k)
+		{
+			uint32_t v = instance.Triangles ? (*instance.Triangles)[k] : k;
+			aiVector3D position = instance.Transformed
+				? (instance.Transform * mesh.mVertices[v])
+				: mesh.mVertices[v];
+			position = Vec3ConvertUp(position, _conf.UpVector);
+			radiusSqr = std::max(radiusSqr, (position - center).SquareLength());
+		}
+		radii[_i] = std::sqrt(radiusSqr);
+	});
+
+	for (size_t i = 0; i < _instances.size(); ++i)
+	{
+		SBounds& group = bounds[_groups[i]];
+		group.Radius = std::max(group.Radius, radii[i]);
+	}
+
+	return bounds;
+}
+
+static void WriteBoundingVolume(SStagingBuffer& _buffer, const SBounds& _bounds)
+{
+	WriteSingle<float>(_buffer, _bounds.Box.mMin.x);
+	WriteSingle<float>(_buffer, _bounds.Box.mMin.y);
+	WriteSingle<float>(_buffer, _bounds.Box.mMin.z);
+	WriteSingle<float>(_buffer, _bounds.Box.mMax.x);
+	WriteSingle<float>(_buffer, _bounds.Box.mMax.y);
+	WriteSingle<float>(_buffer, _bounds.Box.mMax.z);
+	WriteSingle<float>(_buffer, _bounds.Center.x);
+	WriteSingle<float>(_buffer, _bounds.Center.y);
+	WriteSingle<float>(_buffer, _bounds.Center.z);
+	WriteSingle<float>(_buffer, _bounds.Radius);
+}
+
+/// A node written into the NODE chunk.
+struct SNodeEntry
+{
+	const aiNode* Node = nullptr;
+	uint32_t Parent = UINT32_MAX;
+	/// Bounds of meshes of the node and all its children, in the node's space.
+	aiAABB Bounds = AABBEmpty();
+};
+
+/// Adds the NODE chunk with the node hierarchy of a scene to a container.
+/// _meshes are the meshes written only once and _meshRanges are indices of
+/// their sub-meshes, indexed by mesh index.
+static void WriteNodes(
+	SContainer& _container,
+	const aiScene& _scene,
+	const std::vector<SMeshInstance>& _meshes,
+	const std::vector<uint32_t>& _meshRanges,
+	const SConfig& _conf,
+	std::ostream& _log)
+{
+	std::vector<aiAABB> meshBounds(_scene.mNumMeshes, AABBEmpty());
+	std::vector<aiAABB> bounds = ComputeInstanceBounds(_scene, _meshes, _conf);
+	for (size_t i = 0; i < _meshes.size(); ++i)
+	{
+		meshBounds[_meshes[i].MeshIndex] = bounds[i];
+	}
 
-			// Texture coords
-			if (_conf.WriteTextureCoords)
+	// Depth-first, same as GetMeshInstances, so parents come before children
+	std::vector<SNodeEntry> nodes;
+	std::vector<std::pair<const aiNode*, uint32_t>> stack;
+	if (_scene.mRootNode)
+	{
+		stack.emplace_back(_scene.mRootNode, UINT32_MAX);
+	}
+
+	while (!stack.empty())
+	{
+		SNodeEntry entry;
+		entry.Node = stack.back().first;
+		entry.Parent = stack.back().second;
+		stack.pop_back();
+
+		uint32_t index = (uint32_t)nodes.size();
+		nodes.push_back(entry);
+
+		for (uint32_t i = entry.Node->mNumChildren; i > 0; --i)
+		{
+			stack.emplace_back(entry.Node->mChildren[i - 1], index);
+		}
+	}
+
+	// Bounds of children are complete before they are added to their parents
+	for (size_t i = nodes.size(); i > 0; --i)
+	{
+		SNodeEntry& entry = nodes[i - 1];
+		for (uint32_t m = 0; m < entry.Node->mNumMeshes; ++m)
+		{
+			AABBAdd(entry.Bounds, meshBounds[entry.Node->mMeshes[m]]);
+		}
+
+		if (entry.Parent != UINT32_MAX)
+		{
+			aiMatrix4x4 transform = Mat4ConvertUp(entry.Node->mTransformation, _conf.UpVector);
+			AABBAdd(nodes[entry.Parent].Bounds, AABBTransform(entry.Bounds, transform));
+		}
+	}
+
+	_log << "Nodes: " << nodes.size() << std::endl;
+
+	SStagingBuffer& nodeChunk = _container.AddChunk(EChunk::Nodes);
+	WriteSingle<uint32_t>(nodeChunk, nodes.size());
+	for (const SNodeEntry& entry : nodes)
+	{
+		aiMatrix4x4 transform = Mat4ConvertUp(entry.Node->mTransformation, _conf.UpVector);
+		transform.Transpose();
+
+		WriteSingle<uint32_t>(nodeChunk, entry.Parent);
+		WriteArray<float>(nodeChunk, transform[0], 16);
+		WriteSingle<float>(nodeChunk, entry.Bounds.mMin.x);
+		WriteSingle<float>(nodeChunk, entry.Bounds.mMin.y);
+		WriteSingle<float>(nodeChunk, entry.Bounds.mMin.z);
+		WriteSingle<float>(nodeChunk, entry.Bounds.mMax.x);
+		WriteSingle<float>(nodeChunk, entry.Bounds.mMax.y);
+		WriteSingle<float>(nodeChunk, entry.Bounds.mMax.z);
+		WriteSingle<uint32_t>(nodeChunk, entry.Node->mNumMeshes);
+		for (uint32_t m = 0; m < entry.Node->mNumMeshes; ++m)
+		{
+			WriteSingle<uint32_t>(nodeChunk, _meshRanges[entry.Node->mMeshes[m]]);
+		}
+		WriteString(nodeChunk, entry.Node->mName.C_Str());
+	}
+}
+
+static void WriteSceneContainer(
+	std::ostream& _file,
+	const aiScene& _scene,
+	const std::vector<SMeshInstance>& _instances,
+	const std::vector<SMeshInstance>& _sceneInstances,
+	const std::vector<float>& _lodErrors,
+	const std::vector<SGridCell>& _cells,
+	const std::vector<std::vector<SCluster>>& _clusters,
+	const SMorphTargets& _morph,
+	uint32_t _primitiveType,
+	const SConfig& _conf,
+	std::ostream& _log,
+	SProfiler* _profiler)
+{
+	SProfiler::SScope encodeScope(_profiler, "Encode");
+
+	uint32_t vertexSize = _conf.GetVertexSize();
+	std::vector<uint32_t> meshOrder = GetMeshOrder(_scene, _instances, _conf);
+	uint32_t instanceCount = (uint32_t)_instances.size();
+	std::vector<SMeshRange> ranges;
+	std::vector<uint32_t> meshRanges(_scene.mNumMeshes, 0);
+	std::vector<uint32_t> instanceRanges(instanceCount, 0);
+	// First vertex (or index if indexed) of each instance
+	std::vector<uint32_t> instanceStarts(instanceCount, 0);
+	bool writeSubMeshes = (_conf.SubMeshes || _conf.WritesMeshesOnce() || !_lodErrors.empty() || !_cells.empty());
+	SStagingBuffer vertices;
+	std::vector<uint32_t> indices;
+
+	std::vector<SStagingBuffer> meshVertices;
+	std::vector<std::vector<uint32_t>> meshIndices(instanceCount);
+	uint64_t encodedCount = 0;
+
+	if (_conf.Indexed)
+	{
+		// Meshes are deduplicated independently of each other, each with indices
+		// starting at 0, and then concatenated
+		meshVertices.resize(instanceCount);
+		ParallelFor(instanceCount, _conf.ThreadCount, [&](uint32_t _i)
+		{
+			const SMeshInstance& instance = _instances[_i];
+			WriteMeshIndexed(meshVertices[_i], meshIndices[_i], _scene, *_scene.mMeshes[instance.MeshIndex], _conf, &instance);
+		});
+
+		for (const SMeshInstance& instance : _instances)
+		{
+			encodedCount += _scene.mMeshes[instance.MeshIndex]->mNumVertices;
+		}
+	}
+	else
+	{
+		meshVertices = WriteMeshes(_scene, _instances, _conf);
+
+		for (uint32_t i = 0; i < instanceCount; ++i)
+		{
+			encodedCount += meshVertices[i].Data.size() / vertexSize;
+		}
+	}
+
+	size_t vertexDataSize = 0;
+	size_t indexCount = 0;
+	uint64_t stripVertexCount = 0;
+	uint64_t stripTriangleCount = 0;
+	for (uint32_t i = 0; i < instanceCount; ++i)
+	{
+		vertexDataSize += meshVertices[i].Data.size();
+		indexCount += meshIndices[i].size();
+
+		const aiMesh& mesh = *_scene.mMeshes[_instances[i].MeshIndex];
+		if (IsStrip(mesh, _conf))
+		{
+			stripVertexCount += _conf.Indexed ? meshIndices[i].size() : (meshVertices[i].Data.size() / vertexSize);
+			stripTriangleCount += _instances[i].Triangles ? (_instances[i].Triangles->size() / 3) : mesh.mNumFaces;
+		}
+	}
+
+	if (stripTriangleCount > 0)
+	{
+		_log
+			<< "Triangle strips: " << stripVertexCount << " vertices for " << stripTriangleCount
+			<< " triangles (" << ((double)stripVertexCount / (double)stripTriangleCount)
+			<< " per triangle)" << std::endl;
+	}
+
+	vertices.Reserve(vertexDataSize);
+	indices.reserve(indexCount);
+	for (uint32_t i : meshOrder)
+	{
+		const aiMesh& mesh = *_scene.mMeshes[_instances[i].MeshIndex];
+		uint32_t baseVertex = (uint32_t)(vertices.Data.size() / vertexSize);
+
+		// Meshes written only once are each a separate range
+		if (ranges.empty()
+			|| _conf.WritesMeshesOnce()
+			|| ranges.back().Lod != _instances[i].Lod
+			|| ranges.back().Cell != _instances[i].Cell
+			|| ranges.back().MaterialIndex != mesh.mMaterialIndex
+			|| ranges.back().PrimitiveType != mesh.mPrimitiveTypes)
+		{
+			SMeshRange range;
+			range.Lod = _instances[i].Lod;
+			range.Cell = _instances[i].Cell;
+			range.MaterialIndex = mesh.mMaterialIndex;
+			range.PrimitiveType = mesh.mPrimitiveTypes;
+			range.VertexOffset = baseVertex;
+			range.IndexOffset = (uint32_t)indices.size();
+			ranges.push_back(range);
+		}
+		meshRanges[_instances[i].MeshIndex] = (uint32_t)ranges.size() - 1;
+		instanceRanges[i] = (uint32_t)ranges.size() - 1;
+		instanceStarts[i] = _conf.Indexed ? (uint32_t)indices.size() : baseVertex;
+
+		for (uint32_t index : meshIndices[i])
+		{
+			indices.push_back(baseVertex + index);
+		}
+		vertices.Write(meshVertices[i].Data.data(), meshVertices[i].Data.size());
+		meshVertices[i].Data = std::vector<char>();
+
+		if (!_morph.Addresses.empty() && !_morph.Addresses[i].empty())
+		{
+			// Addresses of morph target deltas are the last attribute
+			const std::vector<uint32_t>& addresses = _morph.Addresses[i];
+			char* out = vertices.Data.data() + (size_t)baseVertex * vertexSize + vertexSize - sizeof(uint32_t);
+			for (size_t k = 0; k < addresses.size(); ++k)
 			{
-				if (hasTextureCoords)
-				{
-					aiVector3D uv = aiVector3D(_mesh.mTextureCoords[0][i]);
-					if (_conf.FlipUVs)
-					{
-						uv.y = 1.0f - uv.y;
-					}
-					WriteSingle<float>(_file, uv.x);
-					WriteSingle<float>(_file, uv.y);
-					// std::cout << uv.x << ", " << uv.y << ", ";
-				}
-				else
-				{
-					WriteSingle<float>(_file, 0.0f);
-					WriteSingle<float>(_file, 0.0f);
-					// std::cout << 0.0f << ", " << 0.0f << ", ";
-				}
+				memcpy(out + k * vertexSize, &addresses[k], sizeof(uint32_t));
+			}
+		}
+
+		SMeshRange& range = ranges.back();
+		range.VertexCount = (uint32_t)(vertices.Data.size() / vertexSize) - range.VertexOffset;
+		range.IndexCount = (uint32_t)indices.size() - range.IndexOffset;
+	}
+
+	uint32_t vertexCount = (uint32_t)(vertices.Data.size() / vertexSize);
+
+	SContainer container;
+
+	SStagingBuffer& vertexChunk = container.AddChunk(EChunk::Vertices);
+	vertexChunk.Reserve(3 * sizeof(uint32_t) + vertices.Data.size());
+	WriteSingle<uint32_t>(vertexChunk, PRIMITIVE_TYPE_GM(_primitiveType, _conf.Strip));
+	WriteSingle<uint32_t>(vertexChunk, vertexSize);
+	WriteSingle<uint32_t>(vertexChunk, vertexCount);
+	vertexChunk.Write(vertices.Data.data(), vertices.Data.size());
+
+	if (_conf.Indexed)
+	{
+		uint32_t indexSize = (vertexCount <= 0xFFFF) ? 2 : 4;
+
+		_log
+			<< "Indexed: " << vertexCount << " unique vertices, "
+			<< indices.size() << " indices (" << (indexSize * 8) << "-bit)" << std::endl;
+
+		SStagingBuffer& indexChunk = container.AddChunk(EChunk::Indices);
+		indexChunk.Reserve(2 * sizeof(uint32_t) + indices.size() * indexSize);
+		WriteSingle<uint32_t>(indexChunk, indexSize);
+		WriteSingle<uint32_t>(indexChunk, indices.size());
+		if (indexSize == 2)
+		{
+			WriteArray<uint16_t>(indexChunk, indices.data(), indices.size());
+		}
+		else
+		{
+			WriteArray<uint32_t>(indexChunk, indices.data(), indices.size());
+		}
+	}
+
+	if (_conf.WritePositions && _conf.PositionEncoding == EPositionEncoding::Quantized)
+	{
+		const aiAABB& bounds = _conf.PositionBounds;
+		SStagingBuffer& boundsChunk = container.AddChunk(EChunk::PositionBounds);
+		WriteSingle<float>(boundsChunk, bounds.mMin.x);
+		WriteSingle<float>(boundsChunk, bounds.mMin.y);
+		WriteSingle<float>(boundsChunk, bounds.mMin.z);
+		WriteSingle<float>(boundsChunk, bounds.mMax.x);
+		WriteSingle<float>(boundsChunk, bounds.mMax.y);
+		WriteSingle<float>(boundsChunk, bounds.mMax.z);
+	}
+
+	if (writeSubMeshes)
+	{
+		_log << "Sub-meshes: " << ranges.size() << std::endl;
+
+		SStagingBuffer& meshChunk = container.AddChunk(EChunk::SubMeshes);
+		WriteSingle<uint32_t>(meshChunk, ranges.size());
+		for (const SMeshRange& range : ranges)
+		{
+			aiString materialName = (range.MaterialIndex < _scene.mNumMaterials)
+				? _scene.mMaterials[range.MaterialIndex]->GetName()
+				: aiString();
+
+			_log
+				<< "  " << materialName.C_Str() << " (material " << range.MaterialIndex << "): "
+				<< PRIMITIVE_TYPE_NAME(range.PrimitiveType, _conf.Strip) << ", "
+				<< range.VertexCount << " vertices";
+			if (_conf.Indexed)
+			{
+				_log << ", " << range.IndexCount << " indices";
 			}
+			_log << std::endl;
+
+			WriteSingle<uint32_t>(meshChunk, range.MaterialIndex);
+			WriteSingle<uint32_t>(meshChunk, PRIMITIVE_TYPE_GM(range.PrimitiveType, _conf.Strip));
+			WriteSingle<uint32_t>(meshChunk, range.VertexOffset);
+			WriteSingle<uint32_t>(meshChunk, range.VertexCount);
+			WriteSingle<uint32_t>(meshChunk, range.IndexOffset);
+			WriteSingle<uint32_t>(meshChunk, range.IndexCount);
+			WriteString(meshChunk, materialName.C_Str());
+		}
+	}
+
+	if (!_lodErrors.empty())
+	{
+		_log << "Levels of detail: " << _lodErrors.size() << std::endl;
 
-			// Texture coords 2
-			if (_conf.WriteTextureCoords2)
+		std::vector<uint64_t> triangleCounts(_lodErrors.size(), 0);
+		for (const SMeshInstance& instance : _instances)
+		{
+			const aiMesh& mesh = *_scene.mMeshes[instance.MeshIndex];
+			if (mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
 			{
-				if (hasTextureCoords2)
-				{
-					aiVector3D uv = aiVector3D(_mesh.mTextureCoords[1][i]);
-					if (_conf.FlipUVs)
-					{
-						uv.y = 1.0f - uv.y;
-					}
-					WriteSingle<float>(_file, uv.x);
-					WriteSingle<float>(_file, uv.y);
-					// std::cout << uv.x << ", " << uv.y << ", ";
-				}
-				else
-				{
-					WriteSingle<float>(_file, 0.0f);
-					WriteSingle<float>(_file, 0.0f);
-					// std::cout << 0.0f << ", " << 0.0f << ", ";
-				}
+				triangleCounts[instance.Lod] += instance.Triangles ? (instance.Triangles->size() / 3) : mesh.mNumFaces;
 			}
+		}
 
-			// Colors
-			if (_conf.WriteColors)
+		SStagingBuffer& lodChunk = container.AddChunk(EChunk::Lods);
+		WriteSingle<uint32_t>(lodChunk, _lodErrors.size());
+		uint32_t firstRange = 0;
+		for (uint32_t l = 0; l < (uint32_t)_lodErrors.size(); ++l)
+		{
+			uint32_t rangeCount = 0;
+			while (firstRange + rangeCount < ranges.size() && ranges[firstRange + rangeCount].Lod == l)
 			{
-				if (hasVertexColors)
-				{
-					const aiColor4D& color = _mesh.mColors[0][i];
-					uint32_t colorEncoded = 0
-						| ((uint32_t)(color.a * 255.0f) << 24)
-						| ((uint32_t)(color.b * 255.0f) << 16)
-						| ((uint32_t)(color.g * 255.0f) << 8)
-						| ((uint32_t)(color.r * 255.0f) << 0);
-					WriteSingle<uint32_t>(_file, colorEncoded);
-					// std::cout << colorEncoded << ", ";
-				}
-				else
-				{
-					WriteSingle<uint32_t>(_file, 0xFFFFFFFF);
-					// std::cout << 0xFFFFFFFF << ", ";
-				}
+				++rangeCount;
+			}
+
+			_log
+				<< "  LOD " << l << ": " << triangleCounts[l] << " triangles, error "
+				<< _lodErrors[l] << ", sub-meshes " << firstRange << " to "
+				<< (firstRange + rangeCount - 1) << std::endl;
+
+			WriteSingle<float>(lodChunk, _lodErrors[l]);
+			WriteSingle<uint32_t>(lodChunk, firstRange);
+			WriteSingle<uint32_t>(lodChunk, rangeCount);
+			firstRange += rangeCount;
+		}
+	}
+
+	if (!_cells.empty())
+	{
+		uint64_t maxTriangleCount = 0;
+		uint64_t triangleCount = 0;
+		for (const SGridCell& cell : _cells)
+		{
+			maxTriangleCount = std::max(maxTriangleCount, cell.TriangleCount);
+			triangleCount += cell.TriangleCount;
+		}
+		_log
+			<< "Grid cells: " << _cells.size() << ", " << (triangleCount / _cells.size())
+			<< " triangles on average, at most " << maxTriangleCount << std::endl;
+
+		SStagingBuffer& cellChunk = container.AddChunk(EChunk::Cells);
+		WriteSingle<uint32_t>(cellChunk, _cells.size());
+		uint32_t firstRange = 0;
+		for (uint32_t c = 0; c < (uint32_t)_cells.size(); ++c)
+		{
+			uint32_t rangeCount = 0;
+			while (firstRange + rangeCount < ranges.size() && ranges[firstRange + rangeCount].Cell == c)
+			{
+				++rangeCount;
 			}
-			else if (_conf.WriteMaterialColors)
+
+			const SGridCell& cell = _cells[c];
+			uint32_t firstVertex = (rangeCount > 0) ? ranges[firstRange].VertexOffset : 0;
+			uint32_t cellVertexCount = 0;
+			for (uint32_t r = firstRange; r < firstRange + rangeCount; ++r)
 			{
-				uint32_t colorEncoded = 0
-					| ((uint32_t)(materialOpacity * 255.0f) << 24)
-					| ((uint32_t)(materialColor.b * 255.0f) << 16)
-					| ((uint32_t)(materialColor.g * 255.0f) << 8)
-					| ((uint32_t)(materialColor.r * 255.0f) << 0);
-				WriteSingle<uint32_t>(_file, colorEncoded);
-				// std::cout << colorEncoded << ", ";
+				cellVertexCount += ranges[r].VertexCount;
 			}
 
-			// Tangent vector and bitangent sign
-			if (_conf.WriteTangents)
+			WriteSingle<float>(cellChunk, cell.Origin.x);
+			WriteSingle<float>(cellChunk, cell.Origin.y);
+			WriteSingle<float>(cellChunk, cell.Origin.z);
+			WriteSingle<float>(cellChunk, cell.Box.mMin.x);
+			WriteSingle<float>(cellChunk, cell.Box.mMin.y);
+			WriteSingle<float>(cellChunk, cell.Box.mMin.z);
+			WriteSingle<float>(cellChunk, cell.Box.mMax.x);
+			WriteSingle<float>(cellChunk, cell.Box.mMax.y);
+			WriteSingle<float>(cellChunk, cell.Box.mMax.z);
+			WriteSingle<uint32_t>(cellChunk, firstVertex);
+			WriteSingle<uint32_t>(cellChunk, cellVertexCount);
+			WriteSingle<uint32_t>(cellChunk, firstRange);
+			WriteSingle<uint32_t>(cellChunk, rangeCount);
+			firstRange += rangeCount;
+		}
+	}
+
+	if (!_clusters.empty())
+	{
+		uint64_t clusterCount = 0;
+		uint64_t coneCount = 0;
+		for (const std::vector<SCluster>& clusters : _clusters)
+		{
+			clusterCount += clusters.size();
+			for (const SCluster& cluster : clusters)
 			{
-				if (hasTangentsAndBitangents)
-				{
-					aiVector3D tangent = Vec3ConvertUp(_mesh.mTangents[i], _conf.UpVector);
-					WriteSingle<float>(_file, tangent.x);
-					WriteSingle<float>(_file, tangent.y);
-					WriteSingle<float>(_file, tangent.z);
-					// std::cout << tangent.x << ", " << tangent.y << ", " << tangent.z << ", ";
-
-					aiVector3D bitangent = Vec3ConvertUp(_mesh.mBitangents[i], _conf.UpVector);
-					float bitangentSign = GetBitangentSign(normal, tangent, bitangent);
-					WriteSingle<float>(_file, bitangentSign);
-					// std::cout << bitangentSign << ", ";
-				}
-				else
-				{
-					// Can ignore Vec3ToZUp here since both Y and Z are 0
-					WriteSingle<float>(_file, 1.0f);
-					WriteSingle<float>(_file, 0.0f);
-					WriteSingle<float>(_file, 0.0f);
-					WriteSingle<float>(_file, 1.0f);
-					// std::cout << 1.0f << ", " << 0.0f << ", " << 0.0f << ", " << 1.0f << ", ";
-				}
+				coneCount += (cluster.ConeCutoff < 1.0f) ? 1 : 0;
 			}
+		}
+		_log
+			<< "Clusters: " << clusterCount << " of at most " << _conf.ClusterTriangles
+			<< " triangles, " << coneCount << " with normal cones" << std::endl;
 
-			// std::cout << std::endl;
+		SStagingBuffer& clusterChunk = container.AddChunk(EChunk::Clusters);
+		clusterChunk.Reserve(sizeof(uint32_t) + clusterCount * (3 * sizeof(uint32_t) + 8 * sizeof(float)));
+		WriteSingle<uint32_t>(clusterChunk, clusterCount);
+		for (uint32_t i : meshOrder)
+		{
+			// Clusters of an instance are written one after another, relative
+			// to the sub-mesh's vertex buffer loaded by yamc.gml
+			const SMeshRange& range = ranges[instanceRanges[i]];
+			uint32_t start = instanceStarts[i];
+			if (writeSubMeshes)
+			{
+				start -= _conf.Indexed ? range.IndexOffset : range.VertexOffset;
+			}
+			for (const SCluster& cluster : _clusters[i])
+			{
+				uint32_t count = cluster.TriangleCount * 3;
+				WriteSingle<uint32_t>(clusterChunk, writeSubMeshes ? instanceRanges[i] : 0);
+				WriteSingle<uint32_t>(clusterChunk, start);
+				WriteSingle<uint32_t>(clusterChunk, count);
+				WriteSingle<float>(clusterChunk, cluster.Center.x);
+				WriteSingle<float>(clusterChunk, cluster.Center.y);
+				WriteSingle<float>(clusterChunk, cluster.Center.z);
+				WriteSingle<float>(clusterChunk, cluster.Radius);
+				WriteSingle<float>(clusterChunk, cluster.ConeAxis.x);
+				WriteSingle<float>(clusterChunk, cluster.ConeAxis.y);
+				WriteSingle<float>(clusterChunk, cluster.ConeAxis.z);
+				WriteSingle<float>(clusterChunk, cluster.ConeCutoff);
+				start += count;
+			}
 		}
 	}
+
+	if (_conf.Morph)
+	{
+		_log
+			<< "Morph targets: " << _morph.Targets.size() << ", " << _morph.GetDeltaCount() << " deltas ("
+			<< _morph.Deltas.size() << " bytes), at most " << _morph.MaxVertexDeltas << " per vertex" << std::endl;
+
+		SStagingBuffer& morphChunk = container.AddChunk(EChunk::MorphTargets);
+		morphChunk.Reserve(4 * sizeof(uint32_t) + _morph.Deltas.size());
+		WriteSingle<uint32_t>(morphChunk, _morph.Targets.size());
+		for (const SMorphTarget& target : _morph.Targets)
+		{
+			WriteSingle<float>(morphChunk, target.Weight);
+			WriteString(morphChunk, target.Name.c_str());
+		}
+		WriteSingle<float>(morphChunk, _morph.PositionScale);
+		WriteSingle<uint32_t>(morphChunk, _morph.GetDeltaCount());
+		WriteSingle<uint32_t>(morphChunk, _morph.MaxVertexDeltas);
+		morphChunk.Write(_morph.Deltas.data(), _morph.Deltas.size());
+	}
+
+	if (_conf.Instanced)
+	{
+		_log << "Instances: " << _sceneInstances.size() << std::endl;
+
+		SStagingBuffer& instanceChunk = container.AddChunk(EChunk::Instances);
+		instanceChunk.Reserve(sizeof(uint32_t) + _sceneInstances.size() * (sizeof(uint32_t) + 16 * sizeof(float)));
+		WriteSingle<uint32_t>(instanceChunk, _sceneInstances.size());
+		for (const SMeshInstance& instance : _sceneInstances)
+		{
+			// Assimp's matrices are row-major, GameMaker's column-major
+			aiMatrix4x4 transform = Mat4ConvertUp(instance.Transform, _conf.UpVector);
+			transform.Transpose();
+			WriteSingle<uint32_t>(instanceChunk, meshRanges[instance.MeshIndex]);
+			WriteArray<float>(instanceChunk, transform[0], 16);
+		}
+	}
+
+	if (_conf.Nodes)
+	{
+		WriteNodes(container, _scene, _instances, meshRanges, _conf, _log);
+	}
+
+	if (_conf.Bounds)
+	{
+		// Bounds of the whole model include all instances of meshes written
+		// only once, with their transforms
+		const std::vector<SMeshInstance>& modelInstances = _conf.WritesMeshesOnce() ? _sceneInstances : _instances;
+		SBounds modelBounds = ComputeGroupBounds(
+			_scene, modelInstances, std::vector<uint32_t>(modelInstances.size(), 0), 1, _conf)[0];
+
+		std::vector<SBounds> rangeBounds = writeSubMeshes
+			? ComputeGroupBounds(_scene, _instances, instanceRanges, (uint32_t)ranges.size(), _conf)
+			: std::vector<SBounds>{ modelBounds };
+
+		_log
+			<< "Bounds: " << modelBounds.Box.mMin.x << ", " << modelBounds.Box.mMin.y << ", " << modelBounds.Box.mMin.z
+			<< " to " << modelBounds.Box.mMax.x << ", " << modelBounds.Box.mMax.y << ", " << modelBounds.Box.mMax.z
+			<< ", radius " << modelBounds.Radius << std::endl;
+
+		SStagingBuffer& boundsChunk = container.AddChunk(EChunk::Bounds);
+		WriteBoundingVolume(boundsChunk, modelBounds);
+		WriteSingle<uint32_t>(boundsChunk, rangeBounds.size());
+		for (const SBounds& bounds : rangeBounds)
+		{
+			WriteBoundingVolume(boundsChunk, bounds);
+		}
+	}
+
+	SProfiler::Clock::duration encodeTime = encodeScope.End();
+	if (_profiler)
+	{
+		LogEncodeThroughput(_log, encodedCount, encodeTime);
+	}
+
+	SProfiler::SScope writeScope(_profiler, "Write");
+	container.Write(_file);
 }
 
-bool WriteScene(std::ofstream& _file, const aiScene& _scene, const SConfig& _conf)
+bool WriteScene(
+	std::ostream& _file,
+	const aiScene& _scene,
+	const SConfig& _conf,
+	std::ostream& _log,
+	SProfiler* _profiler)
 {
-	std::cout << "Vertex format: position 3D, ";
-	if (_conf.WriteNormals) std::cout << "normal, ";
-	if (_conf.WriteTextureCoords) std::cout << "texcoord, ";
-	if (_conf.WriteColors || _conf.WriteMaterialColors) std::cout << "color, ";
-	if (_conf.WriteTangents) std::cout << "tangent and bitangent sign (float4), ";
-	std::cout << std::endl;
+	_log << "Vertex format: position 3D, ";
+	if (_conf.WriteNormals) _log << "normal, ";
+	if (_conf.WriteTextureCoords) _log << "texcoord, ";
+	if (_conf.WriteColors || _conf.WriteMaterialColors) _log << "color, ";
+	if (_conf.WriteTangents) _log << "tangent and bitangent sign "
+		<< ((_conf.VectorEncoding == EVectorEncoding::Float) ? "(float4), " : "(packed), ");
+	if (_conf.Morph) _log << "morph target deltas, ";
+	_log << std::endl;
+
+	std::vector<SMeshInstance> instances = GetMeshInstances(_scene, _conf);
+	if (instances.empty())
+	{
+		_log << "ERROR: No node of the model references a mesh!" << std::endl;
+		return false;
+	}
+
+	if (_conf.WalksNodes())
+	{
+		_log << "Mesh instances: " << instances.size() << " of " << _scene.mNumMeshes << " meshes" << std::endl;
+	}
+
+	// Tables of instances and nodes reference meshes written only once and
+	// without transform
+	std::vector<SMeshInstance> sceneInstances;
+	if (_conf.WritesMeshesOnce())
+	{
+		sceneInstances = std::move(instances);
+		instances = GetUniqueMeshes(_scene, sceneInstances);
+	}
+
+	// Levels of detail are written after the original instances, with errors
+	// scaled into model space by their transforms
+	std::vector<SMeshLods> lods;
+	std::vector<float> lodErrors;
+	if (_conf.GetLodCount() > 0)
+	{
+		SProfiler::SScope scope(_profiler, "Simplify");
+		lods = GenerateLods(_scene, _conf);
+		lodErrors.resize(_conf.GetLodCount() + 1, 0.0f);
+
+		size_t originalCount = instances.size();
+		for (uint32_t l = 0; l < _conf.GetLodCount(); ++l)
+		{
+			for (size_t i = 0; i < originalCount; ++i)
+			{
+				SMeshInstance instance = instances[i];
+				const SMeshLods& meshLods = lods[instance.MeshIndex];
+				instance.Lod = l + 1;
+				instance.Triangles = meshLods.Triangles.empty() ? nullptr : &meshLods.Triangles[l];
+				instances.push_back(instance);
+
+				float scale = instance.Transformed ? Mat4GetMaxScale(instance.Transform) : 1.0f;
+				lodErrors[l + 1] = std::max(lodErrors[l + 1], meshLods.Errors[l] * scale);
+			}
+		}
+	}
+
+	// Cells are written in order, each with instances of meshes that have
+	// primitives in it
+	SSpatialGrid grid;
+	if (_conf.Grid != EGrid::None)
+	{
+		SProfiler::SScope scope(_profiler, "Grid");
+		grid = BuildSpatialGrid(_scene, instances, _conf);
+		instances = grid.Instances;
+	}
+
+	// Clusters of each instance are contiguous
+	SClusteredInstances clusters;
+	if (_conf.ClusterTriangles > 0)
+	{
+		SProfiler::SScope scope(_profiler, "Cluster");
+		clusters = BuildClusters(_scene, instances, _conf);
+		instances = clusters.Instances;
+	}
 
-	uint32_t primitiveType = _scene.mMeshes[0]->mPrimitiveTypes;
-	for (uint32_t i = 0; i < _scene.mNumMeshes; ++i)
+	// Deltas are addressed by written vertices, so they are built for the
+	// final instances
+	SMorphTargets morph;
+	if (_conf.Morph)
 	{
-		if (_scene.mMeshes[i]->mPrimitiveTypes != primitiveType)
+		SProfiler::SScope scope(_profiler, "Morph");
+		if (!BuildMorphTargets(_scene, instances, _conf, morph, _log))
 		{
-			std::cout << "ERROR: Model must not consist of multiple primitive types!" << std::endl;
 			return false;
 		}
 	}
 
-	std::cout
-		<< "Primitive type: " << PRIMITIVE_TYPE_NAME(primitiveType) << std::endl
+	uint32_t primitiveType = _scene.mMeshes[instances[0].MeshIndex]->mPrimitiveTypes;
+	for (const SMeshInstance& instance : instances)
+	{
+		if (_scene.mMeshes[instance.MeshIndex]->mPrimitiveTypes != primitiveType)
+		{
+			if (!_conf.SubMeshes && !_conf.WritesMeshesOnce())
+			{
+				_log << "ERROR: Model must not consist of multiple primitive types!" << std::endl;
+				return false;
+			}
+			// Each sub-mesh has its own primitive type
+			primitiveType = 0;
+			break;
+		}
+	}
+
+	_log
+		<< "Primitive type: " << ((primitiveType != 0) ? PRIMITIVE_TYPE_NAME(primitiveType, _conf.Strip) : "mixed") << std::endl
 		<< "Up axis: " << ((_conf.UpVector == EAxis::NegativeY) ? "-Y" : "Z") << std::endl
 		<< "Invert vertex winding: " << (_conf.InvertWinding ? "Yes" : "No") << std::endl
 		<< "Flip UV vertically: " << (_conf.FlipUVs ? "Yes" : "No") << std::endl
-		<< "Bake materials to vertex colors: " << (_conf.WriteMaterialColors ? "Yes" : "No") << std::endl;
+		<< "Bake materials to vertex colors: " << (_conf.WriteMaterialColors ? "Yes" : "No") << std::endl
+		<< "Encoding: position " << GetEncodingName(_conf.PositionEncoding)
+		<< ", normal " << GetEncodingName(_conf.VectorEncoding)
+		<< ", texcoord " << GetEncodingName(_conf.TexCoordEncoding) << std::endl;
 
-	uint32_t materialIndex = _scene.mMeshes[0]->mMaterialIndex;
+	uint32_t materialIndex = _scene.mMeshes[instances[0].MeshIndex]->mMaterialIndex;
 	bool mixedMaterials = false;
-	for (uint32_t i = 0; i < _scene.mNumMeshes; ++i)
+	for (const SMeshInstance& instance : instances)
 	{
-		const aiMesh& mesh = *_scene.mMeshes[i];
-		if (mesh.mMaterialIndex != materialIndex)
+		if (_scene.mMeshes[instance.MeshIndex]->mMaterialIndex != materialIndex)
 		{
 			mixedMaterials = true;
 		}
-		WriteMesh(_file, _scene, mesh, _conf);
 	}
 
-	if (mixedMaterials && !_conf.WriteMaterialColors)
+	if (_conf.IsContainer())
+	{
+		SConfig conf = _conf;
+		if (conf.WritePositions && conf.PositionEncoding == EPositionEncoding::Quantized)
+		{
+			SProfiler::SScope scope(_profiler, "Position bounds");
+			conf.PositionBounds = ComputePositionBounds(_scene, instances, conf);
+		}
+		WriteSceneContainer(_file, _scene, instances, sceneInstances, lodErrors, grid.Cells, clusters.Clusters, morph, primitiveType, conf, _log, _profiler);
+	}
+	else
+	{
+		// Mesh instances are encoded in parallel, each into its own buffer, and
+		// then written in their original order
+		SProfiler::SScope encodeScope(_profiler, "Encode");
+		std::vector<SStagingBuffer> buffers = WriteMeshes(_scene, instances, _conf);
+		SProfiler::Clock::duration encodeTime = encodeScope.End();
+
+		if (_profiler)
+		{
+			uint64_t encodedCount = 0;
+			for (const SStagingBuffer& buffer : buffers)
+			{
+				encodedCount += buffer.Data.size() / _conf.GetVertexSize();
+			}
+			LogEncodeThroughput(_log, encodedCount, encodeTime);
+		}
+
+		SProfiler::SScope writeScope(_profiler, "Write");
+		for (SStagingBuffer& buffer : buffers)
+		{
+			buffer.Flush(_file);
+		}
+	}
+
+	if (mixedMaterials && !_conf.WriteMaterialColors && !_conf.SubMeshes && !_conf.WritesMeshesOnce())
 	{
-		std::cout << MESSAGE_MULTIPLE_MATERIALS << std::endl;
+		_log << MESSAGE_MULTIPLE_MATERIALS << std::endl;
 	}
 
 	return true;
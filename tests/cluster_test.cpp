@@ -0,0 +1,142 @@
+// Tests cones of normals of clusters on a closed mesh: clusters of a cube
+// must face away from its center, so that the backfacing test used by
+// yamc_model_cull_clusters skips only clusters on the far side of the cube.
+
+#include <cluster.hpp>
+#include <math.hpp>
+
+#include <cstdio>
+
+static int g_failures = 0;
+
+static void Check(bool _condition, const char* _message)
+{
+	if (!_condition)
+	{
+		printf("FAILED: %s\n", _message);
+		++g_failures;
+	}
+}
+
+/// Returns a unit cube centered at the origin, with 4 vertices and 2
+/// triangles for each side. Triangles are counter-clockwise when viewed from
+/// outside, as Assimp loads them, and then reversed, as
+/// aiProcess_FlipWindingOrder does before yamc sees them.
+static aiMesh* CreateCube()
+{
+	static const float normals[6][3] = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+	};
+
+	aiMesh* mesh = new aiMesh();
+	mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+	mesh->mNumVertices = 24;
+	mesh->mVertices = new aiVector3D[24];
+	mesh->mNumFaces = 12;
+	mesh->mFaces = new aiFace[12];
+
+	for (uint32_t s = 0; s < 6; ++s)
+	{
+		aiVector3D n(normals[s][0], normals[s][1], normals[s][2]);
+		// Two axes of the side such that cross(u, v) == n
+		aiVector3D u(n.y, n.z, n.x);
+		aiVector3D v = Vec3Cross(n, u);
+		aiVector3D corners[4] = { n - u - v, n + u - v, n + u + v, n - u + v };
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			mesh->mVertices[s * 4 + c] = corners[c] * 0.5f;
+		}
+
+		static const uint32_t triangles[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+		for (uint32_t t = 0; t < 2; ++t)
+		{
+			aiFace& face = mesh->mFaces[s * 2 + t];
+			face.mNumIndices = 3;
+			face.mIndices = new unsigned int[3];
+			// Reversed winding order
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				face.mIndices[k] = s * 4 + triangles[t][2 - k];
+			}
+		}
+	}
+	return mesh;
+}
+
+/// Reverses faces of a mesh, so that with SConfig::InvertWinding they end up
+/// counter-clockwise again.
+static void ReverseFaces(aiMesh& _mesh)
+{
+	for (uint32_t f = 0; f < _mesh.mNumFaces; ++f)
+	{
+		std::swap(_mesh.mFaces[f].mIndices[0], _mesh.mFaces[f].mIndices[2]);
+	}
+}
+
+/// Same as the backfacing test of yamc_model_cull_clusters.
+static bool IsBackfacing(const SCluster& _cluster, const aiVector3D& _camera)
+{
+	aiVector3D direction = _cluster.Center - _camera;
+	return Vec3Dot(direction, _cluster.ConeAxis) >= _cluster.ConeCutoff * direction.Length() + _cluster.Radius;
+}
+
+static void TestCube(const aiScene& _scene, const SConfig& _conf, const char* _name)
+{
+	std::vector<SMeshInstance> instances(1);
+	SClusteredInstances clustered = BuildClusters(_scene, instances, _conf);
+	const std::vector<SCluster>& clusters = clustered.Clusters[0];
+
+	printf("%s: %u clusters\n", _name, (uint32_t)clusters.size());
+	Check(clusters.size() == 6, "each side of the cube is a cluster");
+
+	// The camera is outside of the cube, in front of its +X side in the space
+	// of written positions
+	aiVector3D camera = Vec3ConvertUp(aiVector3D(5.0f, 0.0f, 0.0f), _conf.UpVector);
+	aiVector3D front = Vec3ConvertUp(aiVector3D(1.0f, 0.0f, 0.0f), _conf.UpVector);
+	for (const SCluster& cluster : clusters)
+	{
+		Check(Vec3Dot(cluster.ConeAxis, cluster.Center) > 0.0f, "cone of normals points away from the center");
+
+		float side = Vec3Dot(cluster.Center, front);
+		if (side > 0.25f)
+		{
+			Check(!IsBackfacing(cluster, camera), "side facing the camera is not backfacing");
+		}
+		else if (side < -0.25f)
+		{
+			Check(IsBackfacing(cluster, camera), "side facing away from the camera is backfacing");
+		}
+	}
+}
+
+int main()
+{
+	aiScene scene;
+	scene.mNumMeshes = 1;
+	scene.mMeshes = new aiMesh*[1];
+	scene.mMeshes[0] = CreateCube();
+
+	SConfig conf;
+	conf.Default();
+	conf.ClusterTriangles = 2;
+
+	TestCube(scene, conf, "Y-up");
+
+	conf.UpVector = EAxis::PositiveZ;
+	TestCube(scene, conf, "Z-up");
+
+	// With -i, faces come out of aiProcess_FlipWindingOrder in their original
+	// order, which is clockwise when viewed from outside
+	conf.UpVector = EAxis::NegativeY;
+	conf.InvertWinding = true;
+	ReverseFaces(*scene.mMeshes[0]);
+	TestCube(scene, conf, "Inverted winding");
+
+	if (g_failures > 0)
+	{
+		printf("%d checks failed\n", g_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
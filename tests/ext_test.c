@@ -0,0 +1,236 @@
+// Tests the native GameMaker extension through its C interface, the same way
+// GameMaker calls it: loads a file on worker threads, polls its status,
+// completes it into a caller's buffer and checks that the result matches what
+// was written. Covers raw, compressed and filtered files and containers with
+// indices, which are expanded into vertices. Also checks that loading a
+// missing file fails.
+//
+// Usage: yamc_ext_test PATH
+// PATH is a scratch file that the test writes and deletes.
+
+#include <extension.hpp>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_FILE_SIZE 4096
+
+/// Vertex size of test data, which does not divide TEST_FILE_SIZE, so that
+/// filters have to handle trailing bytes.
+#define TEST_STRIDE 12
+
+#define TEST_FOURCC(_a, _b, _c, _d) \
+	(((uint32_t)(_a) << 0) \
+	| ((uint32_t)(_b) << 8) \
+	| ((uint32_t)(_c) << 16) \
+	| ((uint32_t)(_d) << 24))
+
+/// Values of ECompressionFilter.
+enum
+{
+	FILTER_NONE,
+	FILTER_SHUFFLE,
+	FILTER_DELTA,
+};
+
+/// Implemented in ext_test_files.cpp.
+int WriteTestFile(const char* _path, const char* _data, size_t _size, int _filter, uint32_t _stride, int _compress);
+
+static int g_failures = 0;
+
+static void Check(int _condition, const char* _message)
+{
+	if (!_condition)
+	{
+		printf("FAILED: %s\n", _message);
+		++g_failures;
+	}
+}
+
+/// Polls a job until it is no longer pending and returns its status.
+static double WaitForJob(double _job)
+{
+	double status;
+	while ((status = yamc_ext_status(_job)) == YAMC_EXT_PENDING)
+	{
+	}
+	return status;
+}
+
+/// Loads a file through the extension and checks that the result equals
+/// _expected.
+static void TestLoad(const char* _path, double _expand, const char* _expected, size_t _size)
+{
+	double job = yamc_ext_load(_path, _expand);
+	Check(job != 0, "yamc_ext_load returns a job");
+
+	Check(WaitForJob(job) == YAMC_EXT_READY, "job becomes ready");
+	size_t size = (size_t)yamc_ext_size(job);
+	Check(size == _size, "yamc_ext_size returns the size of the result");
+
+	char* buffer = (char*)malloc(size + 1);
+	Check(yamc_ext_complete(job, buffer) == 1, "yamc_ext_complete accepts a ready job");
+	Check(WaitForJob(job) == YAMC_EXT_DONE, "job is done");
+	Check(size == _size && memcmp(buffer, _expected, _size) == 0, "result matches the expected data");
+
+	Check(yamc_ext_free(job) == 1, "yamc_ext_free frees a done job");
+	Check(yamc_ext_status(job) == YAMC_EXT_FAILED, "freed job does not exist");
+	free(buffer);
+}
+
+/// Writes _data filtered with _filter and optionally compressed, then loads it
+/// through the extension, with or without expanding. Data that is not a
+/// container is returned as it was before filtering and compressing either
+/// way.
+static void TestFile(const char* _path, const char* _data, size_t _size, int _filter, int _compress)
+{
+	printf("Filter %d, compressed %d\n", _filter, _compress);
+	if (!WriteTestFile(_path, _data, _size, _filter, TEST_STRIDE, _compress))
+	{
+		Check(0, "test file is written");
+		return;
+	}
+	TestLoad(_path, 0, _data, _size);
+	TestLoad(_path, 1, _data, _size);
+}
+
+static void Put32(char** _out, uint32_t _value)
+{
+	memcpy(*_out, &_value, 4);
+	*_out += 4;
+}
+
+/// Writes a container with a VERT chunk and, if _indexSize is not 0, an INDX
+/// chunk into _out. Returns its size.
+static size_t BuildContainer(char* _out, const char* _vertices, uint32_t _vertexCount, const void* _indices, uint32_t _indexSize, uint32_t _indexCount)
+{
+	char* out = _out;
+	Put32(&out, TEST_FOURCC('Y', 'A', 'M', 'C'));
+	Put32(&out, 1);
+	Put32(&out, (_indexSize != 0) ? 2 : 1);
+
+	Put32(&out, TEST_FOURCC('V', 'E', 'R', 'T'));
+	Put32(&out, 12 + TEST_STRIDE * _vertexCount);
+	Put32(&out, 4); // pr_trianglelist
+	Put32(&out, TEST_STRIDE);
+	Put32(&out, _vertexCount);
+	memcpy(out, _vertices, TEST_STRIDE * _vertexCount);
+	out += TEST_STRIDE * _vertexCount;
+
+	if (_indexSize != 0)
+	{
+		Put32(&out, TEST_FOURCC('I', 'N', 'D', 'X'));
+		Put32(&out, 8 + _indexSize * _indexCount);
+		Put32(&out, _indexSize);
+		Put32(&out, _indexCount);
+		memcpy(out, _indices, _indexSize * _indexCount);
+		out += _indexSize * _indexCount;
+	}
+	return (size_t)(out - _out);
+}
+
+/// Writes a container filtered with _filter and compressed, like yamc does,
+/// and checks that it is returned as it is without expanding and as its
+/// (index-expanded) vertices with expanding.
+static void TestContainer(const char* _path, const char* _vertices, uint32_t _vertexCount, const void* _indices, uint32_t _indexSize, uint32_t _indexCount, int _filter)
+{
+	char container[1024];
+	char expanded[1024];
+	size_t containerSize = BuildContainer(container, _vertices, _vertexCount, _indices, _indexSize, _indexCount);
+	size_t expandedSize = 0;
+	uint32_t count = (_indexSize != 0) ? _indexCount : _vertexCount;
+	uint32_t i;
+
+	for (i = 0; i < count; ++i)
+	{
+		uint32_t index = i;
+		if (_indexSize == 2)
+		{
+			index = ((const uint16_t*)_indices)[i];
+		}
+		else if (_indexSize == 4)
+		{
+			index = ((const uint32_t*)_indices)[i];
+		}
+		memcpy(expanded + expandedSize, _vertices + index * TEST_STRIDE, TEST_STRIDE);
+		expandedSize += TEST_STRIDE;
+	}
+
+	printf("Container with %u-byte indices, filter %d\n", _indexSize, _filter);
+	if (!WriteTestFile(_path, container, containerSize, _filter, TEST_STRIDE, 1))
+	{
+		Check(0, "test file is written");
+		return;
+	}
+	TestLoad(_path, 0, container, containerSize);
+	TestLoad(_path, 1, expanded, expandedSize);
+}
+
+static void TestMissingFile(const char* _path)
+{
+	char buffer[16];
+	double job = yamc_ext_load(_path, 0);
+	Check(job != 0, "yamc_ext_load returns a job for a missing file");
+	Check(WaitForJob(job) == YAMC_EXT_FAILED, "loading a missing file fails");
+	Check(yamc_ext_size(job) == 0, "failed job has no size");
+	Check(yamc_ext_complete(job, buffer) == 0, "yamc_ext_complete rejects a failed job");
+	Check(yamc_ext_free(job) == 1, "yamc_ext_free frees a failed job");
+}
+
+int main(int _argc, char** _argv)
+{
+	if (_argc < 2)
+	{
+		printf("Usage: %s PATH\n", _argv[0]);
+		return 1;
+	}
+	const char* path = _argv[1];
+
+	char data[TEST_FILE_SIZE];
+	for (size_t i = 0; i < sizeof(data); ++i)
+	{
+		data[i] = (char)(i * 7 + i / 256);
+	}
+
+	// Two triangles of a quad
+	static const uint16_t indices16[6] = { 0, 1, 2, 0, 2, 3 };
+	static const uint32_t indices32[6] = { 0, 1, 2, 0, 2, 3 };
+
+	FILE* file = fopen(path, "wb");
+	if (!file || fwrite(data, 1, sizeof(data), file) != sizeof(data))
+	{
+		printf("Could not write %s\n", path);
+		return 1;
+	}
+	fclose(file);
+
+	Check(yamc_ext_init(2) == 2, "yamc_ext_init starts the threads");
+	// Any file that is neither compressed nor a YAMC container is returned as
+	// it is, with or without expanding
+	TestLoad(path, 0, data, sizeof(data));
+	TestLoad(path, 1, data, sizeof(data));
+
+	TestFile(path, data, sizeof(data), FILTER_NONE, 1);
+	TestFile(path, data, sizeof(data), FILTER_SHUFFLE, 0);
+	TestFile(path, data, sizeof(data), FILTER_SHUFFLE, 1);
+	TestFile(path, data, sizeof(data), FILTER_DELTA, 0);
+	TestFile(path, data, sizeof(data), FILTER_DELTA, 1);
+
+	TestContainer(path, data, 4, NULL, 0, 0, FILTER_NONE);
+	TestContainer(path, data, 4, indices16, 2, 6, FILTER_NONE);
+	TestContainer(path, data, 4, indices16, 2, 6, FILTER_SHUFFLE);
+	TestContainer(path, data, 4, indices32, 4, 6, FILTER_DELTA);
+	remove(path);
+	TestMissingFile(path);
+	Check(yamc_ext_shutdown() == 1, "yamc_ext_shutdown stops the threads");
+
+	if (g_failures > 0)
+	{
+		printf("%d checks failed\n", g_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,36 @@
+// Writes files for tests/ext_test.c with the same functions that yamc filters
+// and compresses its output with, so that the test does not have to
+// reimplement them in C.
+
+#include <compress.hpp>
+
+#include <fstream>
+
+/// Filters _size bytes of _data with _filter (a ECompressionFilter) and
+/// _stride, optionally compresses them with zlib and writes them into a file.
+/// Returns 1 on success or 0 on fail.
+extern "C" int WriteTestFile(const char* _path, const char* _data, size_t _size, int _filter, uint32_t _stride, int _compress)
+{
+	std::vector<char> filtered;
+	if ((ECompressionFilter)_filter != ECompressionFilter::None)
+	{
+		FilterBytes(_data, _size, (ECompressionFilter)_filter, _stride, filtered);
+		_data = filtered.data();
+		_size = filtered.size();
+	}
+
+	std::vector<char> compressed;
+	if (_compress)
+	{
+		if (!CompressZlib(_data, _size, 9, 1, compressed))
+		{
+			return 0;
+		}
+		_data = compressed.data();
+		_size = compressed.size();
+	}
+
+	std::ofstream file(_path, std::ios::out | std::ios::binary);
+	file.write(_data, _size);
+	return file.good() ? 1 : 0;
+}
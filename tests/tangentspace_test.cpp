@@ -0,0 +1,160 @@
+// Tests native generation of normals and tangents against known frames of a
+// quad facing +Z: normals must point out of the front face and bitangent signs
+// must be the same as Assimp's, which are -1 unless texture space is mirrored.
+
+#include <math.hpp>
+#include <tangentspace.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+static int g_failures = 0;
+
+static void Check(bool _condition, const char* _message)
+{
+	if (!_condition)
+	{
+		printf("FAILED: %s\n", _message);
+		++g_failures;
+	}
+}
+
+static bool IsNear(const aiVector3D& _a, const aiVector3D& _b)
+{
+	return (_a - _b).Length() < 1e-4f;
+}
+
+/// Returns a triangle mesh. _triangles are counter-clockwise when viewed from
+/// +Z, as Assimp loads them, and then reversed, as aiProcess_FlipWindingOrder
+/// does before yamc sees them.
+static aiMesh* CreateMesh(
+	const std::vector<aiVector3D>& _positions,
+	const std::vector<aiVector3D>& _texCoords,
+	const std::vector<uint32_t>& _triangles)
+{
+	aiMesh* mesh = new aiMesh();
+	mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+	mesh->mNumVertices = (uint32_t)_positions.size();
+	mesh->mVertices = new aiVector3D[_positions.size()];
+	mesh->mTextureCoords[0] = new aiVector3D[_positions.size()];
+	mesh->mNumUVComponents[0] = 2;
+	std::copy(_positions.begin(), _positions.end(), mesh->mVertices);
+	std::copy(_texCoords.begin(), _texCoords.end(), mesh->mTextureCoords[0]);
+
+	mesh->mNumFaces = (uint32_t)(_triangles.size() / 3);
+	mesh->mFaces = new aiFace[mesh->mNumFaces];
+	for (uint32_t f = 0; f < mesh->mNumFaces; ++f)
+	{
+		aiFace& face = mesh->mFaces[f];
+		face.mNumIndices = 3;
+		face.mIndices = new unsigned int[3];
+		// Reversed winding order
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			face.mIndices[k] = _triangles[f * 3 + 2 - k];
+		}
+	}
+	return mesh;
+}
+
+/// Returns a unit quad in the XY plane with U along X and V along Y, or along
+/// -X if _mirrored.
+static aiMesh* CreateQuad(bool _mirrored)
+{
+	std::vector<aiVector3D> positions;
+	std::vector<aiVector3D> texCoords;
+	for (uint32_t v = 0; v < 4; ++v)
+	{
+		float x = (v == 1 || v == 2) ? 1.0f : 0.0f;
+		float y = (v >= 2) ? 1.0f : 0.0f;
+		positions.emplace_back(x, y, 0.0f);
+		texCoords.emplace_back(_mirrored ? (1.0f - x) : x, y, 0.0f);
+	}
+	return CreateMesh(positions, texCoords, { 0, 1, 2, 0, 2, 3 });
+}
+
+static void TestNormals(bool _smooth, const char* _name)
+{
+	printf("%s normals\n", _name);
+	aiMesh* mesh = CreateQuad(false);
+	Check(GenerateNormals(*mesh, _smooth, SMOOTHING_ANGLE_FULL, 2), "normals are generated");
+	for (uint32_t v = 0; v < mesh->mNumVertices; ++v)
+	{
+		Check(IsNear(mesh->mNormals[v], aiVector3D(0.0f, 0.0f, 1.0f)), "normal points out of the front face");
+	}
+	delete mesh;
+}
+
+static void TestTangents(bool _mirrored, const char* _name)
+{
+	printf("%s tangents\n", _name);
+	aiMesh* mesh = CreateQuad(_mirrored);
+	Check(GenerateNormals(*mesh, false, 0.0f, 2), "normals are generated");
+	Check(GenerateTangents(*mesh, 2), "tangents are generated");
+
+	aiVector3D tangent(_mirrored ? -1.0f : 1.0f, 0.0f, 0.0f);
+	float sign = _mirrored ? 1.0f : -1.0f;
+	for (uint32_t v = 0; v < mesh->mNumVertices; ++v)
+	{
+		Check(IsNear(mesh->mTangents[v], tangent), "tangent points towards increasing U");
+		Check(IsNear(mesh->mBitangents[v], aiVector3D(0.0f, -1.0f, 0.0f)), "bitangent points towards decreasing V");
+		Check(GetBitangentSign(mesh->mNormals[v], mesh->mTangents[v], mesh->mBitangents[v]) == sign,
+			"bitangent sign is the same as Assimp's");
+	}
+	delete mesh;
+}
+
+/// Two quads next to each other that share two vertices, with U mirrored
+/// between them, so the shared vertices must be split.
+static void TestMirroredSeam()
+{
+	printf("Mirrored seam\n");
+	std::vector<aiVector3D> positions;
+	std::vector<aiVector3D> texCoords;
+	for (uint32_t v = 0; v < 6; ++v)
+	{
+		float x = (float)(v % 3);
+		float y = (float)(v / 3);
+		positions.emplace_back(x, y, 0.0f);
+		texCoords.emplace_back((x <= 1.0f) ? x : (2.0f - x), y, 0.0f);
+	}
+	std::vector<uint32_t> triangles = { 0, 1, 4, 0, 4, 3, 1, 2, 5, 1, 5, 4 };
+	aiMesh* mesh = CreateMesh(positions, texCoords, triangles);
+	Check(GenerateNormals(*mesh, true, SMOOTHING_ANGLE_FULL, 2), "normals are generated");
+	Check(GenerateTangents(*mesh, 2), "tangents are generated");
+	Check(mesh->mNumVertices == 8, "both vertices on the seam are split");
+
+	for (uint32_t f = 0; f < mesh->mNumFaces; ++f)
+	{
+		bool mirrored = (f >= 2);
+		aiVector3D tangent(mirrored ? -1.0f : 1.0f, 0.0f, 0.0f);
+		float sign = mirrored ? 1.0f : -1.0f;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t v = mesh->mFaces[f].mIndices[k];
+			Check(IsNear(mesh->mVertices[v], positions[triangles[f * 3 + 2 - k]]), "split vertex keeps its position");
+			Check(IsNear(mesh->mTangents[v], tangent), "corner gets the tangent of its face's orientation");
+			Check(GetBitangentSign(mesh->mNormals[v], mesh->mTangents[v], mesh->mBitangents[v]) == sign,
+				"corner gets the bitangent sign of its face's orientation");
+		}
+	}
+	delete mesh;
+}
+
+int main()
+{
+	TestNormals(false, "Flat");
+	TestNormals(true, "Smooth");
+	TestTangents(false, "Regular");
+	TestTangents(true, "Mirrored");
+	TestMirroredSeam();
+
+	if (g_failures > 0)
+	{
+		printf("%d checks failed\n", g_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -58,9 +58,259 @@ function __vertex_format_pnuct()
 	return _vformat;
 }
 
+/// @macro {Real} Attribute is not present in the vertex format.
+/// @see yamc_vertex_format_create
+#macro YAMC_ENCODING_NONE 0
+
+/// @macro {Real} Attribute is stored as 32-bit floats (default).
+/// @see yamc_vertex_format_create
+#macro YAMC_ENCODING_FLOAT 1
+
+/// @macro {Real} Position is stored as 16-bit integers relative to the model's
+/// bounding box (argument --position=quantized).
+/// @see yamc_vertex_format_create
+#macro YAMC_ENCODING_QUANTIZED 2
+
+/// @macro {Real} Normal and tangent vectors are stored as 8-bit signed
+/// normalized integers (argument --normal=snorm).
+/// @see yamc_vertex_format_create
+#macro YAMC_ENCODING_SNORM 3
+
+/// @macro {Real} Normal and tangent vectors are stored as two 16-bit integers
+/// using octahedral mapping (argument --normal=oct).
+/// @see yamc_vertex_format_create
+#macro YAMC_ENCODING_OCTAHEDRAL 4
+
+/// @macro {Real} Texture coordinates are stored as 16-bit half floats
+/// (argument --uv=half).
+/// @see yamc_vertex_format_create
+#macro YAMC_ENCODING_HALF 5
+
+/// @func yamc_vertex_format_create(_position, _normal, _texcoord, _texcoord2, _color, _tangent[, _morph])
+///
+/// @desc Creates a vertex format matching a model converted with given
+/// attribute encodings. Encoded attributes are added as custom `ubyte4`
+/// attributes and need to be decoded in a vertex shader, see ShBasic.vsh.
+///
+/// @param {Real} _position Encoding of positions, {@link YAMC_ENCODING_FLOAT}
+/// or {@link YAMC_ENCODING_QUANTIZED}. Quantized positions take two `ubyte4`
+/// attributes.
+/// @param {Real} _normal Encoding of normals, {@link YAMC_ENCODING_NONE},
+/// {@link YAMC_ENCODING_FLOAT}, {@link YAMC_ENCODING_SNORM} or
+/// {@link YAMC_ENCODING_OCTAHEDRAL}.
+/// @param {Real} _texcoord Encoding of texture coordinates,
+/// {@link YAMC_ENCODING_NONE}, {@link YAMC_ENCODING_FLOAT} or
+/// {@link YAMC_ENCODING_HALF}.
+/// @param {Real} _texcoord2 Encoding of the second layer of texture coordinates.
+/// @param {Bool} _color Whether the format has vertex colors.
+/// @param {Real} _tangent Encoding of tangent vectors, same as for normals.
+/// @param {Bool} [_morph] Whether the model was converted with argument
+/// --morph, which adds a `ubyte4` attribute addressing deltas of morph
+/// targets at the end of each vertex. Defaults to `false`.
+///
+/// @return {Id.VertexFormat} The created vertex format.
+///
+/// @example
+/// Following code creates a vertex format for a model converted with arguments
+/// `-pnuct --position=quantized --normal=oct --uv=half`.
+/// ```gml
+/// vformat = yamc_vertex_format_create(
+///     YAMC_ENCODING_QUANTIZED, YAMC_ENCODING_OCTAHEDRAL, YAMC_ENCODING_HALF,
+///     YAMC_ENCODING_NONE, true, YAMC_ENCODING_OCTAHEDRAL);
+/// ```
+function yamc_vertex_format_create(_position, _normal, _texcoord, _texcoord2, _color, _tangent, _morph = false)
+{
+	vertex_format_begin();
+
+	if (_position == YAMC_ENCODING_QUANTIZED)
+	{
+		vertex_format_add_custom(vertex_type_ubyte4, vertex_usage_position);
+		vertex_format_add_custom(vertex_type_ubyte4, vertex_usage_texcoord);
+	}
+	else if (_position != YAMC_ENCODING_NONE)
+	{
+		vertex_format_add_position_3d();
+	}
+
+	if (_normal == YAMC_ENCODING_FLOAT)
+	{
+		vertex_format_add_normal();
+	}
+	else if (_normal != YAMC_ENCODING_NONE)
+	{
+		vertex_format_add_custom(vertex_type_ubyte4, vertex_usage_normal);
+	}
+
+	var _texcoords = [_texcoord, _texcoord2];
+	for (var _i = 0; _i < 2; ++_i)
+	{
+		if (_texcoords[_i] == YAMC_ENCODING_FLOAT)
+		{
+			vertex_format_add_texcoord();
+		}
+		else if (_texcoords[_i] != YAMC_ENCODING_NONE)
+		{
+			vertex_format_add_custom(vertex_type_ubyte4, vertex_usage_texcoord);
+		}
+	}
+
+	if (_color)
+	{
+		vertex_format_add_color();
+	}
+
+	if (_tangent == YAMC_ENCODING_FLOAT)
+	{
+		vertex_format_add_custom(vertex_type_float4, vertex_usage_texcoord);
+	}
+	else if (_tangent != YAMC_ENCODING_NONE)
+	{
+		vertex_format_add_custom(vertex_type_ubyte4, vertex_usage_texcoord);
+	}
+
+	if (_morph)
+	{
+		vertex_format_add_custom(vertex_type_ubyte4, vertex_usage_texcoord);
+	}
+
+	return vertex_format_end();
+}
+
+/// @macro {Real} Magic number that YAMC container files start with ("YAMC").
+#macro YAMC_CONTAINER_MAGIC 0x434D4159
+
+/// @macro {Real} Identifier of a container chunk with vertex data ("VERT").
+#macro YAMC_CHUNK_VERTICES 0x54524556
+
+/// @macro {Real} Identifier of a container chunk with index data ("INDX").
+#macro YAMC_CHUNK_INDICES 0x58444E49
+
+/// @macro {Real} Identifier of a container chunk with the bounding box that
+/// quantized positions are relative to ("QPOS").
+#macro YAMC_CHUNK_POSITION_BOUNDS 0x534F5051
+
+/// @macro {Real} Identifier of a container chunk with a table of sub-meshes
+/// ("MESH").
+#macro YAMC_CHUNK_SUB_MESHES 0x4853454D
+
+/// @macro {Real} Identifier of a container chunk with a table of instances of
+/// sub-meshes and their transforms ("INST").
+#macro YAMC_CHUNK_INSTANCES 0x54534E49
+
+/// @macro {Real} Identifier of a container chunk with the node hierarchy
+/// ("NODE").
+#macro YAMC_CHUNK_NODES 0x45444F4E
+
+/// @macro {Real} Identifier of a container chunk with bounding boxes and
+/// spheres of the model and its sub-meshes ("BNDS").
+#macro YAMC_CHUNK_BOUNDS 0x53444E42
+
+/// @macro {Real} Identifier of a container chunk with levels of detail and
+/// their errors ("LODS").
+#macro YAMC_CHUNK_LODS 0x53444F4C
+
+/// @macro {Real} Identifier of a container chunk with cells of the spatial
+/// grid ("CELL").
+#macro YAMC_CHUNK_CELLS 0x4C4C4543
+
+/// @macro {Real} Identifier of a container chunk with clusters of triangles
+/// and their bounding spheres and cones of normals ("CLST").
+#macro YAMC_CHUNK_CLUSTERS 0x54534C43
+
+/// @macro {Real} Identifier of a container chunk with morph targets and their
+/// sparse deltas ("MRPH").
+#macro YAMC_CHUNK_MORPH_TARGETS 0x4850524D
+
+/// @macro {Real} Number of deltas of morph targets in each row of their data
+/// texture. Each delta takes 3 texels.
+/// @see yamc_model_set_morph_uniforms
+#macro YAMC_MORPH_TEXTURE_DELTAS 1024
+
+/// @macro {Real} Number of morph targets that ShBasic.vsh has weights for, its
+/// MORPH_MAX_TARGETS.
+/// @see yamc_model_check_morph_limits
+#macro YAMC_MORPH_MAX_TARGETS 32
+
+/// @macro {Real} Number of deltas of a single vertex that ShBasic.vsh blends,
+/// its MORPH_MAX_VERTEX_DELTAS.
+/// @see yamc_model_check_morph_limits
+#macro YAMC_MORPH_MAX_VERTEX_DELTAS 8
+
+/// @macro {Real} State of a streamed cell whose vertices are not loaded.
+/// @see yamc_stream_update
+#macro YAMC_CELL_UNLOADED 0
+
+/// @macro {Real} State of a streamed cell whose vertices are being loaded.
+/// @see yamc_stream_update
+#macro YAMC_CELL_LOADING 1
+
+/// @macro {Real} State of a streamed cell whose vertex buffer is loaded.
+/// @see yamc_stream_update
+#macro YAMC_CELL_LOADED 2
+
+/// @macro {Real} Magic number that files filtered with argument
+/// --compress-filter start with after decompression ("YFLT").
+#macro YAMC_FILTER_MAGIC 0x544C4659
+
+/// @macro {Real} Filter that splits bytes into planes, one for each byte of a
+/// vertex (--compress-filter=shuffle).
+#macro YAMC_FILTER_SHUFFLE 1
+
+/// @macro {Real} Same as {@link YAMC_FILTER_SHUFFLE}, but bytes of each plane
+/// are stored as differences from the previous byte (--compress-filter=delta).
+#macro YAMC_FILTER_DELTA 2
+
+/// @func yamc_buffer_load(_filename)
+///
+/// @desc Loads a buffer from a file. Files compressed with argument
+/// --compress are decompressed and unfiltered, so the returned buffer holds
+/// the same data as if the file was not compressed.
+///
+/// @param {String} _filename The file to load the buffer from.
+///
+/// @return {Id.Buffer} The loaded buffer.
+function yamc_buffer_load(_filename)
+{
+	var _buffer = buffer_load(_filename);
+
+	// Zlib header: deflate method and a checksum that is a multiple of 31
+	if (buffer_get_size(_buffer) < 6)
+	{
+		return _buffer;
+	}
+	var _cmf = buffer_peek(_buffer, 0, buffer_u8);
+	var _flg = buffer_peek(_buffer, 1, buffer_u8);
+	if ((_cmf & 0x0F) != 8 || (_cmf * 256 + _flg) % 31 != 0)
+	{
+		return _buffer;
+	}
+
+	// Plain vertex data can start with a valid header by chance, in which case
+	// decompression fails
+	var _decompressed = buffer_decompress(_buffer);
+	if (!buffer_exists(_decompressed))
+	{
+		return _buffer;
+	}
+	buffer_delete(_buffer);
+
+	if (buffer_get_size(_decompressed) >= 16
+		&& buffer_peek(_decompressed, 0, buffer_u32) == YAMC_FILTER_MAGIC)
+	{
+		var _unfiltered = __yamc_unfilter(_decompressed);
+		buffer_delete(_decompressed);
+		return _unfiltered;
+	}
+	return _decompressed;
+}
+
 /// @func vertex_buffer_load(_filename, _vformat)
 ///
-/// @desc Loads a vertex buffer from a file.
+/// @desc Loads a vertex buffer from a file. Supports both plain vertex buffer
+/// files and YAMC container files (e.g. made with argument --indexed), also
+/// compressed with argument --compress. Models
+/// converted with argument --strip must be drawn with `pr_trianglestrip`, use
+/// {@link yamc_model_load} to load the primitive type together with them.
 ///
 /// @param {String} _filename The file to load the buffer from.
 /// @param {Id.VertexFormat} _vformat The vertex format of the buffer.
@@ -88,9 +338,1889 @@ function __vertex_format_pnuct()
 /// @see vertex_format_pnuc
 function vertex_buffer_load(_filename, _vformat)
 {
-	gml_pragma("forceinline");
-	var _buffer = buffer_load(_filename);
-	var _vbuffer = vertex_create_buffer_from_buffer(_buffer, _vformat);
+	var _buffer = yamc_buffer_load(_filename);
+	var _vbuffer;
+	if (yamc_is_container(_buffer))
+	{
+		_vbuffer = yamc_vertex_buffer_from_container(_buffer, _vformat);
+	}
+	else
+	{
+		_vbuffer = vertex_create_buffer_from_buffer(_buffer, _vformat);
+	}
 	buffer_delete(_buffer);
 	return _vbuffer;
 }
+
+/// @func yamc_model_load(_filename, _vformat)
+///
+/// @desc Loads a model from a file, together with additional data stored in
+/// YAMC container files.
+///
+/// @param {String} _filename The file to load the model from.
+/// @param {Id.VertexFormat} _vformat The vertex format of the model.
+///
+/// @return {Struct} A struct with following properties:
+/// - `VertexBuffer` - The loaded vertex buffer, or `undefined` if the model
+/// was converted with argument --submeshes.
+/// - `PrimitiveType` - The `pr_*` constant to draw `VertexBuffer` with, e.g.
+/// `pr_trianglestrip` if the model was converted with argument --strip.
+/// - `SubMeshes` - Array of structs with properties `VertexBuffer`,
+/// `PrimitiveType` (`pr_*` constant), `MaterialIndex` and `MaterialName`, one
+/// for each sub-mesh, or `undefined` if the model was not converted with
+/// argument --submeshes.
+/// - `PositionMin` - Array `[x, y, z]` with the minimum of the bounding box that
+/// quantized positions are relative to, or `undefined` if positions are not
+/// quantized.
+/// - `PositionSize` - Array `[x, y, z]` with the size of the bounding box that
+/// quantized positions are relative to, or `undefined` if positions are not
+/// quantized.
+/// - `Instances` - Array of structs with properties `SubMesh` (index into
+/// `SubMeshes`), `Matrix` (the instance's transform) and `Mirrored` (whether
+/// the transform flips winding order), or `undefined` if the model was not
+/// converted with argument --instanced.
+/// - `Nodes` - Array of structs with properties `Name`, `Parent` (index into
+/// `Nodes`, -1 for the root), `Matrix` (the node's local transform),
+/// `BoundsMin` and `BoundsMax` (arrays `[x, y, z]` with the bounding box of the
+/// node and its children in the node's space), `SubMeshes` (array of indices
+/// into the model's `SubMeshes`) and `Visible` (can be set to `false` to hide
+/// the node and its children), or `undefined` if the model was not converted
+/// with argument --nodes. Parents come before their children.
+/// - `Bounds` - Struct with properties `Min` and `Max` (arrays `[x, y, z]`
+/// with the bounding box), `Center` (array `[x, y, z]`) and `Radius` (the
+/// bounding sphere) of the whole model, or `undefined` if the model was not
+/// converted with argument --bounds. Sub-meshes then also have property
+/// `Bounds` with the same properties.
+/// - `Lods` - Array of structs with properties `Error` (an estimate of the
+/// distance by which the level deviates from the original model),
+/// `FirstSubMesh` and `SubMeshCount` (the range of `SubMeshes` of the level),
+/// one for each level of detail, starting with the original model, or
+/// `undefined` if the model was not converted with argument --lod or
+/// --lod-error.
+/// - `Clusters` - Array of structs with properties `SubMesh` (index into
+/// `SubMeshes`, 0 without them), `Offset` and `Count` (the range of vertices
+/// in the sub-mesh's vertex buffer), `Center` (array `[x, y, z]`) and `Radius`
+/// (the bounding sphere), `ConeAxis` (array `[x, y, z]`) and `ConeCutoff` (the
+/// cone of normals), one for each cluster of triangles, or `undefined` if the
+/// model was not converted with argument --clusters.
+/// - `Morph` - Struct with properties `Targets` (array of names of morph
+/// targets), `Weights` (array of their weights, initially their default
+/// weights, which can be changed to blend the targets), `PositionScale`,
+/// `DeltaCount`, `MaxVertexDeltas` (the largest number of deltas of a single
+/// vertex) and private data of the texture of deltas, or `undefined` if the
+/// model was not converted with argument --morph.
+///
+/// @example
+/// Following code loads a model with quantized positions and passes the
+/// uniforms required to decode them in ShBasic.
+/// ```gml
+/// /// @desc Create event
+/// model = yamc_model_load("model.bin", vformat);
+///
+/// /// @desc Draw event
+/// shader_set(ShBasic);
+/// shader_set_uniform_f_array(shader_get_uniform(ShBasic, "u_vPositionMin"), model.PositionMin);
+/// shader_set_uniform_f_array(shader_get_uniform(ShBasic, "u_vPositionSize"), model.PositionSize);
+/// vertex_submit(model.VertexBuffer, pr_trianglelist, sprite_get_texture(SprModel, 0));
+/// shader_reset();
+///
+/// /// @desc Clean Up event
+/// yamc_model_destroy(model);
+/// ```
+///
+/// @see yamc_model_submit
+/// @see yamc_model_destroy
+function yamc_model_load(_filename, _vformat)
+{
+	var _buffer = yamc_buffer_load(_filename);
+	var _model = yamc_model_from_buffer(_buffer, _vformat);
+	buffer_delete(_buffer);
+	return _model;
+}
+
+/// @func yamc_model_from_buffer(_buffer, _vformat)
+///
+/// @desc Creates a model from a buffer holding a file written by yamc,
+/// decompressed if it was converted with argument --compress. The buffer is
+/// not deleted.
+///
+/// @param {Id.Buffer} _buffer The buffer to create the model from.
+/// @param {Id.VertexFormat} _vformat The vertex format of the model.
+///
+/// @return {Struct} The model, same as returned by {@link yamc_model_load}.
+function yamc_model_from_buffer(_buffer, _vformat)
+{
+	var _model = {
+		VertexBuffer: undefined,
+		PrimitiveType: pr_trianglelist,
+		SubMeshes: undefined,
+		PositionMin: undefined,
+		PositionSize: undefined,
+		Instances: undefined,
+		Nodes: undefined,
+		Bounds: undefined,
+		Lods: undefined,
+		Clusters: undefined,
+		Morph: undefined,
+		Batches: undefined,
+		BatchBuffers: undefined,
+	};
+
+	if (yamc_is_container(_buffer))
+	{
+		if (yamc_find_chunk(_buffer, YAMC_CHUNK_SUB_MESHES) != -1)
+		{
+			_model.SubMeshes = yamc_sub_meshes_from_container(_buffer, _vformat);
+		}
+		else
+		{
+			_model.VertexBuffer = yamc_vertex_buffer_from_container(_buffer, _vformat);
+			_model.PrimitiveType = buffer_peek(
+				_buffer, yamc_find_chunk(_buffer, YAMC_CHUNK_VERTICES), buffer_u32);
+		}
+
+		var _boundsOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_POSITION_BOUNDS);
+		if (_boundsOffset != -1)
+		{
+			buffer_seek(_buffer, buffer_seek_start, _boundsOffset);
+			var _min = [
+				buffer_read(_buffer, buffer_f32),
+				buffer_read(_buffer, buffer_f32),
+				buffer_read(_buffer, buffer_f32),
+			];
+			_model.PositionMin = _min;
+			_model.PositionSize = [
+				buffer_read(_buffer, buffer_f32) - _min[0],
+				buffer_read(_buffer, buffer_f32) - _min[1],
+				buffer_read(_buffer, buffer_f32) - _min[2],
+			];
+		}
+
+		var _instanceOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_INSTANCES);
+		if (_instanceOffset != -1)
+		{
+			buffer_seek(_buffer, buffer_seek_start, _instanceOffset);
+			var _instances = array_create(buffer_read(_buffer, buffer_u32));
+			for (var _i = 0; _i < array_length(_instances); ++_i)
+			{
+				var _subMesh = buffer_read(_buffer, buffer_u32);
+				var _matrix = array_create(16);
+				for (var _j = 0; _j < 16; ++_j)
+				{
+					_matrix[_j] = buffer_read(_buffer, buffer_f32);
+				}
+				_instances[_i] = {
+					SubMesh: _subMesh,
+					Matrix: _matrix,
+					Mirrored: __yamc_matrix_is_mirrored(_matrix),
+				};
+			}
+			_model.Instances = _instances;
+		}
+
+		var _nodeOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_NODES);
+		if (_nodeOffset != -1)
+		{
+			buffer_seek(_buffer, buffer_seek_start, _nodeOffset);
+			var _nodes = array_create(buffer_read(_buffer, buffer_u32));
+			for (var _i = 0; _i < array_length(_nodes); ++_i)
+			{
+				var _parent = buffer_read(_buffer, buffer_u32);
+				var _matrix = array_create(16);
+				for (var _j = 0; _j < 16; ++_j)
+				{
+					_matrix[_j] = buffer_read(_buffer, buffer_f32);
+				}
+				var _boundsMin = [
+					buffer_read(_buffer, buffer_f32),
+					buffer_read(_buffer, buffer_f32),
+					buffer_read(_buffer, buffer_f32),
+				];
+				var _boundsMax = [
+					buffer_read(_buffer, buffer_f32),
+					buffer_read(_buffer, buffer_f32),
+					buffer_read(_buffer, buffer_f32),
+				];
+				var _subMeshes = array_create(buffer_read(_buffer, buffer_u32));
+				for (var _j = 0; _j < array_length(_subMeshes); ++_j)
+				{
+					_subMeshes[_j] = buffer_read(_buffer, buffer_u32);
+				}
+				_nodes[_i] = {
+					Name: buffer_read(_buffer, buffer_string),
+					Parent: (_parent == 0xFFFFFFFF) ? -1 : _parent,
+					Matrix: _matrix,
+					BoundsMin: _boundsMin,
+					BoundsMax: _boundsMax,
+					SubMeshes: _subMeshes,
+					Visible: true,
+				};
+			}
+			_model.Nodes = _nodes;
+		}
+
+		var _volumeOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_BOUNDS);
+		if (_volumeOffset != -1)
+		{
+			buffer_seek(_buffer, buffer_seek_start, _volumeOffset);
+			_model.Bounds = __yamc_read_bounds(_buffer);
+			var _rangeCount = buffer_read(_buffer, buffer_u32);
+			if (_model.SubMeshes != undefined)
+			{
+				for (var _i = 0; _i < _rangeCount; ++_i)
+				{
+					_model.SubMeshes[_i].Bounds = __yamc_read_bounds(_buffer);
+				}
+			}
+		}
+
+		var _lodOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_LODS);
+		if (_lodOffset != -1)
+		{
+			buffer_seek(_buffer, buffer_seek_start, _lodOffset);
+			var _lods = array_create(buffer_read(_buffer, buffer_u32));
+			for (var _i = 0; _i < array_length(_lods); ++_i)
+			{
+				var _error = buffer_read(_buffer, buffer_f32);
+				var _firstSubMesh = buffer_read(_buffer, buffer_u32);
+				_lods[_i] = {
+					Error: _error,
+					FirstSubMesh: _firstSubMesh,
+					SubMeshCount: buffer_read(_buffer, buffer_u32),
+				};
+			}
+			_model.Lods = _lods;
+		}
+
+		var _clusterOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_CLUSTERS);
+		if (_clusterOffset != -1)
+		{
+			buffer_seek(_buffer, buffer_seek_start, _clusterOffset);
+			var _clusters = array_create(buffer_read(_buffer, buffer_u32));
+			for (var _i = 0; _i < array_length(_clusters); ++_i)
+			{
+				var _cluster = {
+					SubMesh: buffer_read(_buffer, buffer_u32),
+					Offset: 0,
+					Count: 0,
+					Center: [0, 0, 0],
+					Radius: 0,
+					ConeAxis: [0, 0, 0],
+					ConeCutoff: 1,
+				};
+				_cluster.Offset = buffer_read(_buffer, buffer_u32);
+				_cluster.Count = buffer_read(_buffer, buffer_u32);
+				for (var _j = 0; _j < 3; ++_j)
+				{
+					_cluster.Center[_j] = buffer_read(_buffer, buffer_f32);
+				}
+				_cluster.Radius = buffer_read(_buffer, buffer_f32);
+				for (var _j = 0; _j < 3; ++_j)
+				{
+					_cluster.ConeAxis[_j] = buffer_read(_buffer, buffer_f32);
+				}
+				_cluster.ConeCutoff = buffer_read(_buffer, buffer_f32);
+				_clusters[_i] = _cluster;
+			}
+			_model.Clusters = _clusters;
+		}
+
+		var _morphOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_MORPH_TARGETS);
+		if (_morphOffset != -1)
+		{
+			buffer_seek(_buffer, buffer_seek_start, _morphOffset);
+			var _targets = array_create(buffer_read(_buffer, buffer_u32));
+			var _weights = array_create(array_length(_targets), 0);
+			for (var _i = 0; _i < array_length(_targets); ++_i)
+			{
+				_weights[_i] = buffer_read(_buffer, buffer_f32);
+				_targets[_i] = buffer_read(_buffer, buffer_string);
+			}
+			var _positionScale = buffer_read(_buffer, buffer_f32);
+			var _deltaCount = buffer_read(_buffer, buffer_u32);
+			var _maxVertexDeltas = buffer_read(_buffer, buffer_u32);
+
+			// Deltas are kept in a buffer with the size of their texture, so
+			// that the texture can be recreated whenever its surface is lost
+			var _rows = max(ceil(_deltaCount / YAMC_MORPH_TEXTURE_DELTAS), 1);
+			var _deltas = buffer_create(YAMC_MORPH_TEXTURE_DELTAS * 12 * _rows, buffer_fixed, 1);
+			buffer_fill(_deltas, 0, buffer_u8, 0, buffer_get_size(_deltas));
+			buffer_copy(_buffer, buffer_tell(_buffer), _deltaCount * 12, _deltas, 0);
+
+			_model.Morph = {
+				Targets: _targets,
+				Weights: _weights,
+				PositionScale: _positionScale,
+				DeltaCount: _deltaCount,
+				MaxVertexDeltas: _maxVertexDeltas,
+				Buffer: _deltas,
+				Width: YAMC_MORPH_TEXTURE_DELTAS * 3,
+				Height: _rows,
+				Surface: -1,
+			};
+		}
+	}
+	else
+	{
+		_model.VertexBuffer = vertex_create_buffer_from_buffer(_buffer, _vformat);
+	}
+
+	return _model;
+}
+
+/// @func yamc_model_destroy(_model)
+///
+/// @desc Frees a model loaded with {@link yamc_model_load} from memory.
+///
+/// @param {Struct} _model The model to destroy.
+function yamc_model_destroy(_model)
+{
+	if (_model.VertexBuffer != undefined)
+	{
+		vertex_delete_buffer(_model.VertexBuffer);
+		_model.VertexBuffer = undefined;
+	}
+
+	if (_model.SubMeshes != undefined)
+	{
+		for (var _i = 0; _i < array_length(_model.SubMeshes); ++_i)
+		{
+			vertex_delete_buffer(_model.SubMeshes[_i].VertexBuffer);
+		}
+		_model.SubMeshes = undefined;
+	}
+
+	if (_model.Morph != undefined)
+	{
+		if (surface_exists(_model.Morph.Surface))
+		{
+			surface_free(_model.Morph.Surface);
+		}
+		buffer_delete(_model.Morph.Buffer);
+		_model.Morph = undefined;
+	}
+
+	if (_model.BatchBuffers != undefined)
+	{
+		for (var _i = 0; _i < array_length(_model.BatchBuffers); ++_i)
+		{
+			if (_model.BatchBuffers[_i] != undefined)
+			{
+				vertex_delete_buffer(_model.BatchBuffers[_i]);
+			}
+		}
+		_model.BatchBuffers = undefined;
+		_model.Batches = undefined;
+	}
+}
+
+/// @func yamc_model_submit(_model, _textures)
+///
+/// @desc Submits a model loaded with {@link yamc_model_load}.
+///
+/// @param {Struct} _model The model to submit.
+/// @param {Array<Pointer.Texture>} _textures Array of textures indexed by
+/// material index. Sub-meshes with material index out of the array's range
+/// use texture -1. Models without sub-meshes are submitted as a triangle list
+/// with the first texture. Models converted with argument --instanced submit
+/// each sub-mesh once for every instance, with the instance's transform
+/// applied on top of the current world matrix. Models converted with argument
+/// --nodes are submitted with {@link yamc_model_submit_nodes}. Sub-meshes of
+/// models converted with argument --bounds are skipped if they are outside
+/// of the camera's frustum. Models converted with argument --lod submit only
+/// the original level of detail, use {@link yamc_model_submit_lod} to submit
+/// others.
+///
+/// @example
+/// ```gml
+/// /// @desc Create event
+/// model = yamc_model_load("model.bin", vertex_format_pnuc);
+/// textures = [sprite_get_texture(SprWood, 0), sprite_get_texture(SprMetal, 0)];
+///
+/// /// @desc Draw event
+/// yamc_model_submit(model, textures);
+/// ```
+function yamc_model_submit(_model, _textures)
+{
+	var _textureCount = array_length(_textures);
+
+	if (_model.VertexBuffer != undefined)
+	{
+		vertex_submit(_model.VertexBuffer, _model.PrimitiveType, (_textureCount > 0) ? _textures[0] : -1);
+	}
+
+	if (_model.Nodes != undefined)
+	{
+		yamc_model_submit_nodes(_model, _textures);
+	}
+	else if (_model.Instances != undefined)
+	{
+		var _world = matrix_get(matrix_world);
+		var _cullmode = gpu_get_cullmode();
+		var _frustum = (_model.Bounds != undefined) ? yamc_frustum_create() : undefined;
+		for (var _i = 0; _i < array_length(_model.Instances); ++_i)
+		{
+			var _instance = _model.Instances[_i];
+			var _subMesh = _model.SubMeshes[_instance.SubMesh];
+			var _material = _subMesh.MaterialIndex;
+			var _matrix = matrix_multiply(_instance.Matrix, _world);
+			if (_frustum != undefined && !yamc_frustum_test_bounds(_frustum, _subMesh.Bounds, _matrix))
+			{
+				continue;
+			}
+			gpu_set_cullmode(_instance.Mirrored ? __yamc_cullmode_flip(_cullmode) : _cullmode);
+			matrix_set(matrix_world, _matrix);
+			vertex_submit(_subMesh.VertexBuffer, _subMesh.PrimitiveType,
+				(_material < _textureCount) ? _textures[_material] : -1);
+		}
+		gpu_set_cullmode(_cullmode);
+		matrix_set(matrix_world, _world);
+	}
+	else if (_model.Lods != undefined)
+	{
+		yamc_model_submit_lod(_model, _textures, 0);
+	}
+	else if (_model.SubMeshes != undefined)
+	{
+		__yamc_submit_sub_meshes(_model, _textures, 0, array_length(_model.SubMeshes));
+	}
+}
+
+/// @func yamc_model_select_lod(_model, _distance[, _pixelError[, _projection[, _screenHeight]]])
+///
+/// @desc Selects the level of detail of a model converted with argument --lod
+/// to draw at given distance from the camera. Errors of levels are projected
+/// onto the screen and the coarsest level whose error does not exceed
+/// `_pixelError` pixels is selected.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Real} _distance The distance of the model from the camera.
+/// @param {Real} [_pixelError] The largest error on the screen, in pixels.
+/// Defaults to 1.
+/// @param {Array<Real>} [_projection] The projection matrix. Defaults to the
+/// current one.
+/// @param {Real} [_screenHeight] The height of the render target in pixels.
+/// Defaults to the height of the window.
+///
+/// @return {Real} The index of the level of detail into the model's `Lods`, 0
+/// for models without levels of detail. Errors of the model's levels are in
+/// the model's space, so `_distance` must be divided by the scale of the
+/// model's world matrix.
+///
+/// @example
+/// ```gml
+/// /// @desc Draw event
+/// var _distance = point_distance_3d(x, y, z, OCamera.x, OCamera.y, OCamera.z);
+/// matrix_set(matrix_world, matrix_build(x, y, z, 0, 0, direction, 1, 1, 1));
+/// yamc_model_submit_lod(model, textures, yamc_model_select_lod(model, _distance));
+/// matrix_set(matrix_world, matrix_build_identity());
+/// ```
+function yamc_model_select_lod(_model, _distance, _pixelError = 1, _projection = matrix_get(matrix_projection), _screenHeight = window_get_height())
+{
+	if (_model.Lods == undefined)
+	{
+		return 0;
+	}
+
+	// Pixels per unit of error, which does not depend on the distance for
+	// orthographic projections
+	var _scale = abs(_projection[5]) * _screenHeight * 0.5;
+	if (_projection[11] != 0)
+	{
+		_scale /= max(_distance, math_get_epsilon());
+	}
+
+	var _lod = 0;
+	for (var _i = 1; _i < array_length(_model.Lods); ++_i)
+	{
+		if (_model.Lods[_i].Error * _scale > _pixelError)
+		{
+			break;
+		}
+		_lod = _i;
+	}
+	return _lod;
+}
+
+/// @func yamc_model_submit_lod(_model, _textures, _lod)
+///
+/// @desc Submits sub-meshes of a level of detail of a model converted with
+/// argument --lod. Sub-meshes of models converted with argument --bounds are
+/// skipped if they are outside of the camera's frustum.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Array<Pointer.Texture>} _textures Array of textures indexed by
+/// material index, same as in {@link yamc_model_submit}.
+/// @param {Real} _lod The index of the level of detail, e.g. selected with
+/// {@link yamc_model_select_lod}.
+function yamc_model_submit_lod(_model, _textures, _lod)
+{
+	var _level = _model.Lods[_lod];
+	__yamc_submit_sub_meshes(_model, _textures, _level.FirstSubMesh, _level.SubMeshCount);
+}
+
+/// @func yamc_model_cull_clusters(_model, _x, _y, _z[, _frustum[, _matrix]])
+///
+/// @desc Builds a list of ranges of vertices to submit of a model converted
+/// with argument --clusters, skipping clusters that are backfacing from the
+/// camera's position or outside of its frustum. Adjacent visible clusters are
+/// merged into a single range.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Real} _x The X coordinate of the camera in the model's space.
+/// @param {Real} _y The Y coordinate of the camera in the model's space.
+/// @param {Real} _z The Z coordinate of the camera in the model's space.
+/// @param {Array<Array<Real>>} [_frustum] The camera's frustum. Defaults to
+/// the frustum of the current view and projection matrices.
+/// @param {Array<Real>} [_matrix] The model's world matrix. Defaults to the
+/// current world matrix.
+///
+/// @return {Array<Struct>} Array of structs with properties `SubMesh`,
+/// `Offset` and `Count`, to be submitted with
+/// {@link yamc_model_submit_clusters}.
+///
+/// @example
+/// ```gml
+/// /// @desc Draw event
+/// matrix_set(matrix_world, matrix_build(x, y, z, 0, 0, 0, 1, 1, 1));
+/// var _list = yamc_model_cull_clusters(model,
+///     OCamera.x - x, OCamera.y - y, OCamera.z - z);
+/// yamc_model_submit_clusters(model, textures, _list);
+/// matrix_set(matrix_world, matrix_build_identity());
+/// ```
+function yamc_model_cull_clusters(_model, _x, _y, _z, _frustum = yamc_frustum_create(), _matrix = matrix_get(matrix_world))
+{
+	var _list = [];
+	var _last = undefined;
+	for (var _i = 0; _i < array_length(_model.Clusters); ++_i)
+	{
+		var _cluster = _model.Clusters[_i];
+		var _center = _cluster.Center;
+		var _axis = _cluster.ConeAxis;
+
+		// Backfacing if the camera is inside of the cone of normals flipped
+		// around the center, expanded by the bounding sphere
+		var _dx = _center[0] - _x;
+		var _dy = _center[1] - _y;
+		var _dz = _center[2] - _z;
+		var _distance = sqrt(_dx * _dx + _dy * _dy + _dz * _dz);
+		if (_dx * _axis[0] + _dy * _axis[1] + _dz * _axis[2]
+			>= _cluster.ConeCutoff * _distance + _cluster.Radius)
+		{
+			continue;
+		}
+
+		if (!yamc_frustum_test_sphere(_frustum, _center, _cluster.Radius, _matrix))
+		{
+			continue;
+		}
+
+		if (_last != undefined
+			&& _last.SubMesh == _cluster.SubMesh
+			&& _last.Offset + _last.Count == _cluster.Offset)
+		{
+			_last.Count += _cluster.Count;
+			continue;
+		}
+
+		_last = {
+			SubMesh: _cluster.SubMesh,
+			Offset: _cluster.Offset,
+			Count: _cluster.Count,
+		};
+		array_push(_list, _last);
+	}
+	return _list;
+}
+
+/// @func yamc_model_submit_clusters(_model, _textures, _list)
+///
+/// @desc Submits ranges of vertices of a model built with
+/// {@link yamc_model_cull_clusters}.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Array<Pointer.Texture>} _textures Array of textures indexed by
+/// material index, same as in {@link yamc_model_submit}.
+/// @param {Array<Struct>} _list The ranges to submit.
+function yamc_model_submit_clusters(_model, _textures, _list)
+{
+	var _textureCount = array_length(_textures);
+	for (var _i = 0; _i < array_length(_list); ++_i)
+	{
+		var _range = _list[_i];
+		var _vbuffer = _model.VertexBuffer;
+		var _primitiveType = _model.PrimitiveType;
+		var _material = 0;
+		if (_model.SubMeshes != undefined)
+		{
+			var _subMesh = _model.SubMeshes[_range.SubMesh];
+			_vbuffer = _subMesh.VertexBuffer;
+			_primitiveType = _subMesh.PrimitiveType;
+			_material = _subMesh.MaterialIndex;
+		}
+		vertex_submit_ext(_vbuffer, _primitiveType,
+			(_material < _textureCount) ? _textures[_material] : -1,
+			_range.Offset, _range.Count);
+	}
+}
+
+/// @func yamc_model_find_morph_target(_model, _name)
+///
+/// @desc Finds a morph target of a model converted with argument --morph by
+/// its name.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {String} _name The name of the morph target.
+///
+/// @return {Real} The index of the morph target or -1 if the model does not
+/// have such target.
+///
+/// @example
+/// Following code makes a character smile halfway.
+/// ```gml
+/// character.Morph.Weights[yamc_model_find_morph_target(character, "Smile")] = 0.5;
+/// ```
+function yamc_model_find_morph_target(_model, _name)
+{
+	if (_model.Morph != undefined)
+	{
+		for (var _i = 0; _i < array_length(_model.Morph.Targets); ++_i)
+		{
+			if (_model.Morph.Targets[_i] == _name)
+			{
+				return _i;
+			}
+		}
+	}
+	return -1;
+}
+
+/// @func yamc_model_check_morph_limits(_model[, _maxTargets[, _maxVertexDeltas]])
+///
+/// @desc Checks whether a shader can blend all morph targets of a model, i.e.
+/// whether it has weights for all of them and blends enough deltas per vertex.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Real} [_maxTargets] MORPH_MAX_TARGETS of the shader. Defaults to
+/// {@link YAMC_MORPH_MAX_TARGETS}.
+/// @param {Real} [_maxVertexDeltas] MORPH_MAX_VERTEX_DELTAS of the shader.
+/// Defaults to {@link YAMC_MORPH_MAX_VERTEX_DELTAS}.
+///
+/// @return {Bool} Returns true if the model has no morph targets or the shader
+/// can blend all of them.
+function yamc_model_check_morph_limits(_model, _maxTargets = YAMC_MORPH_MAX_TARGETS, _maxVertexDeltas = YAMC_MORPH_MAX_VERTEX_DELTAS)
+{
+	var _morph = _model.Morph;
+	return (_morph == undefined
+		|| (array_length(_morph.Targets) <= _maxTargets && _morph.MaxVertexDeltas <= _maxVertexDeltas));
+}
+
+/// @func yamc_model_set_morph_uniforms(_model, _shader)
+///
+/// @desc Passes deltas and weights of morph targets of a model converted with
+/// argument --morph to the current shader, which blends them in its vertex
+/// shader, see ShBasic.vsh with `MORPH` defined. Deltas are uploaded into a
+/// data texture on the first call and whenever its surface is lost, so this
+/// must be called in a draw event.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Asset.GMShader} _shader The current shader. Its array of weights
+/// must have at least as many elements as the model has morph targets.
+///
+/// @example
+/// ```gml
+/// /// @desc Draw event
+/// shader_set(ShBasic);
+/// yamc_model_set_morph_uniforms(model, ShBasic);
+/// yamc_model_submit(model, textures);
+/// shader_reset();
+/// ```
+function yamc_model_set_morph_uniforms(_model, _shader)
+{
+	var _morph = _model.Morph;
+	if (!surface_exists(_morph.Surface))
+	{
+		_morph.Surface = surface_create(_morph.Width, _morph.Height);
+		buffer_set_surface(_morph.Buffer, _morph.Surface, 0);
+	}
+
+	// Deltas are fetched texel by texel, so they must not be filtered
+	var _sampler = shader_get_sampler_index(_shader, "u_sMorphDeltas");
+	texture_set_stage(_sampler, surface_get_texture(_morph.Surface));
+	gpu_set_tex_filter_ext(_sampler, false);
+	gpu_set_tex_mip_enable_ext(_sampler, mip_off);
+	gpu_set_tex_repeat_ext(_sampler, false);
+
+	shader_set_uniform_f(shader_get_uniform(_shader, "u_vMorphTextureSize"), _morph.Width, _morph.Height);
+	shader_set_uniform_f(shader_get_uniform(_shader, "u_fMorphPositionScale"), _morph.PositionScale);
+	if (array_length(_morph.Weights) > 0)
+	{
+		shader_set_uniform_f_array(shader_get_uniform(_shader, "u_fMorphWeights"), _morph.Weights);
+	}
+}
+
+/// @func yamc_model_find_node(_model, _name)
+///
+/// @desc Finds a node of a model converted with argument --nodes by its name.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {String} _name The name of the node.
+///
+/// @return {Real} The index of the first node with given name or -1 if the
+/// model does not have such node.
+///
+/// @example
+/// Following code hides the wheels of a car.
+/// ```gml
+/// car.Nodes[yamc_model_find_node(car, "Wheels")].Visible = false;
+/// ```
+function yamc_model_find_node(_model, _name)
+{
+	if (_model.Nodes != undefined)
+	{
+		for (var _i = 0; _i < array_length(_model.Nodes); ++_i)
+		{
+			if (_model.Nodes[_i].Name == _name)
+			{
+				return _i;
+			}
+		}
+	}
+	return -1;
+}
+
+/// @func yamc_model_submit_nodes(_model, _textures[, _frustum])
+///
+/// @desc Submits sub-meshes of visible nodes of a model converted with argument
+/// --nodes, each with the transforms of the node and all its parents applied
+/// on top of the current world matrix. Nodes whose bounding box is outside of
+/// the frustum are skipped together with their children.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Array<Pointer.Texture>} _textures Array of textures indexed by
+/// material index, same as in {@link yamc_model_submit}.
+/// @param {Array<Array<Real>>} [_frustum] The frustum to cull nodes against,
+/// created with {@link yamc_frustum_create}. Defaults to the frustum of the
+/// current view and projection matrices.
+///
+/// @return {Real} The number of submitted sub-meshes.
+///
+/// @example
+/// ```gml
+/// /// @desc Draw event
+/// matrix_set(matrix_world, matrix_build(x, y, z, 0, 0, direction, 1, 1, 1));
+/// yamc_model_submit_nodes(model, textures);
+/// matrix_set(matrix_world, matrix_build_identity());
+/// ```
+function yamc_model_submit_nodes(_model, _textures, _frustum = yamc_frustum_create())
+{
+	var _textureCount = array_length(_textures);
+	var _world = matrix_get(matrix_world);
+	var _cullmode = gpu_get_cullmode();
+	var _nodes = _model.Nodes;
+	var _nodeCount = array_length(_nodes);
+	var _matrices = array_create(_nodeCount, undefined);
+	var _submitted = 0;
+
+	for (var _i = 0; _i < _nodeCount; ++_i)
+	{
+		// Parents come before their children, so a node is skipped if its
+		// parent was
+		var _node = _nodes[_i];
+		var _parentMatrix = (_node.Parent == -1) ? _world : _matrices[_node.Parent];
+		if (_parentMatrix == undefined || !_node.Visible)
+		{
+			continue;
+		}
+
+		var _matrix = matrix_multiply(_node.Matrix, _parentMatrix);
+		if (!yamc_frustum_test_aabb(_frustum, _node.BoundsMin, _node.BoundsMax, _matrix))
+		{
+			continue;
+		}
+		_matrices[_i] = _matrix;
+
+		var _subMeshCount = array_length(_node.SubMeshes);
+		if (_subMeshCount > 0)
+		{
+			gpu_set_cullmode(__yamc_matrix_is_mirrored(_matrix) ? __yamc_cullmode_flip(_cullmode) : _cullmode);
+			matrix_set(matrix_world, _matrix);
+			for (var _j = 0; _j < _subMeshCount; ++_j)
+			{
+				var _subMesh = _model.SubMeshes[_node.SubMeshes[_j]];
+				var _material = _subMesh.MaterialIndex;
+				vertex_submit(_subMesh.VertexBuffer, _subMesh.PrimitiveType,
+					(_material < _textureCount) ? _textures[_material] : -1);
+			}
+			_submitted += _subMeshCount;
+		}
+	}
+
+	gpu_set_cullmode(_cullmode);
+	matrix_set(matrix_world, _world);
+	return _submitted;
+}
+
+/// @func yamc_frustum_create([_view[, _projection]])
+///
+/// @desc Creates a frustum from view and projection matrices, for culling with
+/// {@link yamc_frustum_test_aabb}.
+///
+/// @param {Array<Real>} [_view] The view matrix. Defaults to the current one.
+/// @param {Array<Real>} [_projection] The projection matrix. Defaults to the
+/// current one.
+///
+/// @return {Array<Array<Real>>} Array of six planes `[a, b, c, d]`, where
+/// points `[x, y, z]` with `a * x + b * y + c * z + d >= 0` are inside.
+function yamc_frustum_create(_view = matrix_get(matrix_view), _projection = matrix_get(matrix_projection))
+{
+	var _m = matrix_multiply(_view, _projection);
+	var _planes = array_create(6);
+	for (var _i = 0; _i < 6; ++_i)
+	{
+		// Left, right, bottom, top, near and far planes are the sum or the
+		// difference of the fourth and the first, second and third row
+		var _row = _i div 2;
+		var _sign = ((_i mod 2) == 0) ? 1 : -1;
+		_planes[_i] = [
+			_m[3] + _sign * _m[_row],
+			_m[7] + _sign * _m[4 + _row],
+			_m[11] + _sign * _m[8 + _row],
+			_m[15] + _sign * _m[12 + _row],
+		];
+	}
+	return _planes;
+}
+
+/// @func yamc_frustum_test_aabb(_frustum, _min, _max[, _matrix])
+///
+/// @desc Tests whether an axis-aligned bounding box may be inside of a frustum.
+///
+/// @param {Array<Array<Real>>} _frustum The frustum created with
+/// {@link yamc_frustum_create}.
+/// @param {Array<Real>} _min The minimum `[x, y, z]` of the bounding box.
+/// @param {Array<Real>} _max The maximum `[x, y, z]` of the bounding box.
+/// @param {Array<Real>} [_matrix] A matrix to transform the bounding box with.
+/// Defaults to the current world matrix.
+///
+/// @return {Bool} Returns `false` if the bounding box is empty or completely
+/// outside of the frustum.
+function yamc_frustum_test_aabb(_frustum, _min, _max, _matrix = matrix_get(matrix_world))
+{
+	if (_min[0] > _max[0])
+	{
+		return false;
+	}
+
+	// Center and half extents of the bounding box of the transformed box
+	var _cx = (_min[0] + _max[0]) * 0.5;
+	var _cy = (_min[1] + _max[1]) * 0.5;
+	var _cz = (_min[2] + _max[2]) * 0.5;
+	var _ex = (_max[0] - _min[0]) * 0.5;
+	var _ey = (_max[1] - _min[1]) * 0.5;
+	var _ez = (_max[2] - _min[2]) * 0.5;
+	var _m = _matrix;
+	var _centerX = _m[0] * _cx + _m[4] * _cy + _m[8] * _cz + _m[12];
+	var _centerY = _m[1] * _cx + _m[5] * _cy + _m[9] * _cz + _m[13];
+	var _centerZ = _m[2] * _cx + _m[6] * _cy + _m[10] * _cz + _m[14];
+	var _extentX = abs(_m[0]) * _ex + abs(_m[4]) * _ey + abs(_m[8]) * _ez;
+	var _extentY = abs(_m[1]) * _ex + abs(_m[5]) * _ey + abs(_m[9]) * _ez;
+	var _extentZ = abs(_m[2]) * _ex + abs(_m[6]) * _ey + abs(_m[10]) * _ez;
+
+	for (var _i = 0; _i < 6; ++_i)
+	{
+		var _plane = _frustum[_i];
+		var _distance = _plane[0] * _centerX + _plane[1] * _centerY + _plane[2] * _centerZ + _plane[3];
+		var _radius = abs(_plane[0]) * _extentX + abs(_plane[1]) * _extentY + abs(_plane[2]) * _extentZ;
+		if (_distance + _radius < 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// @func yamc_frustum_test_sphere(_frustum, _center, _radius[, _matrix])
+///
+/// @desc Tests whether a sphere may be inside of a frustum.
+///
+/// @param {Array<Array<Real>>} _frustum The frustum created with
+/// {@link yamc_frustum_create}.
+/// @param {Array<Real>} _center The center `[x, y, z]` of the sphere.
+/// @param {Real} _radius The radius of the sphere.
+/// @param {Array<Real>} [_matrix] A matrix to transform the sphere with. Its
+/// largest scale is applied to the radius. Defaults to the current world
+/// matrix.
+///
+/// @return {Bool} Returns `false` if the sphere is completely outside of the
+/// frustum.
+function yamc_frustum_test_sphere(_frustum, _center, _radius, _matrix = matrix_get(matrix_world))
+{
+	var _m = _matrix;
+	var _x = _m[0] * _center[0] + _m[4] * _center[1] + _m[8] * _center[2] + _m[12];
+	var _y = _m[1] * _center[0] + _m[5] * _center[1] + _m[9] * _center[2] + _m[13];
+	var _z = _m[2] * _center[0] + _m[6] * _center[1] + _m[10] * _center[2] + _m[14];
+	var _scale = sqrt(max(
+		_m[0] * _m[0] + _m[1] * _m[1] + _m[2] * _m[2],
+		_m[4] * _m[4] + _m[5] * _m[5] + _m[6] * _m[6],
+		_m[8] * _m[8] + _m[9] * _m[9] + _m[10] * _m[10]));
+	var _r = _radius * _scale;
+
+	for (var _i = 0; _i < 6; ++_i)
+	{
+		var _plane = _frustum[_i];
+		// Planes are not normalized
+		var _length = sqrt(_plane[0] * _plane[0] + _plane[1] * _plane[1] + _plane[2] * _plane[2]);
+		if (_plane[0] * _x + _plane[1] * _y + _plane[2] * _z + _plane[3] < -_r * _length)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// @func yamc_frustum_test_bounds(_frustum, _bounds[, _matrix])
+///
+/// @desc Tests whether bounds of a model or a sub-mesh (see
+/// {@link yamc_model_load}) may be inside of a frustum. The bounding sphere is
+/// tested first, then the bounding box.
+///
+/// @param {Array<Array<Real>>} _frustum The frustum created with
+/// {@link yamc_frustum_create}.
+/// @param {Struct} _bounds The bounds to test.
+/// @param {Array<Real>} [_matrix] A matrix to transform the bounds with.
+/// Defaults to the current world matrix.
+///
+/// @return {Bool} Returns `false` if the bounds are completely outside of the
+/// frustum.
+function yamc_frustum_test_bounds(_frustum, _bounds, _matrix = matrix_get(matrix_world))
+{
+	return (yamc_frustum_test_sphere(_frustum, _bounds.Center, _bounds.Radius, _matrix)
+		&& yamc_frustum_test_aabb(_frustum, _bounds.Min, _bounds.Max, _matrix));
+}
+
+/// @func yamc_model_is_visible(_model[, _frustum[, _matrix]])
+///
+/// @desc Tests whether a model converted with argument --bounds may be visible,
+/// to skip submitting models that are completely outside of the camera's
+/// frustum.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Array<Array<Real>>} [_frustum] The frustum created with
+/// {@link yamc_frustum_create}. Defaults to the frustum of the current view and
+/// projection matrices.
+/// @param {Array<Real>} [_matrix] The world matrix of the model. Defaults to
+/// the current one.
+///
+/// @return {Bool} Returns `false` if the model is completely outside of the
+/// frustum. Always returns `true` for models without bounds.
+///
+/// @example
+/// ```gml
+/// /// @desc Draw event
+/// var _frustum = yamc_frustum_create();
+/// with (OProp)
+/// {
+///     var _matrix = matrix_build(x, y, z, 0, 0, direction, 1, 1, 1);
+///     if (yamc_model_is_visible(model, _frustum, _matrix))
+///     {
+///         matrix_set(matrix_world, _matrix);
+///         vertex_submit(model.VertexBuffer, pr_trianglelist, -1);
+///     }
+/// }
+/// matrix_set(matrix_world, matrix_build_identity());
+/// ```
+function yamc_model_is_visible(_model, _frustum = yamc_frustum_create(), _matrix = matrix_get(matrix_world))
+{
+	return (_model.Bounds == undefined
+		|| yamc_frustum_test_bounds(_frustum, _model.Bounds, _matrix));
+}
+
+/// @func yamc_model_batch_instances(_model, _vformat, _batchSize)
+///
+/// @desc Prepares a model converted with argument --instanced for drawing with
+/// {@link yamc_model_submit_batched}, which draws up to `_batchSize` instances
+/// of a sub-mesh with a single vertex submit. For each sub-mesh, a vertex
+/// buffer with `_batchSize` copies of it is created, where each vertex is
+/// followed by the index of its copy (float) that a shader uses to look up
+/// the instance's transform in a uniform array, see `INSTANCED` in
+/// ShBasic.vsh.
+///
+/// @param {Struct} _model A model loaded with {@link yamc_model_load}.
+/// @param {Id.VertexFormat} _vformat The vertex format of the model followed
+/// by `vertex_format_add_custom(vertex_type_float1, vertex_usage_texcoord)`.
+/// @param {Real} _batchSize Maximum number of instances drawn at once. Must be
+/// the same as the size of the uniform array in the shader.
+///
+/// @example
+/// ```gml
+/// /// @desc Create event
+/// model = yamc_model_load("level.bin", vertex_format_pnuc);
+/// vertex_format_begin();
+/// vertex_format_add_position_3d();
+/// vertex_format_add_normal();
+/// vertex_format_add_texcoord();
+/// vertex_format_add_color();
+/// vertex_format_add_custom(vertex_type_float1, vertex_usage_texcoord);
+/// vformatBatch = vertex_format_end();
+/// yamc_model_batch_instances(model, vformatBatch, 16);
+///
+/// /// @desc Draw event
+/// shader_set(ShInstanced);
+/// yamc_model_submit_batched(model, textures, shader_get_uniform(ShInstanced, "u_mInstances"));
+/// shader_reset();
+/// ```
+function yamc_model_batch_instances(_model, _vformat, _batchSize)
+{
+	var _subMeshCount = array_length(_model.SubMeshes);
+	var _buffers = array_create(_subMeshCount, undefined);
+	var _batches = [];
+
+	// Mirrored instances need a different cull mode, so they are batched
+	// separately
+	var _groups = array_create(_subMeshCount * 2, undefined);
+	for (var _i = 0; _i < array_length(_model.Instances); ++_i)
+	{
+		var _instance = _model.Instances[_i];
+		var _key = _instance.SubMesh * 2 + (_instance.Mirrored ? 1 : 0);
+		if (_groups[_key] == undefined)
+		{
+			_groups[_key] = [];
+		}
+		array_push(_groups[_key], _instance);
+	}
+
+	for (var _key = 0; _key < array_length(_groups); ++_key)
+	{
+		var _group = _groups[_key];
+		if (_group == undefined)
+		{
+			continue;
+		}
+
+		var _subMeshIndex = _key div 2;
+		var _vbuffer = _model.SubMeshes[_subMeshIndex].VertexBuffer;
+		if (_buffers[_subMeshIndex] == undefined)
+		{
+			_buffers[_subMeshIndex] = __yamc_create_batch_buffer(_vbuffer, _vformat, _batchSize);
+		}
+
+		for (var _first = 0; _first < array_length(_group); _first += _batchSize)
+		{
+			var _count = min(_batchSize, array_length(_group) - _first);
+			var _matrices = array_create(_batchSize * 16, 0);
+			for (var _i = 0; _i < _count; ++_i)
+			{
+				array_copy(_matrices, _i * 16, _group[_first + _i].Matrix, 0, 16);
+			}
+			array_push(_batches, {
+				SubMesh: _subMeshIndex,
+				Mirrored: ((_key mod 2) == 1),
+				InstanceCount: _count,
+				VertexCount: vertex_get_number(_vbuffer),
+				Matrices: _matrices,
+			});
+		}
+	}
+
+	_model.BatchBuffers = _buffers;
+	_model.Batches = _batches;
+}
+
+/// @func yamc_model_submit_batched(_model, _textures, _uniform)
+///
+/// @desc Submits instances of a model prepared with
+/// {@link yamc_model_batch_instances} in batches. The current world matrix is
+/// applied on top of the instances' transforms.
+///
+/// @param {Struct} _model The model to submit.
+/// @param {Array<Pointer.Texture>} _textures Array of textures indexed by
+/// material index, same as in {@link yamc_model_submit}.
+/// @param {Id.Uniform} _uniform The uniform array of `mat4` that the
+/// instances' transforms are passed to.
+function yamc_model_submit_batched(_model, _textures, _uniform)
+{
+	var _textureCount = array_length(_textures);
+	var _cullmode = gpu_get_cullmode();
+	for (var _i = 0; _i < array_length(_model.Batches); ++_i)
+	{
+		var _batch = _model.Batches[_i];
+		var _subMesh = _model.SubMeshes[_batch.SubMesh];
+		var _material = _subMesh.MaterialIndex;
+		gpu_set_cullmode(_batch.Mirrored ? __yamc_cullmode_flip(_cullmode) : _cullmode);
+		shader_set_uniform_f_array(_uniform, _batch.Matrices);
+		vertex_submit_ext(_model.BatchBuffers[_batch.SubMesh], _subMesh.PrimitiveType,
+			(_material < _textureCount) ? _textures[_material] : -1,
+			0, _batch.InstanceCount * _batch.VertexCount);
+	}
+	gpu_set_cullmode(_cullmode);
+}
+
+/// @func yamc_stream_open(_filename, _vformat)
+///
+/// @desc Opens a model converted with argument --grid for streaming. Only the
+/// tables of sub-meshes and cells are loaded, vertices of cells are then loaded
+/// and unloaded asynchronously by {@link yamc_stream_update}.
+///
+/// @param {String} _filename The file to stream the model from.
+/// @param {Id.VertexFormat} _vformat The vertex format of the model.
+///
+/// @return {Struct} A struct with following properties, or `undefined` if the
+/// file was not converted with argument --grid:
+/// - `SubMeshes` - Array of structs with properties `PrimitiveType`,
+/// `MaterialIndex`, `MaterialName`, `FirstVertex` and `VertexCount`.
+/// - `Cells` - Array of structs with properties `Origin` (array `[x, y, z]`,
+/// the center of the cell in the grid), `Min` and `Max` (arrays `[x, y, z]`
+/// with the bounding box of its triangles), `FirstSubMesh` and `SubMeshCount`
+/// (the range of `SubMeshes` of the cell), `State` (one of the `YAMC_CELL_*`
+/// constants) and `VertexBuffer` (`undefined` unless loaded).
+/// - `PositionMin` and `PositionSize` - Same as in {@link yamc_model_load}.
+/// - `Loading` - The number of cells that are being loaded.
+///
+/// @example
+/// ```gml
+/// /// @desc Create event
+/// level = yamc_stream_open("level.bin", vertex_format_pnuc);
+///
+/// /// @desc Step event
+/// yamc_stream_update(level, camX, camY, camZ, 2000);
+///
+/// /// @desc Async - Save/Load event
+/// yamc_stream_async_load(level);
+///
+/// /// @desc Draw event
+/// yamc_stream_submit(level, textures);
+///
+/// /// @desc Clean Up event
+/// yamc_stream_destroy(level);
+/// ```
+function yamc_stream_open(_filename, _vformat)
+{
+	// Chunks are read one at a time into a container without vertex data,
+	// which are read by cells
+	var _buffer = buffer_create(12, buffer_fixed, 1);
+	buffer_load_partial(_buffer, _filename, 0, 12, 0);
+	if (buffer_peek(_buffer, 0, buffer_u32) != YAMC_CONTAINER_MAGIC)
+	{
+		buffer_delete(_buffer);
+		return undefined;
+	}
+
+	var _dataOffset = 0;
+	var _fileOffset = 12;
+	repeat (buffer_peek(_buffer, 8, buffer_u32))
+	{
+		var _end = buffer_get_size(_buffer);
+		buffer_resize(_buffer, _end + 8);
+		buffer_load_partial(_buffer, _filename, _fileOffset, 8, _end);
+		var _chunkId = buffer_peek(_buffer, _end, buffer_u32);
+		var _chunkSize = buffer_peek(_buffer, _end + 4, buffer_u32);
+		_fileOffset += 8;
+
+		var _loadSize = _chunkSize;
+		if (_chunkId == YAMC_CHUNK_VERTICES)
+		{
+			_loadSize = 12;
+			_dataOffset = _fileOffset + 12;
+			buffer_poke(_buffer, _end + 4, buffer_u32, _loadSize);
+		}
+		buffer_resize(_buffer, _end + 8 + _loadSize);
+		buffer_load_partial(_buffer, _filename, _fileOffset, _loadSize, _end + 8);
+		_fileOffset += _chunkSize;
+	}
+
+	var _vertexOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_VERTICES);
+	var _meshOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_SUB_MESHES);
+	var _cellOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_CELLS);
+	if (_vertexOffset == -1 || _meshOffset == -1 || _cellOffset == -1)
+	{
+		buffer_delete(_buffer);
+		return undefined;
+	}
+
+	var _stream = {
+		Filename: _filename,
+		VertexFormat: _vformat,
+		VertexSize: buffer_peek(_buffer, _vertexOffset + 4, buffer_u32),
+		DataOffset: _dataOffset,
+		SubMeshes: [],
+		Cells: [],
+		PositionMin: undefined,
+		PositionSize: undefined,
+		Requests: {},
+		Loading: 0,
+	};
+
+	buffer_seek(_buffer, buffer_seek_start, _meshOffset);
+	repeat (buffer_read(_buffer, buffer_u32))
+	{
+		var _materialIndex = buffer_read(_buffer, buffer_u32);
+		var _primitiveType = buffer_read(_buffer, buffer_u32);
+		var _firstVertex = buffer_read(_buffer, buffer_u32);
+		var _vertexCount = buffer_read(_buffer, buffer_u32);
+		buffer_read(_buffer, buffer_u32); // First index
+		buffer_read(_buffer, buffer_u32); // Index count
+		array_push(_stream.SubMeshes, {
+			PrimitiveType: _primitiveType,
+			MaterialIndex: _materialIndex,
+			MaterialName: buffer_read(_buffer, buffer_string),
+			FirstVertex: _firstVertex,
+			VertexCount: _vertexCount,
+		});
+	}
+
+	buffer_seek(_buffer, buffer_seek_start, _cellOffset);
+	repeat (buffer_read(_buffer, buffer_u32))
+	{
+		var _cell = {
+			Origin: [0, 0, 0],
+			Min: [0, 0, 0],
+			Max: [0, 0, 0],
+			FirstVertex: 0,
+			VertexCount: 0,
+			FirstSubMesh: 0,
+			SubMeshCount: 0,
+			State: YAMC_CELL_UNLOADED,
+			VertexBuffer: undefined,
+			Buffer: undefined,
+			Cancelled: false,
+			Distance: 0,
+		};
+		for (var _i = 0; _i < 3; ++_i)
+		{
+			_cell.Origin[_i] = buffer_read(_buffer, buffer_f32);
+		}
+		for (var _i = 0; _i < 3; ++_i)
+		{
+			_cell.Min[_i] = buffer_read(_buffer, buffer_f32);
+		}
+		for (var _i = 0; _i < 3; ++_i)
+		{
+			_cell.Max[_i] = buffer_read(_buffer, buffer_f32);
+		}
+		_cell.FirstVertex = buffer_read(_buffer, buffer_u32);
+		_cell.VertexCount = buffer_read(_buffer, buffer_u32);
+		_cell.FirstSubMesh = buffer_read(_buffer, buffer_u32);
+		_cell.SubMeshCount = buffer_read(_buffer, buffer_u32);
+		array_push(_stream.Cells, _cell);
+	}
+
+	var _boundsOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_POSITION_BOUNDS);
+	if (_boundsOffset != -1)
+	{
+		buffer_seek(_buffer, buffer_seek_start, _boundsOffset);
+		var _min = [
+			buffer_read(_buffer, buffer_f32),
+			buffer_read(_buffer, buffer_f32),
+			buffer_read(_buffer, buffer_f32),
+		];
+		_stream.PositionMin = _min;
+		_stream.PositionSize = [
+			buffer_read(_buffer, buffer_f32) - _min[0],
+			buffer_read(_buffer, buffer_f32) - _min[1],
+			buffer_read(_buffer, buffer_f32) - _min[2],
+		];
+	}
+
+	buffer_delete(_buffer);
+	return _stream;
+}
+
+/// @func yamc_stream_update(_stream, _x, _y, _z, _loadDistance[, _unloadDistance[, _maxRequests]])
+///
+/// @desc Starts loading cells of a streamed model whose bounding boxes are
+/// closer to a position than a distance, closest first, and unloads cells that
+/// are farther than another distance. Should be called every step, with the
+/// camera's position in the model's space.
+///
+/// @param {Struct} _stream The stream opened with {@link yamc_stream_open}.
+/// @param {Real} _x The X coordinate of the position.
+/// @param {Real} _y The Y coordinate of the position.
+/// @param {Real} _z The Z coordinate of the position.
+/// @param {Real} _loadDistance Cells closer than this are loaded.
+/// @param {Real} [_unloadDistance] Cells farther than this are unloaded.
+/// Defaults to 1.25 times `_loadDistance`, so that cells at the border are not
+/// loaded and unloaded repeatedly.
+/// @param {Real} [_maxRequests] The maximum number of cells loaded at once.
+/// Defaults to 4.
+function yamc_stream_update(_stream, _x, _y, _z, _loadDistance, _unloadDistance = _loadDistance * 1.25, _maxRequests = 4)
+{
+	var _candidates = [];
+	for (var _i = 0; _i < array_length(_stream.Cells); ++_i)
+	{
+		var _cell = _stream.Cells[_i];
+		var _dx = _x - clamp(_x, _cell.Min[0], _cell.Max[0]);
+		var _dy = _y - clamp(_y, _cell.Min[1], _cell.Max[1]);
+		var _dz = _z - clamp(_z, _cell.Min[2], _cell.Max[2]);
+		_cell.Distance = sqrt(_dx * _dx + _dy * _dy + _dz * _dz);
+
+		switch (_cell.State)
+		{
+		case YAMC_CELL_UNLOADED:
+			if (_cell.Distance <= _loadDistance)
+			{
+				array_push(_candidates, _i);
+			}
+			break;
+
+		case YAMC_CELL_LOADING:
+			// Loads cannot be cancelled, their buffers are discarded once loaded
+			_cell.Cancelled = (_cell.Distance > _unloadDistance);
+			break;
+
+		case YAMC_CELL_LOADED:
+			if (_cell.Distance > _unloadDistance)
+			{
+				vertex_delete_buffer(_cell.VertexBuffer);
+				_cell.VertexBuffer = undefined;
+				_cell.State = YAMC_CELL_UNLOADED;
+			}
+			break;
+		}
+	}
+
+	var _cells = _stream.Cells;
+	array_sort(_candidates, method({ Cells: _cells }, function (_a, _b)
+	{
+		return Cells[_a].Distance - Cells[_b].Distance;
+	}));
+
+	for (var _i = 0; _i < array_length(_candidates) && _stream.Loading < _maxRequests; ++_i)
+	{
+		var _cell = _cells[_candidates[_i]];
+		var _size = max(_cell.VertexCount * _stream.VertexSize, 1);
+		_cell.Buffer = buffer_create(_size, buffer_fixed, 1);
+		var _request = buffer_load_async(_cell.Buffer, _stream.Filename,
+			_stream.DataOffset + _cell.FirstVertex * _stream.VertexSize, _size);
+		_stream.Requests[$ string(_request)] = _candidates[_i];
+		_cell.State = YAMC_CELL_LOADING;
+		_cell.Cancelled = false;
+		++_stream.Loading;
+	}
+}
+
+/// @func yamc_stream_async_load(_stream)
+///
+/// @desc Creates vertex buffers of cells of a streamed model once their
+/// vertices are loaded. Must be called in the Async - Save/Load event.
+///
+/// @param {Struct} _stream The stream opened with {@link yamc_stream_open}.
+///
+/// @return {Bool} Returns `true` if the event belonged to the stream.
+function yamc_stream_async_load(_stream)
+{
+	var _key = string(async_load[? "id"]);
+	if (!variable_struct_exists(_stream.Requests, _key))
+	{
+		return false;
+	}
+
+	var _cell = _stream.Cells[_stream.Requests[$ _key]];
+	variable_struct_remove(_stream.Requests, _key);
+	--_stream.Loading;
+
+	if (async_load[? "status"] && !_cell.Cancelled)
+	{
+		_cell.VertexBuffer = vertex_create_buffer_from_buffer(_cell.Buffer, _stream.VertexFormat);
+		vertex_freeze(_cell.VertexBuffer);
+		_cell.State = YAMC_CELL_LOADED;
+	}
+	else
+	{
+		_cell.State = YAMC_CELL_UNLOADED;
+	}
+	buffer_delete(_cell.Buffer);
+	_cell.Buffer = undefined;
+	_cell.Cancelled = false;
+	return true;
+}
+
+/// @func yamc_stream_submit(_stream, _textures[, _frustum])
+///
+/// @desc Submits all loaded cells of a streamed model that are inside of the
+/// camera's frustum.
+///
+/// @param {Struct} _stream The stream opened with {@link yamc_stream_open}.
+/// @param {Array<Pointer.Texture>} _textures Array of textures indexed by
+/// material index, same as in {@link yamc_model_submit}.
+/// @param {Array<Array<Real>>} [_frustum] The camera's frustum. Defaults to
+/// the frustum of the current view and projection matrices.
+function yamc_stream_submit(_stream, _textures, _frustum = yamc_frustum_create())
+{
+	var _textureCount = array_length(_textures);
+	var _world = matrix_get(matrix_world);
+	for (var _i = 0; _i < array_length(_stream.Cells); ++_i)
+	{
+		var _cell = _stream.Cells[_i];
+		if (_cell.State != YAMC_CELL_LOADED
+			|| !yamc_frustum_test_aabb(_frustum, _cell.Min, _cell.Max, _world))
+		{
+			continue;
+		}
+
+		for (var _j = _cell.FirstSubMesh; _j < _cell.FirstSubMesh + _cell.SubMeshCount; ++_j)
+		{
+			var _subMesh = _stream.SubMeshes[_j];
+			var _material = _subMesh.MaterialIndex;
+			vertex_submit_ext(_cell.VertexBuffer, _subMesh.PrimitiveType,
+				(_material < _textureCount) ? _textures[_material] : -1,
+				_subMesh.FirstVertex - _cell.FirstVertex, _subMesh.VertexCount);
+		}
+	}
+}
+
+/// @func yamc_stream_destroy(_stream)
+///
+/// @desc Frees loaded cells of a streamed model from memory. Cells that are
+/// still being loaded are freed once loaded, if {@link yamc_stream_async_load}
+/// is still called.
+///
+/// @param {Struct} _stream The stream to destroy.
+function yamc_stream_destroy(_stream)
+{
+	for (var _i = 0; _i < array_length(_stream.Cells); ++_i)
+	{
+		var _cell = _stream.Cells[_i];
+		if (_cell.State == YAMC_CELL_LOADED)
+		{
+			vertex_delete_buffer(_cell.VertexBuffer);
+			_cell.VertexBuffer = undefined;
+			_cell.State = YAMC_CELL_UNLOADED;
+		}
+		_cell.Cancelled = true;
+	}
+}
+
+/// @macro {Real} Status of a native load job that is being processed.
+#macro YAMC_EXT_PENDING 0
+
+/// @macro {Real} Status of a native load job whose result size is known and
+/// which waits for a buffer to unpack the result into.
+#macro YAMC_EXT_READY 1
+
+/// @macro {Real} Status of a native load job whose result was unpacked.
+#macro YAMC_EXT_DONE 2
+
+/// @macro {Real} Status of a native load job that failed.
+#macro YAMC_EXT_FAILED -1
+
+/// @func yamc_async_init([_path[, _threads]])
+///
+/// @desc Loads the native extension built as target yamc_ext and starts its
+/// worker threads, which read, decompress and unpack files for
+/// {@link yamc_async_load} in the background.
+///
+/// @param {String} [_path] The path to the shared library. Defaults to
+/// "yamc_ext.dll", "yamc_ext.dylib" or "yamc_ext.so", depending on the OS.
+/// @param {Real} [_threads] The number of worker threads. Defaults to 0, which
+/// is one for each CPU core.
+///
+/// @return {Real} The number of worker threads.
+function yamc_async_init(_path = undefined, _threads = 0)
+{
+	if (_path == undefined)
+	{
+		_path = (os_type == os_windows) ? "yamc_ext.dll"
+			: ((os_type == os_macosx) ? "yamc_ext.dylib" : "yamc_ext.so");
+	}
+	global.__yamcExt = {
+		Init: external_define(_path, "yamc_ext_init", dll_cdecl, ty_real, 1, ty_real),
+		Shutdown: external_define(_path, "yamc_ext_shutdown", dll_cdecl, ty_real, 0),
+		Load: external_define(_path, "yamc_ext_load", dll_cdecl, ty_real, 2, ty_string, ty_real),
+		Status: external_define(_path, "yamc_ext_status", dll_cdecl, ty_real, 1, ty_real),
+		Size: external_define(_path, "yamc_ext_size", dll_cdecl, ty_real, 1, ty_real),
+		Complete: external_define(_path, "yamc_ext_complete", dll_cdecl, ty_real, 2, ty_real, ty_string),
+		Free: external_define(_path, "yamc_ext_free", dll_cdecl, ty_real, 1, ty_real),
+	};
+	return external_call(global.__yamcExt.Init, _threads);
+}
+
+/// @func yamc_async_shutdown()
+///
+/// @desc Waits for all jobs of the native extension to finish and stops its
+/// worker threads. Requests that were not finished cannot be updated anymore.
+function yamc_async_shutdown()
+{
+	external_call(global.__yamcExt.Shutdown);
+}
+
+/// @func yamc_async_load(_filename, _vformat[, _model])
+///
+/// @desc Starts loading a vertex buffer or a model on worker threads of the
+/// native extension. The file is read, decompressed (if converted with
+/// argument --compress) and unpacked (indexed vertices are expanded) without
+/// stalling the game. Call {@link yamc_async_update} each step until it
+/// returns `true`.
+///
+/// @param {String} _filename The file to load. The extension reads it
+/// directly, so it should be an absolute path, e.g. starting with
+/// `working_directory`.
+/// @param {Id.VertexFormat} _vformat The vertex format of the model.
+/// @param {Bool} [_model] Whether to load a model like {@link yamc_model_load}
+/// instead of a vertex buffer like {@link vertex_buffer_load}. Defaults to
+/// `false`.
+///
+/// @return {Struct} A request struct with property `Result`, which holds the
+/// loaded vertex buffer or model once {@link yamc_async_update} returns `true`,
+/// or `undefined` if loading failed.
+///
+/// @example
+/// ```gml
+/// /// @desc Create event
+/// yamc_async_init();
+/// request = yamc_async_load(working_directory + "model.bin", vformat);
+/// model = undefined;
+///
+/// /// @desc Step event
+/// if (request != undefined && yamc_async_update(request))
+/// {
+///     model = request.Result;
+///     request = undefined;
+/// }
+/// ```
+function yamc_async_load(_filename, _vformat, _model = false)
+{
+	return {
+		Job: external_call(global.__yamcExt.Load, _filename, _model ? 0 : 1),
+		VFormat: _vformat,
+		Model: _model,
+		Buffer: undefined,
+		Result: undefined,
+		Finished: false,
+	};
+}
+
+/// @func yamc_async_update(_request)
+///
+/// @desc Checks the state of a request created with {@link yamc_async_load}.
+/// Once the size of the file's contents is known, creates a buffer that the
+/// extension unpacks them into. Once they are unpacked, creates the vertex
+/// buffer or the model from it.
+///
+/// @param {Struct} _request The request to update.
+///
+/// @return {Bool} Returns `true` if the request is finished.
+function yamc_async_update(_request)
+{
+	if (_request.Finished)
+	{
+		return true;
+	}
+
+	var _ext = global.__yamcExt;
+	var _status = external_call(_ext.Status, _request.Job);
+	if (_status == YAMC_EXT_READY && _request.Buffer == undefined)
+	{
+		// The buffer must stay alive until the job is done
+		_request.Buffer = buffer_create(max(external_call(_ext.Size, _request.Job), 1), buffer_fixed, 1);
+		external_call(_ext.Complete, _request.Job, buffer_get_address(_request.Buffer));
+		return false;
+	}
+
+	if (_status == YAMC_EXT_DONE)
+	{
+		_request.Result = _request.Model
+			? yamc_model_from_buffer(_request.Buffer, _request.VFormat)
+			: vertex_create_buffer_from_buffer(_request.Buffer, _request.VFormat);
+	}
+	else if (_status != YAMC_EXT_FAILED)
+	{
+		return false;
+	}
+
+	external_call(_ext.Free, _request.Job);
+	if (_request.Buffer != undefined)
+	{
+		buffer_delete(_request.Buffer);
+		_request.Buffer = undefined;
+	}
+	_request.Finished = true;
+	return true;
+}
+
+/// @ignore
+function __yamc_submit_sub_meshes(_model, _textures, _first, _count)
+{
+	var _textureCount = array_length(_textures);
+	var _frustum = (_model.Bounds != undefined) ? yamc_frustum_create() : undefined;
+	var _world = matrix_get(matrix_world);
+	for (var _i = _first; _i < _first + _count; ++_i)
+	{
+		var _subMesh = _model.SubMeshes[_i];
+		var _material = _subMesh.MaterialIndex;
+		if (_frustum != undefined && !yamc_frustum_test_bounds(_frustum, _subMesh.Bounds, _world))
+		{
+			continue;
+		}
+		vertex_submit(_subMesh.VertexBuffer, _subMesh.PrimitiveType,
+			(_material < _textureCount) ? _textures[_material] : -1);
+	}
+}
+
+/// @ignore
+function __yamc_unfilter(_buffer)
+{
+	var _filter = buffer_peek(_buffer, 4, buffer_u32);
+	var _stride = buffer_peek(_buffer, 8, buffer_u32);
+	var _size = buffer_peek(_buffer, 12, buffer_u32);
+	var _count = (_stride > 0) ? floor(_size / _stride) : 0;
+	var _filtered = _count * _stride;
+	var _out = buffer_create(max(_size, 1), buffer_fixed, 1);
+
+	// Each plane holds one byte of all vertices
+	buffer_seek(_buffer, buffer_seek_start, 16);
+	for (var _b = 0; _b < _stride; ++_b)
+	{
+		var _offset = _b;
+		if (_filter == YAMC_FILTER_DELTA)
+		{
+			var _byte = 0;
+			repeat (_count)
+			{
+				_byte = (_byte + buffer_read(_buffer, buffer_u8)) & 0xFF;
+				buffer_poke(_out, _offset, buffer_u8, _byte);
+				_offset += _stride;
+			}
+		}
+		else
+		{
+			repeat (_count)
+			{
+				buffer_poke(_out, _offset, buffer_u8, buffer_read(_buffer, buffer_u8));
+				_offset += _stride;
+			}
+		}
+	}
+
+	if (_size > _filtered)
+	{
+		buffer_copy(_buffer, 16 + _filtered, _size - _filtered, _out, _filtered);
+	}
+	return _out;
+}
+
+/// @ignore
+function __yamc_read_bounds(_buffer)
+{
+	var _bounds = {
+		Min: [0, 0, 0],
+		Max: [0, 0, 0],
+		Center: [0, 0, 0],
+		Radius: 0,
+	};
+	for (var _i = 0; _i < 3; ++_i)
+	{
+		_bounds.Min[_i] = buffer_read(_buffer, buffer_f32);
+	}
+	for (var _i = 0; _i < 3; ++_i)
+	{
+		_bounds.Max[_i] = buffer_read(_buffer, buffer_f32);
+	}
+	for (var _i = 0; _i < 3; ++_i)
+	{
+		_bounds.Center[_i] = buffer_read(_buffer, buffer_f32);
+	}
+	_bounds.Radius = buffer_read(_buffer, buffer_f32);
+	return _bounds;
+}
+
+/// @ignore
+function __yamc_matrix_is_mirrored(_m)
+{
+	return ((_m[0] * (_m[5] * _m[10] - _m[6] * _m[9])
+		- _m[4] * (_m[1] * _m[10] - _m[2] * _m[9])
+		+ _m[8] * (_m[1] * _m[6] - _m[2] * _m[5])) < 0);
+}
+
+/// @ignore
+function __yamc_cullmode_flip(_cullmode)
+{
+	if (_cullmode == cull_clockwise)
+	{
+		return cull_counterclockwise;
+	}
+	if (_cullmode == cull_counterclockwise)
+	{
+		return cull_clockwise;
+	}
+	return _cullmode;
+}
+
+/// @ignore
+function __yamc_create_batch_buffer(_vbuffer, _vformat, _batchSize)
+{
+	var _vertexCount = vertex_get_number(_vbuffer);
+	var _data = buffer_create_from_vertex_buffer(_vbuffer, buffer_fixed, 1);
+	var _vertexSize = buffer_get_size(_data) div max(_vertexCount, 1);
+	var _batch = buffer_create(max(_batchSize * _vertexCount * (_vertexSize + 4), 1), buffer_fixed, 1);
+	var _dest = 0;
+	for (var _copy = 0; _copy < _batchSize; ++_copy)
+	{
+		for (var _v = 0; _v < _vertexCount; ++_v)
+		{
+			buffer_copy(_data, _v * _vertexSize, _vertexSize, _batch, _dest);
+			buffer_poke(_batch, _dest + _vertexSize, buffer_f32, _copy);
+			_dest += _vertexSize + 4;
+		}
+	}
+	var _batchBuffer = vertex_create_buffer_from_buffer(_batch, _vformat);
+	buffer_delete(_batch);
+	buffer_delete(_data);
+	return _batchBuffer;
+}
+
+/// @func yamc_is_container(_buffer)
+///
+/// @desc Checks whether a buffer holds a YAMC container file.
+///
+/// @param {Id.Buffer} _buffer The buffer to check.
+///
+/// @return {Bool} Returns `true` if the buffer holds a YAMC container file.
+function yamc_is_container(_buffer)
+{
+	return (buffer_get_size(_buffer) >= 12
+		&& buffer_peek(_buffer, 0, buffer_u32) == YAMC_CONTAINER_MAGIC);
+}
+
+/// @func yamc_find_chunk(_buffer, _id)
+///
+/// @desc Finds a chunk in a YAMC container file.
+///
+/// @param {Id.Buffer} _buffer A buffer holding a YAMC container file.
+/// @param {Real} _id The identifier of the chunk, e.g. {@link YAMC_CHUNK_VERTICES}.
+///
+/// @return {Real} The offset of the chunk's payload or -1 if the container
+/// does not have such chunk.
+function yamc_find_chunk(_buffer, _id)
+{
+	var _chunkCount = buffer_peek(_buffer, 8, buffer_u32);
+	var _offset = 12;
+	repeat (_chunkCount)
+	{
+		var _chunkId = buffer_peek(_buffer, _offset, buffer_u32);
+		var _chunkSize = buffer_peek(_buffer, _offset + 4, buffer_u32);
+		_offset += 8;
+		if (_chunkId == _id)
+		{
+			return _offset;
+		}
+		_offset += _chunkSize;
+	}
+	return -1;
+}
+
+/// @func yamc_vertex_buffer_from_container(_buffer, _vformat)
+///
+/// @desc Creates a vertex buffer from a buffer holding a YAMC container file.
+/// Indexed vertex data are expanded into a plain vertex list.
+///
+/// @param {Id.Buffer} _buffer A buffer holding a YAMC container file.
+/// @param {Id.VertexFormat} _vformat The vertex format of the buffer.
+///
+/// @return {Id.VertexBuffer} The created vertex buffer.
+function yamc_vertex_buffer_from_container(_buffer, _vformat)
+{
+	var _vertexOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_VERTICES);
+	var _vertexSize = buffer_peek(_buffer, _vertexOffset + 4, buffer_u32);
+	var _vertexCount = buffer_peek(_buffer, _vertexOffset + 8, buffer_u32);
+	_vertexOffset += 12;
+
+	var _indexOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_INDICES);
+	if (_indexOffset == -1)
+	{
+		return vertex_create_buffer_from_buffer_ext(
+			_buffer, _vformat, _vertexOffset, _vertexCount);
+	}
+
+	var _indexSize = buffer_peek(_buffer, _indexOffset, buffer_u32);
+	var _indexCount = buffer_peek(_buffer, _indexOffset + 4, buffer_u32);
+	var _expanded = __yamc_expand_indices(
+		_buffer, _vertexOffset, _vertexSize, _indexOffset + 8, _indexSize, _indexCount);
+	var _vbuffer = vertex_create_buffer_from_buffer(_expanded, _vformat);
+	buffer_delete(_expanded);
+	return _vbuffer;
+}
+
+/// @func yamc_sub_meshes_from_container(_buffer, _vformat)
+///
+/// @desc Creates one vertex buffer for each sub-mesh stored in a buffer holding
+/// a YAMC container file (made with argument --submeshes). Indexed vertex data
+/// are expanded into plain vertex lists.
+///
+/// @param {Id.Buffer} _buffer A buffer holding a YAMC container file.
+/// @param {Id.VertexFormat} _vformat The vertex format of the sub-meshes.
+///
+/// @return {Array<Struct>} Array of structs with properties `VertexBuffer`,
+/// `PrimitiveType`, `MaterialIndex` and `MaterialName`, or an empty array if the
+/// container does not have sub-meshes.
+function yamc_sub_meshes_from_container(_buffer, _vformat)
+{
+	var _subMeshes = [];
+	var _meshOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_SUB_MESHES);
+	if (_meshOffset == -1)
+	{
+		return _subMeshes;
+	}
+
+	var _vertexOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_VERTICES);
+	var _vertexSize = buffer_peek(_buffer, _vertexOffset + 4, buffer_u32);
+	_vertexOffset += 12;
+
+	var _indexOffset = yamc_find_chunk(_buffer, YAMC_CHUNK_INDICES);
+	var _indexSize = (_indexOffset != -1) ? buffer_peek(_buffer, _indexOffset, buffer_u32) : 0;
+
+	buffer_seek(_buffer, buffer_seek_start, _meshOffset);
+	var _subMeshCount = buffer_read(_buffer, buffer_u32);
+	repeat (_subMeshCount)
+	{
+		var _materialIndex = buffer_read(_buffer, buffer_u32);
+		var _primitiveType = buffer_read(_buffer, buffer_u32);
+		var _firstVertex = buffer_read(_buffer, buffer_u32);
+		var _vertexCount = buffer_read(_buffer, buffer_u32);
+		var _firstIndex = buffer_read(_buffer, buffer_u32);
+		var _indexCount = buffer_read(_buffer, buffer_u32);
+		var _materialName = buffer_read(_buffer, buffer_string);
+		var _position = buffer_tell(_buffer);
+
+		var _vbuffer;
+		if (_indexOffset == -1)
+		{
+			_vbuffer = vertex_create_buffer_from_buffer_ext(
+				_buffer, _vformat, _vertexOffset + _firstVertex * _vertexSize, _vertexCount);
+		}
+		else
+		{
+			var _expanded = __yamc_expand_indices(
+				_buffer, _vertexOffset, _vertexSize,
+				_indexOffset + 8 + _firstIndex * _indexSize, _indexSize, _indexCount);
+			_vbuffer = vertex_create_buffer_from_buffer(_expanded, _vformat);
+			buffer_delete(_expanded);
+			buffer_seek(_buffer, buffer_seek_start, _position);
+		}
+
+		array_push(_subMeshes, {
+			VertexBuffer: _vbuffer,
+			PrimitiveType: _primitiveType,
+			MaterialIndex: _materialIndex,
+			MaterialName: _materialName,
+		});
+	}
+
+	return _subMeshes;
+}
+
+/// @ignore
+function __yamc_expand_indices(_buffer, _vertexOffset, _vertexSize, _indexOffset, _indexSize, _indexCount)
+{
+	var _expanded = buffer_create(max(_indexCount * _vertexSize, 1), buffer_fixed, 1);
+	var _indexType = (_indexSize == 2) ? buffer_u16 : buffer_u32;
+	var _dest = 0;
+	buffer_seek(_buffer, buffer_seek_start, _indexOffset);
+	repeat (_indexCount)
+	{
+		var _index = buffer_read(_buffer, _indexType);
+		buffer_copy(_buffer, _vertexOffset + _index * _vertexSize, _vertexSize, _expanded, _dest);
+		_dest += _vertexSize;
+	}
+	return _expanded;
+}